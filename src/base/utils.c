@@ -18,7 +18,10 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
 
 #include "config.h"
 #include "log.h"
@@ -91,6 +94,21 @@ gv_get_app_user_data_dir(void)
 	return dir;
 }
 
+const gchar *
+gv_get_app_user_cache_dir(void)
+{
+	static gchar *dir;
+
+	if (dir == NULL) {
+		const gchar *user_dir;
+
+		user_dir = g_get_user_cache_dir();
+		dir = g_build_filename(user_dir, PACKAGE_NAME, NULL);
+	}
+
+	return dir;
+}
+
 const gchar *const *
 gv_get_app_system_config_dirs(void)
 {
@@ -128,3 +146,55 @@ gv_get_app_system_data_dirs(void)
 
 	return (const gchar *const *) dirs;
 }
+
+/* Key files in the user cache directory, for things that are worth
+ * remembering across restarts, but that can be thrown away at any time.
+ */
+
+GKeyFile *
+gv_load_app_user_cache_key_file(const gchar *filename)
+{
+	GKeyFile *key_file;
+	GError *err = NULL;
+	gchar *path;
+
+	key_file = g_key_file_new();
+
+	path = g_build_filename(gv_get_app_user_cache_dir(), filename, NULL);
+	if (g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, &err) == FALSE) {
+		if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			WARNING("Failed to load '%s': %s", path, err->message);
+		g_clear_error(&err);
+	}
+	g_free(path);
+
+	return key_file;
+}
+
+void
+gv_save_app_user_cache_key_file(GKeyFile *key_file, const gchar *filename)
+{
+	const gchar *dirname;
+	GError *err = NULL;
+	gchar *path;
+
+	dirname = gv_get_app_user_cache_dir();
+	if (g_mkdir_with_parents(dirname, S_IRWXU) != 0) {
+		WARNING("Failed to make directory: %s", g_strerror(errno));
+		return;
+	}
+
+	path = g_build_filename(dirname, filename, NULL);
+	if (g_key_file_save_to_file(key_file, path, &err) == FALSE) {
+		WARNING("Failed to save '%s': %s", path, err->message);
+		g_clear_error(&err);
+	}
+	g_free(path);
+}
+
+/* Key file group names can't contain brackets */
+gboolean
+gv_is_key_file_group_valid(const gchar *group)
+{
+	return strpbrk(group, "[]") == NULL;
+}
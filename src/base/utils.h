@@ -28,5 +28,10 @@ GSettings *gv_get_settings(const gchar *component);
 
 const gchar *gv_get_app_user_config_dir(void);
 const gchar *gv_get_app_user_data_dir(void);
+const gchar *gv_get_app_user_cache_dir(void);
 const gchar *const *gv_get_app_system_config_dirs(void);
 const gchar *const *gv_get_app_system_data_dirs(void);
+
+GKeyFile *gv_load_app_user_cache_key_file(const gchar *filename);
+void      gv_save_app_user_cache_key_file(GKeyFile *key_file, const gchar *filename);
+gboolean  gv_is_key_file_group_valid     (const gchar *group);
@@ -85,17 +85,21 @@ help_and_exit(int exit_code)
 	COMMAND("shuffle [true/false]", "Get/set shuffle");
 	COMMAND("current", "Get info on current station");
 	COMMAND("playing", "Get playback status");
+	COMMAND("stats", "Get playback stats of the current station");
 	NL();
 
 	HEADING("Station list");
 	print(". <station> can be the station name or uri");
 	COMMAND("list", "Display the list of stations");
+	COMMAND("search <query> [<max>]", "Search stations by name or uri");
+	DETAILS("Case and accents are ignored");
 	COMMAND("add    <station-uri> [<station-name>] [[first/last] [before/after <station>]]", "");
 	DETAILS("Add a station to the list");
 	COMMAND("remove <station>", "Remove a station from the list");
 	COMMAND("rename <station> <name>", "Rename a station");
 	COMMAND("move   <station> [[first/last] [before/after <station>]]", "");
 	DETAILS("Move a station in the list");
+	COMMAND("prefetch", "Get progress of the playlist prefetching");
 	NL();
 
 	HEADING("Configuration");
@@ -206,6 +210,31 @@ parse_play_args(int argc, char *argv[], GVariantBuilder *b)
 	return 0;
 }
 
+int
+parse_search_args(int argc, char *argv[], GVariantBuilder *b)
+{
+	const char *query;
+	long int max;
+	char *endptr;
+
+	if (argc == 0 || argc > 2)
+		return -1;
+
+	query = argv[0];
+
+	max = 0;
+	if (argc == 2) {
+		max = strtol(argv[1], &endptr, 10);
+		if (*endptr != '\0' || max < 0)
+			return -1;
+	}
+
+	g_variant_builder_add(b, "s", query);
+	g_variant_builder_add(b, "u", (guint) max);
+
+	return 0;
+}
+
 int
 parse_add_args(int argc, char *argv[], GVariantBuilder *b)
 {
@@ -493,6 +522,76 @@ print_list_result(GVariant *result)
 	g_variant_iter_free(iter1);
 }
 
+void
+print_stats(GVariant *result)
+{
+	GVariantIter *iter;
+	GVariant *value;
+	gchar *key;
+
+	g_variant_get(result, "a{sv}", &iter);
+
+	while (g_variant_iter_loop(iter, "{sv}", &key, &value)) {
+		const gchar *unit = "";
+
+		if (g_str_has_prefix(key, "time-") || !g_strcmp0(key, "buffering-time") ||
+		    !g_strcmp0(key, "longest-buffering") || !g_strcmp0(key, "playlist-time"))
+			unit = " ms";
+		else if (!g_strcmp0(key, "bytes-received"))
+			unit = " bytes";
+		else if (!g_strcmp0(key, "bitrate"))
+			unit = " kbps";
+
+		if (g_variant_is_of_type(value, G_VARIANT_TYPE_UINT64))
+			print(BOLD("%-22s") "%" G_GUINT64_FORMAT "%s", key,
+			      g_variant_get_uint64(value), unit);
+		else if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+			print(BOLD("%-22s") "%s", key, g_variant_get_string(value, NULL));
+		else
+			print(BOLD("%-22s") "%u%s", key, g_variant_get_uint32(value), unit);
+	}
+
+	g_variant_iter_free(iter);
+}
+
+void
+print_prefetch(GVariant *result)
+{
+	GVariantIter *iter;
+	GVariant *value;
+	gchar *key;
+	gboolean enabled = FALSE;
+	guint stations = 0;
+	guint pending = 0;
+	guint resolved = 0;
+	guint failed = 0;
+
+	g_variant_get(result, "a{sv}", &iter);
+
+	while (g_variant_iter_loop(iter, "{sv}", &key, &value)) {
+		if (!g_strcmp0(key, "enabled"))
+			g_variant_get(value, "b", &enabled);
+		else if (!g_strcmp0(key, "stations"))
+			g_variant_get(value, "u", &stations);
+		else if (!g_strcmp0(key, "pending"))
+			g_variant_get(value, "u", &pending);
+		else if (!g_strcmp0(key, "resolved"))
+			g_variant_get(value, "u", &resolved);
+		else if (!g_strcmp0(key, "failed"))
+			g_variant_get(value, "u", &failed);
+	}
+
+	g_variant_iter_free(iter);
+
+	if (!enabled) {
+		print("disabled");
+		return;
+	}
+
+	print(BOLD("%u/%u") " playlists resolved, %u failed, %u pending",
+	      resolved, stations, failed, pending);
+}
+
 struct cmd root_cmds[] = {
 	// clang-format off
 	{ METHOD, "quit", "Quit", NULL, NULL },
@@ -514,18 +613,21 @@ struct cmd player_cmds[] = {
 	{ PROPERTY, "shuffle",   "Shuffle",  parse_boolean,   print_boolean },
 	{ PROPERTY, "volume",    "Volume",   parse_volume,    print_volume  },
 	{ PROPERTY, "mute",      "Mute",     parse_boolean,   print_boolean },
+	{ PROPERTY, "stats",     "Stats",    NULL,            print_stats   },
 	{ PROPERTY, NULL,        NULL,       NULL,            NULL          }
 	// clang-format on
 };
 
 struct cmd stations_cmds[] = {
 	// clang-format off
-	{ METHOD,   "list",    "List",   NULL,              print_list_result },
-	{ METHOD,   "add",     "Add",    parse_add_args,    NULL              },
-	{ METHOD,   "remove",  "Remove", parse_remove_args, NULL              },
-	{ METHOD,   "rename",  "Rename", parse_rename_args, NULL              },
-	{ METHOD,   "move",    "Move",   parse_move_args,   NULL              },
-	{ METHOD,   NULL,      NULL,     NULL,              NULL              }
+	{ METHOD,   "list",     "List",     NULL,              print_list_result },
+	{ METHOD,   "search",   "Search",   parse_search_args, print_list_result },
+	{ METHOD,   "add",      "Add",      parse_add_args,    NULL              },
+	{ METHOD,   "remove",   "Remove",   parse_remove_args, NULL              },
+	{ METHOD,   "rename",   "Rename",   parse_rename_args, NULL              },
+	{ METHOD,   "move",     "Move",     parse_move_args,   NULL              },
+	{ PROPERTY, "prefetch", "Prefetch", NULL,              print_prefetch    },
+	{ METHOD,   NULL,       NULL,       NULL,              NULL              }
 	// clang-format on
 };
 
@@ -0,0 +1,240 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Buffering policy, learned per station.
+ *
+ * By default, playback starts once the buffer is full, ie. the buffering
+ * percent reported by GStreamer reached 100%. For stations that stream
+ * steadily, it's safe to start earlier, while stations that stutter need
+ * a bigger buffer. So each playback session is measured: how much the
+ * input rate varies (the jitter, as a coefficient of variation), and how
+ * many times the buffer ran empty (the underruns). When the session ends,
+ * the preroll threshold and the buffer duration are adjusted, and saved
+ * in a cache file, so that they're used next time the station is played.
+ */
+
+#include <glib.h>
+#include <math.h>
+
+#include "base/gv-base.h"
+
+#include "core/gv-buffering.h"
+
+#define BUFFERING_CACHE_FILE "buffering.cache"
+
+/* Preroll threshold, in percent */
+#define MIN_THRESHOLD     30
+#define DEFAULT_THRESHOLD 100
+#define THRESHOLD_STEP    10
+
+/* Buffer duration, in milliseconds */
+#define DEFAULT_DURATION 2000
+#define MAX_DURATION     10000
+
+/* A session must last that long to tell a stable station, in seconds */
+#define MIN_SESSION_TIME 30
+
+/* Below this jitter, the input is considered stable */
+#define STABLE_JITTER 0.25
+
+struct _GvBuffering {
+	gchar *station_uri;
+	/* Learned values */
+	guint threshold;
+	guint duration;
+	/* Current session */
+	gint64 start_time;
+	guint underruns;
+	guint n_samples;
+	gdouble mean;
+	gdouble m2;
+};
+
+/*
+ * Cache
+ */
+
+static GKeyFile *buffering_cache;
+
+static GKeyFile *
+buffering_cache_get(void)
+{
+	if (buffering_cache == NULL)
+		buffering_cache = gv_load_app_user_cache_key_file(BUFFERING_CACHE_FILE);
+
+	return buffering_cache;
+}
+
+/*
+ * Property accessors
+ */
+
+guint
+gv_buffering_get_threshold(GvBuffering *self)
+{
+	return self->threshold;
+}
+
+guint
+gv_buffering_get_duration(GvBuffering *self)
+{
+	return self->duration;
+}
+
+guint
+gv_buffering_get_underruns(GvBuffering *self)
+{
+	return self->underruns;
+}
+
+gdouble
+gv_buffering_get_jitter(GvBuffering *self)
+{
+	if (self->n_samples < 2 || self->mean <= 0)
+		return 0;
+
+	return sqrt(self->m2 / (self->n_samples - 1)) / self->mean;
+}
+
+/*
+ * Public methods
+ */
+
+/* A playback session starts, unless it's already started */
+void
+gv_buffering_start(GvBuffering *self)
+{
+	if (self->start_time != 0)
+		return;
+
+	self->start_time = g_get_monotonic_time();
+	self->underruns = 0;
+	self->n_samples = 0;
+	self->mean = 0;
+	self->m2 = 0;
+}
+
+/* Input rate, in bytes per second, as reported while playing */
+void
+gv_buffering_sample(GvBuffering *self, gint avg_in)
+{
+	gdouble delta;
+
+	if (self->start_time == 0 || avg_in <= 0)
+		return;
+
+	/* Welford's online variance */
+	self->n_samples++;
+	delta = avg_in - self->mean;
+	self->mean += delta / self->n_samples;
+	self->m2 += delta * (avg_in - self->mean);
+}
+
+void
+gv_buffering_underrun(GvBuffering *self)
+{
+	if (self->start_time == 0)
+		return;
+
+	self->underruns++;
+	DEBUG("Buffer underrun (%u)", self->underruns);
+}
+
+/* The playback session ends, learn from it */
+void
+gv_buffering_finish(GvBuffering *self)
+{
+	GKeyFile *cache;
+	gint64 elapsed;
+	gdouble jitter;
+	guint threshold = self->threshold;
+	guint duration = self->duration;
+
+	if (self->start_time == 0)
+		return;
+
+	elapsed = (g_get_monotonic_time() - self->start_time) / G_USEC_PER_SEC;
+	jitter = gv_buffering_get_jitter(self);
+	self->start_time = 0;
+
+	DEBUG("Buffering session: %" G_GINT64_FORMAT " s, %u underruns, jitter %.2f",
+	      elapsed, self->underruns, jitter);
+
+	if (self->underruns > 0) {
+		/* Flaky, start later and buffer more */
+		threshold = DEFAULT_THRESHOLD;
+		duration = MIN(duration * 3 / 2, MAX_DURATION);
+	} else if (elapsed >= MIN_SESSION_TIME && jitter < STABLE_JITTER) {
+		/* Stable, start earlier */
+		threshold = MAX(threshold - THRESHOLD_STEP, MIN_THRESHOLD);
+		duration = MAX(duration * 9 / 10, DEFAULT_DURATION);
+	}
+
+	if (threshold == self->threshold && duration == self->duration)
+		return;
+
+	INFO("Buffering for '%s': threshold %u%% -> %u%%, duration %u ms -> %u ms",
+	     self->station_uri, self->threshold, threshold, self->duration, duration);
+
+	self->threshold = threshold;
+	self->duration = duration;
+
+	if (!gv_is_key_file_group_valid(self->station_uri))
+		return;
+
+	cache = buffering_cache_get();
+	g_key_file_set_integer(cache, self->station_uri, "threshold", threshold);
+	g_key_file_set_integer(cache, self->station_uri, "duration", duration);
+	gv_save_app_user_cache_key_file(cache, BUFFERING_CACHE_FILE);
+}
+
+void
+gv_buffering_free(GvBuffering *self)
+{
+	if (self == NULL)
+		return;
+
+	g_free(self->station_uri);
+	g_free(self);
+}
+
+GvBuffering *
+gv_buffering_new(const gchar *station_uri)
+{
+	GKeyFile *cache = buffering_cache_get();
+	GvBuffering *self;
+	gint value;
+
+	self = g_new0(GvBuffering, 1);
+	self->station_uri = g_strdup(station_uri);
+	self->threshold = DEFAULT_THRESHOLD;
+	self->duration = DEFAULT_DURATION;
+
+	value = g_key_file_get_integer(cache, station_uri, "threshold", NULL);
+	if (value >= MIN_THRESHOLD && value <= DEFAULT_THRESHOLD)
+		self->threshold = value;
+
+	value = g_key_file_get_integer(cache, station_uri, "duration", NULL);
+	if (value >= DEFAULT_DURATION && value <= MAX_DURATION)
+		self->duration = value;
+
+	return self;
+}
@@ -0,0 +1,41 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _GvBuffering GvBuffering;
+
+/* Methods */
+
+GvBuffering *gv_buffering_new     (const gchar *station_uri);
+void         gv_buffering_free    (GvBuffering *self);
+void         gv_buffering_start   (GvBuffering *self);
+void         gv_buffering_sample  (GvBuffering *self, gint avg_in);
+void         gv_buffering_underrun(GvBuffering *self);
+void         gv_buffering_finish  (GvBuffering *self);
+
+/* Property accessors */
+
+guint        gv_buffering_get_threshold(GvBuffering *self);
+guint        gv_buffering_get_duration (GvBuffering *self);
+guint        gv_buffering_get_underruns(GvBuffering *self);
+gdouble      gv_buffering_get_jitter   (GvBuffering *self);
@@ -25,9 +25,14 @@
 #pragma once
 
 #include <gio/gio.h>
+#include <libsoup/soup.h>
 
 /* Global variables */
 
 extern GSettings   *gv_core_settings;
 
 extern const gchar *gv_core_user_agent;
+
+/* Functions */
+
+SoupSession *gv_core_get_soup_session(gboolean insecure, const gchar *user_agent);
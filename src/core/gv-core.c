@@ -20,11 +20,13 @@
 
 #include <gio/gio.h>
 #include <glib.h>
+#include <libsoup/soup.h>
 
 #include "base/gv-base.h"
 
 #include "core/gv-engine.h"
 #include "core/gv-player.h"
+#include "core/gv-prefetcher.h"
 #include "core/gv-station-list.h"
 
 #define CORE_SCHEMA_ID_SUFFIX "Core"
@@ -38,6 +40,7 @@ GSettings *gv_core_settings;
 
 GvStationList *gv_core_station_list;
 GvPlayer *gv_core_player;
+GvPrefetcher *gv_core_prefetcher;
 
 gchar *gv_core_user_agent;
 
@@ -49,6 +52,53 @@ static GvEngine *gv_core_engine;
 
 static GList *core_objects;
 
+static GHashTable *http_sessions;
+
+/*
+ * HTTP sessions
+ */
+
+/* Playlists are often hosted on the same few servers, so core objects
+ * share their soup sessions, in order to reuse connections rather than
+ * paying for a DNS lookup, a TCP connect and a TLS handshake each time.
+ * A session is created for each combination of insecure flag and
+ * user-agent, as these are session-wide settings.
+ */
+
+#define HTTP_MAX_CONNS_PER_HOST 2
+#define HTTP_IDLE_TIMEOUT       30 /* seconds */
+
+SoupSession *
+gv_core_get_soup_session(gboolean insecure, const gchar *user_agent)
+{
+	SoupSession *session;
+	gchar *key;
+
+	if (http_sessions == NULL)
+		http_sessions = g_hash_table_new_full(g_str_hash, g_str_equal,
+						      g_free, g_object_unref);
+
+	key = g_strdup_printf("%s|%s", insecure ? "insecure" : "strict",
+			      user_agent ? user_agent : "");
+
+	session = g_hash_table_lookup(http_sessions, key);
+	if (session) {
+		g_free(key);
+		return session;
+	}
+
+	DEBUG("Creating soup session (insecure: %s, user-agent: '%s')",
+	      insecure ? "true" : "false", user_agent);
+	session = soup_session_new_with_options(SOUP_SESSION_SSL_STRICT, !insecure,
+						SOUP_SESSION_USER_AGENT, user_agent,
+						SOUP_SESSION_MAX_CONNS_PER_HOST, HTTP_MAX_CONNS_PER_HOST,
+						SOUP_SESSION_IDLE_TIMEOUT, HTTP_IDLE_TIMEOUT,
+						NULL);
+	g_hash_table_insert(http_sessions, key, session);
+
+	return session;
+}
+
 /*
  * Underlying audio backend
  */
@@ -145,6 +195,17 @@ gv_core_cleanup(void)
 	core_objects = g_list_reverse(core_objects);
 	g_list_free_full(core_objects, (GDestroyNotify) g_object_unref);
 
+	/* Destroy soup sessions, aborting pending requests */
+	if (http_sessions) {
+		GHashTableIter iter;
+		SoupSession *session;
+
+		g_hash_table_iter_init(&iter, http_sessions);
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &session))
+			soup_session_abort(session);
+		g_clear_pointer(&http_sessions, g_hash_table_destroy);
+	}
+
 	/* Clear application pointer */
 	gv_core_application = NULL;
 
@@ -177,6 +238,9 @@ gv_core_init(GApplication *application, const gchar *default_stations)
 	gv_core_player = gv_player_new(gv_core_engine, gv_core_station_list);
 	core_objects = g_list_append(core_objects, gv_core_player);
 
+	gv_core_prefetcher = gv_prefetcher_new(gv_core_station_list);
+	core_objects = g_list_append(core_objects, gv_core_prefetcher);
+
 	/* Register objects in the base */
 	for (item = core_objects; item; item = item->next) {
 		GObject *object = G_OBJECT(item->data);
@@ -29,6 +29,7 @@
 
 #include "core/gv-metadata.h"
 #include "core/gv-player.h"
+#include "core/gv-prefetcher.h"
 #include "core/gv-station.h"
 #include "core/gv-station-list.h"
 #include "core/gv-streaminfo.h"
@@ -38,6 +39,7 @@
 extern GApplication  *gv_core_application;
 
 extern GvPlayer      *gv_core_player;
+extern GvPrefetcher  *gv_core_prefetcher;
 extern GvStationList *gv_core_station_list;
 
 /* Functions */
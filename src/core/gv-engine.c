@@ -18,20 +18,24 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <gst/audio/streamvolume.h>
 #include <gst/gst.h>
 #include <libsoup/soup.h>
+#include <string.h>
 
 #include "base/glib-object-additions.h"
 #include "base/gv-base.h"
 #include "core/gst-additions.h"
+#include "core/gv-buffering.h"
 #include "core/gv-core-enum-types.h"
 #include "core/gv-core-internal.h"
 #include "core/gv-metadata.h"
 #include "core/gv-station.h"
 #include "core/gv-streaminfo.h"
+#include "core/gv-timeshift.h"
 
 #include "core/gv-engine.h"
 
@@ -40,12 +44,61 @@
 //#define DEBUG_GST_TAGS
 //#define DEBUG_GST_STATE_CHANGES
 
+/* How many stream uris are raced at most */
+#define RACE_MAX_STREAMS 3
+
+/* How long to wait for a stream to win the race, in milliseconds */
+#define RACE_TIMEOUT 3000
+
+/* How many stations are prerolled at most, and the smallest buffer that
+ * each of them gets, in kilobytes.
+ */
+#define STANDBY_MAX_STATIONS 2
+#define STANDBY_MIN_BUFFER   128
+
+/* How long a prerolled station can wait, in milliseconds. Past that, what
+ * it buffered is too far behind, and the server might have hung up.
+ */
+#define STANDBY_MAX_AGE 60000
+
+/* How often volumes are updated while crossfading, in milliseconds */
+#define CROSSFADE_INTERVAL 50
+
+/* Below this buffering level, the buffer is considered as run empty */
+#define UNDERRUN_PERCENT 10
+
+/* Bounds of the delay between retries, in milliseconds */
+#define RETRY_MIN_DELAY 500
+#define RETRY_MAX_DELAY 30000
+
+/* How long playback must go on before the bitrate is measured, in milliseconds */
+#define BITRATE_MIN_TIME 5000
+
+/* How often the data received is counted, in milliseconds */
+#define STATS_POLL_INTERVAL 1000
+
+/* How much memory the timeshift buffer can use at most, in bytes, and how
+ * much data it queues for playback, in bytes.
+ */
+#define TIMESHIFT_MAX_SIZE   (64 * 1024 * 1024)
+#define TIMESHIFT_QUEUE_SIZE (64 * 1024)
+
+/* How much data is received before playback starts with timeshift, in
+ * milliseconds, unless the buffering policy of the station says otherwise.
+ */
+#define TIMESHIFT_PREROLL 2000
+
 /*
  * Properties
  */
 
-#define DEFAULT_VOLUME 100
-#define DEFAULT_MUTE   FALSE
+#define DEFAULT_VOLUME             100
+#define DEFAULT_MUTE               FALSE
+#define DEFAULT_RACE_STREAMS       FALSE
+#define DEFAULT_STANDBY_BUDGET     0
+#define DEFAULT_CROSSFADE_DURATION 0
+#define DEFAULT_ADAPTIVE_BUFFERING TRUE
+#define DEFAULT_TIMESHIFT_DURATION 0
 
 enum {
 	/* Reserved */
@@ -59,6 +112,16 @@ enum {
 	PROP_MUTE,
 	PROP_PIPELINE_ENABLED,
 	PROP_PIPELINE_STRING,
+	PROP_RACE_STREAMS,
+	PROP_STANDBY_BUDGET,
+	PROP_CROSSFADE_DURATION,
+	PROP_ADAPTIVE_BUFFERING,
+	PROP_TIMESHIFT_DURATION,
+	PROP_NETWORK_AVAILABLE,
+	PROP_RETRY_COUNT,
+	PROP_RETRY_DELAY,
+	PROP_RETRY_RECOVERIES,
+	PROP_STATS,
 	/* Number of properties */
 	PROP_N
 };
@@ -94,9 +157,60 @@ struct _GvEnginePrivate {
 	gboolean mute;
 	gboolean pipeline_enabled;
 	gchar *pipeline_string;
+	gboolean race_streams;
+	gboolean adaptive_buffering;
+	/* Buffering policy of the station */
+	GvBuffering *buffering;
+	/* Stream uris of the station, tried in turn */
+	GSList *stream_uris;
+	guint stream_index;
 	/* Retry on error with a delay */
 	guint error_count;
 	guint start_playback_timeout_id;
+	guint retry_count;
+	guint retry_delay;
+	guint retry_recoveries;
+	gboolean retry_on_network;
+	/* Network connectivity */
+	GNetworkMonitor *network_monitor;
+	gboolean network_available;
+	/* Stream uris racing to connect first */
+	SoupSession *race_session;
+	GSList *race_msgs;
+	guint race_timeout_id;
+	/* Stations prerolled in the background */
+	guint standby_budget;
+	GSList *standbys;
+	/* Station fading out while the new one starts */
+	guint crossfade_duration;
+	GstElement *fade_playbin;
+	GstBus *fade_bus;
+	gint64 fade_start;
+	guint fade_timeout_id;
+	/* Playback stats of the station */
+	GvEngineStats stats;
+	gint64 stats_start;
+	gint64 stats_buffering_since;
+	gint64 stats_audio_since;
+	guint64 stats_audio_bytes;
+	GstObject *stats_source;
+	guint64 stats_source_bytes;
+	gboolean stats_underrun;
+	guint stats_timeout_id;
+	/* Stream received in the background, and played from memory */
+	guint timeshift_duration;
+	GvTimeshift *timeshift;
+	gint64 timeshift_origin;
+	gint64 timeshift_base;
+	GstElement *receiver;
+	GstBus *receiver_bus;
+	gboolean receiver_started;
+	/* Source of the playbin, fed from any thread */
+	GMutex timeshift_lock;
+	GstElement *timeshift_src;
+	guint timeshift_preroll;
+	gboolean timeshift_primed;
+	gint timeshift_want;
 };
 
 typedef struct _GvEnginePrivate GvEnginePrivate;
@@ -112,10 +226,53 @@ G_DEFINE_TYPE_WITH_CODE(GvEngine, gv_engine, G_TYPE_OBJECT,
 			G_ADD_PRIVATE(GvEngine)
 			G_IMPLEMENT_INTERFACE(GV_TYPE_ERRORABLE, NULL))
 
+G_DEFINE_BOXED_TYPE(GvEngineStats, gv_engine_stats,
+		    gv_engine_stats_copy, gv_engine_stats_free);
+
+/*
+ * Stats
+ */
+
+GvEngineStats *
+gv_engine_stats_copy(GvEngineStats *self)
+{
+	GvEngineStats *copy;
+
+	copy = g_new(GvEngineStats, 1);
+	*copy = *self;
+
+	return copy;
+}
+
+void
+gv_engine_stats_free(GvEngineStats *self)
+{
+	g_free(self);
+}
+
 /*
  * GStreamer helpers
  */
 
+static GstElement *
+make_playbin(const gchar *name)
+{
+	GstElement *playbin;
+	GstElement *fakesink;
+
+	/* Make the playbin - returns floating ref */
+	playbin = gst_element_factory_make("playbin", name);
+	g_assert_nonnull(playbin);
+	g_object_ref_sink(playbin);
+
+	/* Disable video - returns floating ref */
+	fakesink = gst_element_factory_make("fakesink", NULL);
+	g_assert_nonnull(fakesink);
+	g_object_set(playbin, "video-sink", fakesink, NULL);
+
+	return playbin;
+}
+
 static void
 set_gst_state(GstElement *playbin, GstState state)
 {
@@ -183,6 +340,397 @@ get_gst_state(GstElement *playbin)
  * Private methods
  */
 
+static void gv_engine_set_state(GvEngine *self, GvEngineState state);
+static void gv_engine_clear_standbys(GvEngine *self);
+static gboolean gv_engine_swap_standby(GvEngine *self, GvStation *station);
+static void gv_engine_fade_out(GvEngine *self);
+static void gv_engine_stop_fade(GvEngine *self);
+static void gv_engine_start_playing(GvEngine *self);
+static void gv_engine_poll_source(GvEngine *self);
+static void gv_engine_start_timeshift(GvEngine *self);
+static void gv_engine_clear_timeshift(GvEngine *self);
+static void gv_engine_set_timeshift_src(GvEngine *self, GstElement *source);
+
+static const gchar *
+gv_engine_get_stream_uri(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	return g_slist_nth_data(priv->stream_uris, priv->stream_index);
+}
+
+static void
+gv_engine_start_stream(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const gchar *uri = gv_engine_get_stream_uri(self);
+
+	INFO("Connecting to stream %u/%u: %s", priv->stream_index + 1,
+	     g_slist_length(priv->stream_uris), uri);
+
+	if (priv->timeshift) {
+		gv_engine_start_timeshift(self);
+		return;
+	}
+
+	/* According to the doc:
+	 *
+	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
+	 * > GST_STATE_CHANGE_ASYNC.
+	 *
+	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstelement.html#gst_element_set_state
+	 */
+
+	/* Ensure playback is stopped. There's no need to go all the way
+	 * down to NULL: the uri can be changed in the READY state, and only
+	 * the source and decoders are rebuilt, while the audio sink (and the
+	 * audio device) is kept open.
+	 */
+	gv_engine_poll_source(self);
+	set_gst_state(priv->playbin, GST_STATE_READY);
+
+	/* Set the stream uri */
+	g_object_set(priv->playbin, "uri", uri, NULL);
+
+	/* Set the buffer size, -1 means default */
+	if (priv->buffering)
+		g_object_set(priv->playbin, "buffer-duration",
+			     (gint64) gv_buffering_get_duration(priv->buffering) * GST_MSECOND,
+			     NULL);
+	else
+		g_object_set(priv->playbin, "buffer-duration", (gint64) -1, NULL);
+
+	/* Set gst state to PAUSE, so that the playbin starts buffering data.
+	 * Playback will start as soon as buffering is finished.
+	 */
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+}
+
+static void
+gv_engine_clear_buffering(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->buffering == NULL)
+		return;
+
+	gv_buffering_finish(priv->buffering);
+	g_clear_pointer(&priv->buffering, gv_buffering_free);
+}
+
+/* The stream that connects is tried first next time */
+static void
+gv_engine_remember_stream(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const gchar *uri = gv_engine_get_stream_uri(self);
+
+	if (priv->station == NULL || priv->stream_uris->next == NULL)
+		return;
+
+	if (!g_strcmp0(uri, gv_station_get_first_stream_uri(priv->station)))
+		return;
+
+	DEBUG("Stream preferred from now on: %s", uri);
+	gv_station_set_preferred_stream_uri(priv->station, uri);
+}
+
+/*
+ * Playback stats
+ */
+
+/* The stats are reset each time a station is played, and times are
+ * measured from that moment. The bytes received are read from the
+ * position of the source element, which is the offset in the stream for
+ * http sources. The bitrate is measured while playing, as the source then
+ * reads the stream as fast as it's played.
+ */
+
+static gint
+elapsed_ms(gint64 since)
+{
+	return (g_get_monotonic_time() - since) / 1000;
+}
+
+static void
+gv_engine_reset_stats(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineStats *stats = &priv->stats;
+
+	memset(stats, 0, sizeof *stats);
+	stats->time_to_connect = -1;
+	stats->time_to_first_buffer = -1;
+	stats->time_to_audio = -1;
+
+	priv->stats_start = g_get_monotonic_time();
+	priv->stats_buffering_since = 0;
+	priv->stats_audio_since = 0;
+	priv->stats_audio_bytes = 0;
+	priv->stats_source_bytes = 0;
+	priv->stats_underrun = FALSE;
+	gst_object_replace(&priv->stats_source, NULL);
+
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+}
+
+static void
+gv_engine_poll_source(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineStats *stats = &priv->stats;
+	GstElement *source = NULL;
+	GstPad *pad = NULL;
+	gint64 position = 0;
+	gint elapsed;
+
+	/* The source is replaced whenever the stream is restarted. With
+	 * timeshift, the stream is received by another pipeline.
+	 */
+	if (priv->receiver)
+		source = gst_bin_get_by_name(GST_BIN(priv->receiver), "source");
+	else
+		g_object_get(priv->playbin, "source", &source, NULL);
+	if ((GstObject *) source != priv->stats_source) {
+		gst_object_replace(&priv->stats_source, (GstObject *) source);
+		priv->stats_source_bytes = 0;
+	}
+
+	if (source) {
+		pad = gst_element_get_static_pad(source, "src");
+		gst_object_unref(source);
+	}
+
+	if (pad) {
+		if (gst_pad_query_position(pad, GST_FORMAT_BYTES, &position) &&
+		    (guint64) position > priv->stats_source_bytes) {
+			stats->bytes_received += position - priv->stats_source_bytes;
+			priv->stats_source_bytes = position;
+		}
+		gst_object_unref(pad);
+	}
+
+	/* Bits per millisecond are kilobits per second */
+	if (priv->stats_audio_since == 0)
+		return;
+
+	elapsed = elapsed_ms(priv->stats_audio_since);
+	if (elapsed >= BITRATE_MIN_TIME)
+		stats->bitrate = (stats->bytes_received - priv->stats_audio_bytes) * 8 / elapsed;
+}
+
+static gboolean
+when_timeout_poll_stats(gpointer data)
+{
+	GvEngine *self = GV_ENGINE(data);
+	GvEnginePrivate *priv = self->priv;
+	guint64 bytes_received = priv->stats.bytes_received;
+	guint bitrate = priv->stats.bitrate;
+
+	gv_engine_poll_source(self);
+
+	if (priv->stats.bytes_received != bytes_received || priv->stats.bitrate != bitrate)
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+gv_engine_stats_set_state(GvEngine *self, GvEngineState state)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineStats *stats = &priv->stats;
+
+	/* Buffering is over, one way or another */
+	if (priv->stats_buffering_since != 0) {
+		guint duration = elapsed_ms(priv->stats_buffering_since);
+
+		stats->buffering_time += duration;
+		if (duration > stats->longest_buffering)
+			stats->longest_buffering = duration;
+		priv->stats_buffering_since = 0;
+	}
+
+	/* The bitrate is measured again after each buffering, as the
+	 * source reads faster than the stream plays while buffering.
+	 */
+	priv->stats_audio_since = 0;
+
+	switch (state) {
+	case GV_ENGINE_STATE_BUFFERING:
+		if (stats->time_to_connect < 0)
+			stats->time_to_connect = elapsed_ms(priv->stats_start);
+		stats->n_buffering++;
+		priv->stats_buffering_since = g_get_monotonic_time();
+		break;
+	case GV_ENGINE_STATE_PLAYING:
+		if (stats->time_to_audio < 0)
+			stats->time_to_audio = elapsed_ms(priv->stats_start);
+		gv_engine_poll_source(self);
+		priv->stats_audio_since = g_get_monotonic_time();
+		priv->stats_audio_bytes = stats->bytes_received;
+		priv->stats_underrun = FALSE;
+		break;
+	default:
+		break;
+	}
+
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+}
+
+/*
+ * Stream race
+ */
+
+/* When a station has several stream uris, we can connect to a few of
+ * them at once, and play the first one that answers with something that
+ * looks like a stream. It's the stream that is the most likely to work,
+ * and to start quickly.
+ */
+
+static void
+gv_engine_race_stop(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GSList *msgs, *item;
+
+	/* Cancelled messages are completed right away, they must not be
+	 * found in the list by then.
+	 */
+	msgs = priv->race_msgs;
+	priv->race_msgs = NULL;
+	for (item = msgs; item; item = item->next)
+		soup_session_cancel_message(priv->race_session, item->data,
+					    SOUP_STATUS_CANCELLED);
+	g_slist_free(msgs);
+
+	g_clear_handle_id(&priv->race_timeout_id, g_source_remove);
+	g_clear_object(&priv->race_session);
+}
+
+static void
+gv_engine_race_finish(GvEngine *self, gint winner)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	gv_engine_race_stop(self);
+
+	if (winner >= 0) {
+		DEBUG("Stream %d won the race", winner + 1);
+		priv->stream_index = winner;
+	} else {
+		DEBUG("No stream won the race");
+	}
+
+	gv_engine_start_stream(self);
+}
+
+static gboolean
+when_race_timeout_expired(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	priv->race_timeout_id = 0;
+	gv_engine_race_finish(self, -1);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_race_message_got_headers(SoupMessage *msg,
+			    GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const gchar *content_type;
+	guint index;
+
+	if (g_slist_find(priv->race_msgs, msg) == NULL)
+		return;
+
+	/* Redirections and errors are handled on completion */
+	if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE)
+		return;
+
+	/* Servers happily return an html page instead of a stream */
+	content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
+	if (content_type && g_str_has_prefix(content_type, "text/")) {
+		DEBUG("Not a stream (Content-Type: %s)", content_type);
+		soup_session_cancel_message(priv->race_session, msg, SOUP_STATUS_CANCELLED);
+		return;
+	}
+
+	index = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(msg), "stream-index"));
+	gv_engine_race_finish(self, index);
+}
+
+static void
+on_race_message_completed(SoupSession *session G_GNUC_UNUSED,
+			  SoupMessage *msg,
+			  GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* The race is over for this one */
+	if (g_slist_find(priv->race_msgs, msg) == NULL)
+		return;
+
+	DEBUG("Stream lost the race (%u): %s", msg->status_code, msg->reason_phrase);
+
+	priv->race_msgs = g_slist_remove(priv->race_msgs, msg);
+	if (priv->race_msgs == NULL)
+		gv_engine_race_finish(self, -1);
+}
+
+/* Return FALSE if there's no race, ie. less than two contenders */
+static gboolean
+gv_engine_race_start(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvStation *station = priv->station;
+	const gchar *user_agent;
+	SoupSession *session;
+	GSList *item;
+	guint i;
+
+	user_agent = gv_station_get_user_agent(station);
+	if (user_agent == NULL)
+		user_agent = gv_core_user_agent;
+
+	session = gv_core_get_soup_session(gv_station_get_insecure(station), user_agent);
+	priv->race_session = g_object_ref(session);
+
+	for (i = 0, item = priv->stream_uris; i < RACE_MAX_STREAMS && item; i++, item = item->next) {
+		const gchar *uri = item->data;
+		SoupMessage *msg;
+
+		if (!g_str_has_prefix(uri, "http://") && !g_str_has_prefix(uri, "https://"))
+			continue;
+
+		msg = soup_message_new("GET", uri);
+		if (msg == NULL)
+			continue;
+
+		g_object_set_data(G_OBJECT(msg), "stream-index", GUINT_TO_POINTER(i));
+		g_signal_connect_object(msg, "got-headers",
+					G_CALLBACK(on_race_message_got_headers), self, 0);
+		priv->race_msgs = g_slist_prepend(priv->race_msgs, msg);
+		soup_session_queue_message(session, msg,
+					   (SoupSessionCallback) on_race_message_completed,
+					   self);
+	}
+
+	if (g_slist_length(priv->race_msgs) < 2) {
+		gv_engine_race_stop(self);
+		return FALSE;
+	}
+
+	DEBUG("Racing %u streams", g_slist_length(priv->race_msgs));
+	priv->race_timeout_id = g_timeout_add(RACE_TIMEOUT, (GSourceFunc) when_race_timeout_expired, self);
+
+	return TRUE;
+}
+
 static void
 gv_engine_reload_pipeline(GvEngine *self)
 {
@@ -221,6 +769,7 @@ gv_engine_reload_pipeline(GvEngine *self)
 	/* True when one of them is NULL */
 	if (cur_audio_sink != new_audio_sink) {
 		gv_engine_stop(self);
+		gv_engine_clear_standbys(self);
 
 		if (new_audio_sink == NULL)
 			INFO("Setting gst audio sink to default");
@@ -252,6 +801,8 @@ gv_engine_set_state(GvEngine *self, GvEngineState state)
 	if (priv->state == state)
 		return;
 
+	gv_engine_stats_set_state(self, state);
+
 	priv->state = state;
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PLAYBACK_STATE]);
 }
@@ -410,6 +961,8 @@ gv_engine_set_mute(GvEngine *self, gboolean mute)
 
 	priv->mute = mute;
 	gst_stream_volume_set_mute(GST_STREAM_VOLUME(priv->playbin), mute);
+	if (priv->fade_playbin)
+		gst_stream_volume_set_mute(GST_STREAM_VOLUME(priv->fade_playbin), mute);
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_MUTE]);
 }
 
@@ -459,41 +1012,278 @@ gv_engine_set_pipeline_string(GvEngine *self, const gchar *pipeline_string)
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PIPELINE_STRING]);
 }
 
-static void
-gv_engine_get_property(GObject *object,
-		       guint property_id,
-		       GValue *value,
-		       GParamSpec *pspec)
+gboolean
+gv_engine_get_race_streams(GvEngine *self)
 {
-	GvEngine *self = GV_ENGINE(object);
+	return self->priv->race_streams;
+}
 
-	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+void
+gv_engine_set_race_streams(GvEngine *self, gboolean race)
+{
+	GvEnginePrivate *priv = self->priv;
 
-	switch (property_id) {
-	case PROP_PLAYBACK_STATE:
-		g_value_set_enum(value, gv_engine_get_state(self));
-		break;
-	case PROP_STATION:
-		g_value_set_object(value, gv_engine_get_station(self));
-		break;
-	case PROP_STREAMINFO:
-		g_value_set_boxed(value, gv_engine_get_streaminfo(self));
-		break;
-	case PROP_METADATA:
-		g_value_set_boxed(value, gv_engine_get_metadata(self));
-		break;
-	case PROP_VOLUME:
-		g_value_set_uint(value, gv_engine_get_volume(self));
-		break;
-	case PROP_MUTE:
-		g_value_set_boolean(value, gv_engine_get_mute(self));
-		break;
+	if (priv->race_streams == race)
+		return;
+
+	priv->race_streams = race;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RACE_STREAMS]);
+}
+
+guint
+gv_engine_get_standby_budget(GvEngine *self)
+{
+	return self->priv->standby_budget;
+}
+
+void
+gv_engine_set_standby_budget(GvEngine *self, guint budget)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->standby_budget == budget)
+		return;
+
+	/* Standby stations are prerolled again on the next station change */
+	gv_engine_clear_standbys(self);
+
+	priv->standby_budget = budget;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STANDBY_BUDGET]);
+}
+
+guint
+gv_engine_get_crossfade_duration(GvEngine *self)
+{
+	return self->priv->crossfade_duration;
+}
+
+void
+gv_engine_set_crossfade_duration(GvEngine *self, guint duration)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->crossfade_duration == duration)
+		return;
+
+	priv->crossfade_duration = duration;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_CROSSFADE_DURATION]);
+}
+
+gboolean
+gv_engine_get_adaptive_buffering(GvEngine *self)
+{
+	return self->priv->adaptive_buffering;
+}
+
+void
+gv_engine_set_adaptive_buffering(GvEngine *self, gboolean adaptive)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->adaptive_buffering == adaptive)
+		return;
+
+	/* Takes effect on the next station change */
+	priv->adaptive_buffering = adaptive;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ADAPTIVE_BUFFERING]);
+}
+
+guint
+gv_engine_get_timeshift_duration(GvEngine *self)
+{
+	return self->priv->timeshift_duration;
+}
+
+void
+gv_engine_set_timeshift_duration(GvEngine *self, guint duration)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->timeshift_duration == duration)
+		return;
+
+	/* Takes effect on the next station change */
+	priv->timeshift_duration = duration;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_TIMESHIFT_DURATION]);
+}
+
+/* Whether playback can be paused, and moved within the timeshift window */
+gboolean
+gv_engine_get_seekable(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->timeshift == NULL)
+		return FALSE;
+
+	return priv->state == GV_ENGINE_STATE_PLAYING ||
+	       priv->state == GV_ENGINE_STATE_PAUSED;
+}
+
+/* Time of what's being played, in milliseconds since the station was
+ * played, or -1 without timeshift.
+ */
+gint64
+gv_engine_get_position(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	gint64 position = 0;
+
+	if (priv->timeshift == NULL)
+		return -1;
+
+	if (priv->state == GV_ENGINE_STATE_PLAYING || priv->state == GV_ENGINE_STATE_PAUSED)
+		if (gst_element_query_position(priv->playbin, GST_FORMAT_TIME, &position) == FALSE)
+			position = 0;
+
+	return priv->timeshift_base + position / GST_MSECOND;
+}
+
+/* Time of what's being received, in milliseconds since the station was
+ * played, or -1 without timeshift.
+ */
+gint64
+gv_engine_get_live_position(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->timeshift == NULL)
+		return -1;
+
+	return gv_timeshift_get_end(priv->timeshift);
+}
+
+gboolean
+gv_engine_get_network_available(GvEngine *self)
+{
+	return self->priv->network_available;
+}
+
+static void
+gv_engine_set_network_available(GvEngine *self, gboolean available)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->network_available == available)
+		return;
+
+	priv->network_available = available;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_NETWORK_AVAILABLE]);
+}
+
+guint
+gv_engine_get_retry_count(GvEngine *self)
+{
+	return self->priv->retry_count;
+}
+
+static void
+gv_engine_set_retry_count(GvEngine *self, guint count)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->retry_count == count)
+		return;
+
+	priv->retry_count = count;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RETRY_COUNT]);
+}
+
+guint
+gv_engine_get_retry_delay(GvEngine *self)
+{
+	return self->priv->retry_delay;
+}
+
+static void
+gv_engine_set_retry_delay(GvEngine *self, guint delay)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->retry_delay == delay)
+		return;
+
+	priv->retry_delay = delay;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RETRY_DELAY]);
+}
+
+guint
+gv_engine_get_retry_recoveries(GvEngine *self)
+{
+	return self->priv->retry_recoveries;
+}
+
+const GvEngineStats *
+gv_engine_get_stats(GvEngine *self)
+{
+	return &self->priv->stats;
+}
+
+static void
+gv_engine_get_property(GObject *object,
+		       guint property_id,
+		       GValue *value,
+		       GParamSpec *pspec)
+{
+	GvEngine *self = GV_ENGINE(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_PLAYBACK_STATE:
+		g_value_set_enum(value, gv_engine_get_state(self));
+		break;
+	case PROP_STATION:
+		g_value_set_object(value, gv_engine_get_station(self));
+		break;
+	case PROP_STREAMINFO:
+		g_value_set_boxed(value, gv_engine_get_streaminfo(self));
+		break;
+	case PROP_METADATA:
+		g_value_set_boxed(value, gv_engine_get_metadata(self));
+		break;
+	case PROP_VOLUME:
+		g_value_set_uint(value, gv_engine_get_volume(self));
+		break;
+	case PROP_MUTE:
+		g_value_set_boolean(value, gv_engine_get_mute(self));
+		break;
 	case PROP_PIPELINE_ENABLED:
 		g_value_set_boolean(value, gv_engine_get_pipeline_enabled(self));
 		break;
 	case PROP_PIPELINE_STRING:
 		g_value_set_string(value, gv_engine_get_pipeline_string(self));
 		break;
+	case PROP_RACE_STREAMS:
+		g_value_set_boolean(value, gv_engine_get_race_streams(self));
+		break;
+	case PROP_STANDBY_BUDGET:
+		g_value_set_uint(value, gv_engine_get_standby_budget(self));
+		break;
+	case PROP_CROSSFADE_DURATION:
+		g_value_set_uint(value, gv_engine_get_crossfade_duration(self));
+		break;
+	case PROP_ADAPTIVE_BUFFERING:
+		g_value_set_boolean(value, gv_engine_get_adaptive_buffering(self));
+		break;
+	case PROP_TIMESHIFT_DURATION:
+		g_value_set_uint(value, gv_engine_get_timeshift_duration(self));
+		break;
+	case PROP_NETWORK_AVAILABLE:
+		g_value_set_boolean(value, gv_engine_get_network_available(self));
+		break;
+	case PROP_RETRY_COUNT:
+		g_value_set_uint(value, gv_engine_get_retry_count(self));
+		break;
+	case PROP_RETRY_DELAY:
+		g_value_set_uint(value, gv_engine_get_retry_delay(self));
+		break;
+	case PROP_RETRY_RECOVERIES:
+		g_value_set_uint(value, gv_engine_get_retry_recoveries(self));
+		break;
+	case PROP_STATS:
+		g_value_set_boxed(value, gv_engine_get_stats(self));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
@@ -523,6 +1313,21 @@ gv_engine_set_property(GObject *object,
 	case PROP_PIPELINE_STRING:
 		gv_engine_set_pipeline_string(self, g_value_get_string(value));
 		break;
+	case PROP_RACE_STREAMS:
+		gv_engine_set_race_streams(self, g_value_get_boolean(value));
+		break;
+	case PROP_STANDBY_BUDGET:
+		gv_engine_set_standby_budget(self, g_value_get_uint(value));
+		break;
+	case PROP_CROSSFADE_DURATION:
+		gv_engine_set_crossfade_duration(self, g_value_get_uint(value));
+		break;
+	case PROP_ADAPTIVE_BUFFERING:
+		gv_engine_set_adaptive_buffering(self, g_value_get_boolean(value));
+		break;
+	case PROP_TIMESHIFT_DURATION:
+		gv_engine_set_timeshift_duration(self, g_value_get_uint(value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
@@ -533,51 +1338,94 @@ gv_engine_set_property(GObject *object,
  * Public methods
  */
 
+static void
+gv_engine_cancel_retry(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	priv->error_count = 0;
+	priv->retry_on_network = FALSE;
+	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_engine_set_retry_delay(self, 0);
+	gv_engine_set_retry_count(self, 0);
+}
+
 void
 gv_engine_play(GvEngine *self, GvStation *station)
 {
 	GvEnginePrivate *priv = self->priv;
-	const gchar *station_stream_uri;
+	GSList *stream_uris;
 
 	g_return_if_fail(station != NULL);
 
 	/* Station must have a stream uri */
-	station_stream_uri = gv_station_get_first_stream_uri(station);
-	if (station_stream_uri == NULL) {
+	stream_uris = gv_station_get_stream_uris(station);
+	if (stream_uris == NULL) {
 		WARNING("Station '%s' has no stream uri",
 			gv_station_get_name_or_uri(station));
 		return;
 	}
 
 	/* Cleanup error handling */
-	priv->error_count = 0;
-	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_engine_cancel_retry(self);
+	gv_engine_race_stop(self);
+
+	/* The station being played keeps playing until the new one is
+	 * ready, then it fades out. Not when it's played from memory.
+	 */
+	if (priv->crossfade_duration > 0 && priv->state == GV_ENGINE_STATE_PLAYING &&
+	    priv->timeshift_duration == 0)
+		gv_engine_fade_out(self);
 
 	/* Set station */
 	gv_engine_set_station(self, station);
+	gv_engine_unset_streaminfo(self);
+	gv_engine_unset_metadata(self);
+	gv_engine_reset_stats(self);
 
-	/* According to the doc:
-	 *
-	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
-	 * > GST_STATE_CHANGE_ASYNC.
-	 *
-	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstelement.html#gst_element_set_state
+	/* Count the data received as it goes */
+	if (priv->stats_timeout_id == 0)
+		priv->stats_timeout_id =
+			g_timeout_add(STATS_POLL_INTERVAL, when_timeout_poll_stats, self);
+
+	/* Learn from the previous session, and load the station policy */
+	gv_engine_clear_buffering(self);
+	if (priv->adaptive_buffering)
+		priv->buffering = gv_buffering_new(gv_station_get_uri(station));
+
+	/* Keep the stream in memory as it's received. The playbin has to
+	 * restart, it's fed from the ring buffer.
 	 */
+	gv_engine_clear_timeshift(self);
+	if (priv->timeshift_duration > 0) {
+		set_gst_state(priv->playbin, GST_STATE_READY);
+		priv->timeshift = gv_timeshift_new(priv->timeshift_duration * 60 * 1000,
+						   TIMESHIFT_MAX_SIZE);
+		priv->timeshift_origin = g_get_monotonic_time();
+		priv->timeshift_base = 0;
+	}
 
-	/* Ensure playback is stopped */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
+	/* All the stream uris are tried in turn, starting with the first,
+	 * which is the one that worked last time.
+	 */
+	g_slist_free_full(priv->stream_uris, g_free);
+	priv->stream_uris = g_slist_copy_deep(stream_uris, (GCopyFunc) g_strdup, NULL);
+	priv->stream_index = 0;
 
-	/* Set the stream uri */
-	g_object_set(priv->playbin, "uri", station_stream_uri, NULL);
+	/* If the station was prerolled, it's ready to go */
+	if (priv->timeshift == NULL && gv_engine_swap_standby(self, station) == TRUE)
+		return;
 
-	/* Go to the ready stop (not sure it's needed) */
-	set_gst_state(priv->playbin, GST_STATE_READY);
+	/* Either race the streams, either try the first one */
+	if (priv->race_streams && priv->stream_uris->next) {
+		set_gst_state(priv->playbin, GST_STATE_READY);
+		if (gv_engine_race_start(self) == TRUE) {
+			gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+			return;
+		}
+	}
 
-	/* Set gst state to PAUSE, so that the playbin starts buffering data.
-	 * Playback will start as soon as buffering is finished.
-	 */
-	set_gst_state(priv->playbin, GST_STATE_PAUSED);
-	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	gv_engine_start_stream(self);
 }
 
 void
@@ -586,16 +1434,74 @@ gv_engine_stop(GvEngine *self)
 	GvEnginePrivate *priv = self->priv;
 
 	/* Cleanup error handling */
-	priv->error_count = 0;
-	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_engine_cancel_retry(self);
+	gv_engine_race_stop(self);
+	gv_engine_stop_fade(self);
+	gv_engine_clear_buffering(self);
 
 	/* Radical way to stop: set state to NULL */
+	g_clear_handle_id(&priv->stats_timeout_id, g_source_remove);
+	gv_engine_poll_source(self);
 	set_gst_state(priv->playbin, GST_STATE_NULL);
+	gv_engine_clear_timeshift(self);
 	gv_engine_set_state(self, GV_ENGINE_STATE_STOPPED);
 	gv_engine_unset_streaminfo(self);
 	gv_engine_unset_metadata(self);
 }
 
+/* With timeshift, the stream is still received while paused */
+void
+gv_engine_pause(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (gv_engine_get_seekable(self) == FALSE || priv->state != GV_ENGINE_STATE_PLAYING)
+		return;
+
+	INFO("Pausing playback");
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_PAUSED);
+}
+
+void
+gv_engine_resume(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->state != GV_ENGINE_STATE_PAUSED)
+		return;
+
+	INFO("Resuming playback");
+	gv_engine_start_playing(self);
+}
+
+/* Move to a position within the timeshift window, in milliseconds */
+void
+gv_engine_seek(GvEngine *self, gint64 position)
+{
+	GvEnginePrivate *priv = self->priv;
+	gint64 end;
+
+	if (gv_engine_get_seekable(self) == FALSE)
+		return;
+
+	/* Don't get too close to what's being received */
+	end = gv_engine_get_live_position(self) - priv->timeshift_preroll;
+	if (position > end)
+		position = end;
+
+	/* Flush the playbin, and feed it again from there */
+	set_gst_state(priv->playbin, GST_STATE_READY);
+	gv_engine_set_timeshift_src(self, NULL);
+	priv->timeshift_base = gv_timeshift_seek(priv->timeshift, position);
+	INFO("Seeking to %" G_GINT64_FORMAT " ms", priv->timeshift_base);
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+
+	/* Playback restarts once the playbin is fed, unless paused */
+	if (priv->state == GV_ENGINE_STATE_PLAYING)
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+}
+
 GvEngine *
 gv_engine_new(void)
 {
@@ -625,12 +1531,8 @@ on_playbin_audio_pad_notify_caps(GstPad *pad,
 }
 
 static void
-on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
-			GstElement *source,
-			GvEngine *self)
+setup_playbin_source(GstElement *source, GvStation *station)
 {
-	GvEnginePrivate *priv = self->priv;
-	GvStation *station = priv->station;
 	static gchar *default_user_agent;
 	const gchar *user_agent;
 	gboolean ssl_strict;
@@ -659,6 +1561,20 @@ on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
 	      ssl_strict ? "true" : "false", user_agent);
 }
 
+static void
+on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
+			GstElement *source,
+			GvEngine *self)
+{
+	/* With timeshift, the playbin is fed from memory */
+	if (self->priv->timeshift) {
+		gv_engine_set_timeshift_src(self, source);
+		return;
+	}
+
+	setup_playbin_source(source, self->priv->station);
+}
+
 /*
  * GStreamer bus signal handlers
  */
@@ -669,45 +1585,103 @@ when_timeout_start_playback(gpointer data)
 	GvEngine *self = GV_ENGINE(data);
 	GvEnginePrivate *priv = self->priv;
 
-	if (self->priv->state != GV_ENGINE_STATE_STOPPED) {
-		set_gst_state(priv->playbin, GST_STATE_NULL);
-		set_gst_state(priv->playbin, GST_STATE_READY);
-		set_gst_state(priv->playbin, GST_STATE_PAUSED);
-		gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
-	}
-
 	priv->start_playback_timeout_id = 0;
+	priv->retry_on_network = FALSE;
+	gv_engine_set_retry_delay(self, 0);
+
+	if (self->priv->state != GV_ENGINE_STATE_STOPPED)
+		gv_engine_start_stream(self);
+
 	return G_SOURCE_REMOVE;
 }
 
-static void
-retry_playback(GvEngine *self)
+static guint
+compute_retry_delay(guint error_count, guint n_uris)
+{
+	guint round;
+	guint delay;
+
+	/* Fail over to the next stream uri right away */
+	if (error_count % n_uris != 0)
+		return 0;
+
+	/* Once they all failed, the delay doubles with each round */
+	round = error_count / n_uris;
+	if (round > 16)
+		round = 16;
+	delay = RETRY_MIN_DELAY << (round - 1);
+	if (delay > RETRY_MAX_DELAY)
+		delay = RETRY_MAX_DELAY;
+
+	/* Add some jitter, so that clients don't retry all at once */
+	return delay / 2 + g_random_int_range(0, delay / 2 + 1);
+}
+
+static void
+retry_playback(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
+	guint n_uris;
 	guint delay;
 
 	/* We retry playback after there's been a failure of some sort.
 	 * We don't know what kind of failure, and maybe the network is down,
 	 * in such case we don't want to keep retrying in a wild loop. So the
-	 * strategy here is to start retrying with a minimal delay, and increment
-	 * the delay with the failure count.
+	 * strategy here is to fail over to the next stream uri right away,
+	 * and once they all failed, to back off exponentially. If we know
+	 * that the network is down, we wait for it to come back, but not
+	 * forever: the network monitor might be wrong, or might never tell.
 	 */
 
-	if (priv->start_playback_timeout_id != 0)
+	if (priv->start_playback_timeout_id != 0 || priv->retry_on_network)
+		return;
+
+	/* No need to keep the previous station around anymore */
+	gv_engine_stop_fade(self);
+
+	n_uris = g_slist_length(priv->stream_uris);
+	if (n_uris == 0)
 		return;
 
 	g_assert(priv->error_count > 0);
-	delay = priv->error_count - 1;
-	if (delay > 10)
-		delay = 10;
+	priv->stream_index = (priv->stream_index + 1) % n_uris;
+	gv_engine_set_retry_count(self, priv->retry_count + 1);
+	priv->stats.n_reconnects++;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+
+	if (priv->network_available == FALSE) {
+		INFO("Network is unavailable, waiting for it to restart playback");
+		priv->retry_on_network = TRUE;
+		gv_engine_set_retry_delay(self, RETRY_MAX_DELAY);
+		priv->start_playback_timeout_id =
+			g_timeout_add(RETRY_MAX_DELAY, when_timeout_start_playback, self);
+		return;
+	}
 
-	INFO("Restarting playback in %u seconds", delay);
+	delay = compute_retry_delay(priv->error_count, n_uris);
+
+	INFO("Restarting playback in %u ms", delay);
+	gv_engine_set_retry_delay(self, delay);
 	priv->start_playback_timeout_id =
-		g_timeout_add_seconds(delay, when_timeout_start_playback, self);
+		g_timeout_add(delay, when_timeout_start_playback, self);
 }
 
+/* Playback works, the errors are behind us */
 static void
-on_bus_message_eos(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED, GvEngine *self)
+gv_engine_clear_errors(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	priv->error_count = 0;
+	if (priv->retry_count > 0) {
+		priv->retry_recoveries++;
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RETRY_RECOVERIES]);
+		gv_engine_set_retry_count(self, 0);
+	}
+}
+
+static void
+on_bus_message_eos(GstBus *bus, GstMessage *msg G_GNUC_UNUSED, GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
 
@@ -715,8 +1689,16 @@ on_bus_message_eos(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED, GvE
 
 	priv->error_count++;
 
-	/* Stop immediately otherwise gst keeps on spitting errors */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
+	/* Stop immediately otherwise gst keeps on spitting errors. Going
+	 * down to READY is enough, the audio sink is still fine. With
+	 * timeshift, it's the receiver that stops, and playback goes on
+	 * with what's in memory.
+	 */
+	gv_engine_poll_source(self);
+	if (bus == priv->receiver_bus)
+		set_gst_state(priv->receiver, GST_STATE_NULL);
+	else
+		set_gst_state(priv->playbin, GST_STATE_READY);
 
 	/* Restart playback if needed */
 	if (self->priv->state != GV_ENGINE_STATE_STOPPED)
@@ -727,7 +1709,7 @@ on_bus_message_eos(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED, GvE
 }
 
 static void
-on_bus_message_error(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+on_bus_message_error(GstBus *bus, GstMessage *msg, GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
 	GError *err;
@@ -744,7 +1726,11 @@ on_bus_message_error(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
 	WARNING("Gst bus error debug: %s", debug);
 
 	/* Stop playback otherwise gst keeps on spitting errors */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
+	gv_engine_poll_source(self);
+	if (bus == priv->receiver_bus)
+		set_gst_state(priv->receiver, GST_STATE_NULL);
+	else
+		set_gst_state(priv->playbin, GST_STATE_NULL);
 
 	/* Here comes the actual effort to handle errors. At the moment there's
 	 * not much to it, we only handle SSL failures.
@@ -915,168 +1901,1105 @@ tag_list_foreach_dump(const GstTagList *list, const gchar *tag,
 	      str);
 	g_free(str);
 }
-#endif /* DEBUG_GST_TAGS */
+#endif /* DEBUG_GST_TAGS */
+
+static void
+on_bus_message_tag(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+{
+	GstTagList *taglist = NULL;
+
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+
+	gst_message_parse_tag(msg, &taglist);
+
+#ifdef DEBUG_GST_TAGS
+	DEBUG("->>- GST TAGLIST DUMP ->>-->>-->>-->>-->>-->>-->>-->>----");
+	gst_tag_list_foreach(taglist, (GstTagForeachFunc) tag_list_foreach_dump, NULL);
+	DEBUG("-<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--");
+#endif /* DEBUG_GST_TAGS */
+
+	gv_engine_update_streaminfo_from_tags(self, taglist);
+	gv_engine_update_metadata_from_tags(self, taglist);
+
+	gst_tag_list_unref(taglist);
+}
+
+static void
+on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvBuffering *buffering = priv->buffering;
+	static gint prev_percent = 0;
+	gint percent = 0;
+	gint avg_in = 0;
+	gint threshold;
+
+	/* Handle the buffering message. Some documentation:
+	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstmessage.html#gst_message_new_buffering
+	 */
+
+	/* Parse message */
+	gst_message_parse_buffering(msg, &percent);
+	gst_message_parse_buffering_stats(msg, NULL, &avg_in, NULL, NULL);
+
+	/* Playback starts once the buffer is full, unless the station is
+	 * known to be stable enough to start earlier.
+	 */
+	threshold = buffering ? (gint) gv_buffering_get_threshold(buffering) : 100;
+
+	/* Display buffering steps 20 by 20 */
+	if (ABS(percent - prev_percent) > 20) {
+		prev_percent = percent;
+		DEBUG("Buffering (%3u %%)", percent);
+	}
+
+	/* Now, let's react according to our current state */
+	switch (priv->state) {
+	case GV_ENGINE_STATE_STOPPED:
+		/* This shouldn't happen */
+		WARNING("Received 'bus buffering' while stopped");
+		break;
+
+	case GV_ENGINE_STATE_CONNECTING:
+		/* We successfully connected! */
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		gv_engine_remember_stream(self);
+
+		/* NO BREAK HERE!
+		 * This is to handle the (very special) case where the first
+		 * buffering message received is already 100%. I'm not sure this
+		 * can happen, but it doesn't hurt to be ready.
+		 *
+		 * To avoid warnings, the next line could be:
+		 * __attribute__((fallthrough));
+		 *
+		 * However this is gcc-7 only, and I don't know about clang.
+		 * So we use a more portable (and more magic) marker comment.
+		 */
+		// fall through
+
+	case GV_ENGINE_STATE_BUFFERING:
+		/* Data is coming in */
+		if (percent > 0 && priv->stats.time_to_first_buffer < 0) {
+			priv->stats.time_to_first_buffer = elapsed_ms(priv->stats_start);
+			g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+		}
+
+		/* When buffering complete, start playing */
+		if (percent >= threshold) {
+			DEBUG("Buffering complete (%d %%), starting playback", percent);
+			gv_engine_start_playing(self);
+			gv_engine_clear_errors(self);
+		}
+		break;
+
+	case GV_ENGINE_STATE_PAUSED:
+		/* Buffering goes on, playback resumes when asked to */
+		break;
+
+	case GV_ENGINE_STATE_PLAYING:
+		/* In case buffering is < 100%, according to the documentation,
+		 * we should pause. However, more than often, I constantly
+		 * receive 'buffering < 100%' messages. In such cases, following
+		 * the doc and pausing/playing makes constantly cuts the sound.
+		 * While ignoring the messages works just fine, do let's ignore
+		 * for now.
+		 */
+		if (percent < 100) {
+			DEBUG("Buffering < 100%%, ignoring instead of setting to pause");
+			//set_gst_state(priv->playbin, GST_STATE_PAUSED);
+			//gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		}
+
+		/* Keep track of the data received, and of the times where the
+		 * buffer ran empty, which is when the sound is cut.
+		 */
+		gv_engine_poll_source(self);
+		if (percent < UNDERRUN_PERCENT && priv->stats_underrun == FALSE) {
+			priv->stats_underrun = TRUE;
+			priv->stats.n_underruns++;
+			g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATS]);
+		} else if (percent >= UNDERRUN_PERCENT) {
+			priv->stats_underrun = FALSE;
+		}
+
+		if (buffering == NULL)
+			break;
+
+		/* With adaptive buffering, we measure how steady the input is,
+		 * and we do pause when the buffer actually runs empty, as the
+		 * sound is cut anyway. Better have one pause than stuttering.
+		 */
+		gv_buffering_sample(buffering, avg_in);
+		if (percent < UNDERRUN_PERCENT) {
+			gv_buffering_underrun(buffering);
+			set_gst_state(priv->playbin, GST_STATE_PAUSED);
+			gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		}
+		break;
+
+	default:
+		WARNING("Unhandled engine state %d", priv->state);
+	}
+}
+
+static void
+on_bus_message_state_changed(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+			     GvEngine *self G_GNUC_UNUSED)
+{
+#ifdef DEBUG_GST_STATE_CHANGES
+	GstState old, new, pending;
+
+	/* Parse message */
+	gst_message_parse_state_changed(msg, &old, &new, &pending);
+
+	/* Just used for debug */
+	DEBUG("Gst state changed: old: %s, new: %s, pending: %s",
+	      gst_element_state_get_name(old),
+	      gst_element_state_get_name(new),
+	      gst_element_state_get_name(pending));
+#else
+	(void) msg;
+#endif
+}
+
+static void
+gv_engine_watch_audio_pad(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin = priv->playbin;
+	GstPad *pad = NULL;
+
+	g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
+	if (pad == NULL) {
+		DEBUG("No audio pad after stream started");
+		return;
+	}
+
+	g_signal_connect_object(pad, "notify::caps",
+				G_CALLBACK(on_playbin_audio_pad_notify_caps), self, 0);
+	gv_engine_update_streaminfo_from_audio_pad(self, pad);
+}
+
+static void
+on_bus_message_stream_start(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+			    GvEngine *self)
+{
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+	DEBUG("Stream started");
+
+	gv_engine_watch_audio_pad(self);
+}
+
+static void
+on_bus_message_application(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+			   GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const GstStructure *s;
+	const gchar *msg_name;
+
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+
+	s = gst_message_get_structure(msg);
+	msg_name = gst_structure_get_name(s);
+	g_return_if_fail(msg_name != NULL);
+
+	if (!g_strcmp0(msg_name, "audio-caps-changed")) {
+		GstElement *playbin = priv->playbin;
+		GstPad *pad = NULL;
+
+		g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
+		gv_engine_update_streaminfo_from_audio_pad(self, pad);
+	} else if (!g_strcmp0(msg_name, "timeshift-receiving")) {
+		/* We successfully connected! Playback might go on meanwhile,
+		 * in case the receiver was restarted.
+		 */
+		if (priv->state == GV_ENGINE_STATE_CONNECTING) {
+			gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+			gv_engine_remember_stream(self);
+		}
+		gv_engine_clear_errors(self);
+	} else if (!g_strcmp0(msg_name, "timeshift-ready")) {
+		/* Messages of a previous source don't count */
+		if (GST_MESSAGE_SRC(msg) != GST_OBJECT(priv->timeshift_src))
+			return;
+
+		if (priv->state == GV_ENGINE_STATE_BUFFERING) {
+			DEBUG("Timeshift buffer ready, starting playback");
+			gv_engine_start_playing(self);
+		}
+	} else {
+		WARNING("Unhandled application message %s", msg_name);
+	}
+}
+
+/*
+ * Network monitor signal handlers
+ */
+
+static void
+on_network_changed(GNetworkMonitor *monitor G_GNUC_UNUSED,
+		   gboolean available,
+		   GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	TRACE("%p, %d, %p", monitor, available, self);
+
+	if (available != priv->network_available)
+		INFO("Network is %s", available ? "available" : "unavailable");
+
+	gv_engine_set_network_available(self, available);
+
+	if (available == FALSE)
+		return;
+
+	/* The network just came back, or changed (for example after a
+	 * resume from suspend). If we were waiting to retry, no need to
+	 * wait anymore.
+	 */
+	if (priv->state == GV_ENGINE_STATE_STOPPED)
+		return;
+
+	if (priv->retry_on_network == FALSE && priv->start_playback_timeout_id == 0)
+		return;
+
+	INFO("Restarting playback now");
+	priv->retry_on_network = FALSE;
+	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_engine_set_retry_delay(self, 0);
+	gv_engine_start_stream(self);
+}
+
+/*
+ * Playbins
+ */
+
+/* The engine usually has one playbin, whose messages are handled by the
+ * bus signal handlers above. Standby stations and crossfading bring in
+ * other playbins, which take turns at being the one.
+ */
+
+static void
+gv_engine_watch_playbin(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin = priv->playbin;
+	GstBus *bus = priv->bus;
+
+	/* Connect playbin signal handlers */
+	g_signal_connect_object(playbin, "source-setup",
+				G_CALLBACK(on_playbin_source_setup), self, 0);
+
+	/* Connect bus signal handlers */
+	g_signal_connect_object(bus, "message::eos",
+				G_CALLBACK(on_bus_message_eos), self, 0);
+	g_signal_connect_object(bus, "message::error",
+				G_CALLBACK(on_bus_message_error), self, 0);
+	g_signal_connect_object(bus, "message::warning",
+				G_CALLBACK(on_bus_message_warning), self, 0);
+	g_signal_connect_object(bus, "message::info",
+				G_CALLBACK(on_bus_message_info), self, 0);
+	g_signal_connect_object(bus, "message::tag",
+				G_CALLBACK(on_bus_message_tag), self, 0);
+	g_signal_connect_object(bus, "message::buffering",
+				G_CALLBACK(on_bus_message_buffering), self, 0);
+	g_signal_connect_object(bus, "message::state-changed",
+				G_CALLBACK(on_bus_message_state_changed), self, 0);
+	g_signal_connect_object(bus, "message::stream-start",
+				G_CALLBACK(on_bus_message_stream_start), self, 0);
+	g_signal_connect_object(bus, "message::application",
+				G_CALLBACK(on_bus_message_application), self, 0);
+}
+
+static void
+gv_engine_set_playbin(GvEngine *self, GstElement *playbin)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* Retire the current playbin */
+	if (priv->playbin) {
+		g_signal_handlers_disconnect_by_data(priv->playbin, self);
+		g_signal_handlers_disconnect_by_data(priv->bus, self);
+		set_gst_state(priv->playbin, GST_STATE_NULL);
+		gst_bus_remove_signal_watch(priv->bus);
+		g_clear_pointer(&priv->bus, gst_object_unref);
+		g_clear_pointer(&priv->playbin, gst_object_unref);
+	}
+
+	if (playbin == NULL)
+		return;
+
+	/* Take ownership of the new one */
+	priv->playbin = playbin;
+
+	/* Get a reference to the message bus - returns full ref */
+	priv->bus = gst_element_get_bus(playbin);
+	g_assert_nonnull(priv->bus);
+
+	/* Add a bus signal watch (so that 'message' signals are emitted) */
+	gst_bus_add_signal_watch(priv->bus);
+
+	/* Connect signal handlers */
+	gv_engine_watch_playbin(self);
+}
+
+/* Make a playbin that is set up like the current one */
+static GstElement *
+gv_engine_make_playbin(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin;
+
+	playbin = make_playbin(NULL);
+
+	/* A gst element can't be shared, hence the custom pipeline is
+	 * created once more for each playbin.
+	 */
+	if (priv->pipeline_enabled && priv->pipeline_string) {
+		GstElement *audio_sink;
+		GError *err = NULL;
+
+		audio_sink = gst_parse_launch(priv->pipeline_string, &err);
+		if (err) {
+			DEBUG("Failed to parse pipeline description: %s", err->message);
+			g_error_free(err);
+		}
+
+		if (audio_sink == NULL) {
+			gst_object_unref(playbin);
+			return NULL;
+		}
+
+		g_object_set(playbin, "audio-sink", audio_sink, NULL);
+	}
+
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(playbin),
+				     GST_STREAM_VOLUME_FORMAT_CUBIC,
+				     (gdouble) priv->volume / 100.0);
+	gst_stream_volume_set_mute(GST_STREAM_VOLUME(playbin), priv->mute);
+
+	return playbin;
+}
+
+/*
+ * Standby stations
+ */
+
+/* While a station is playing, the stations that are likely to be played
+ * next are prerolled in the background: each of them gets its own playbin,
+ * which connects and buffers, then waits in the PAUSED state. Switching to
+ * one of these stations is then a matter of swapping playbins.
+ *
+ * The standby budget, in kilobytes, is shared between the standby stations.
+ * It bounds the memory used for buffering, and therefore the bandwidth used
+ * while waiting, as a paused playbin stops reading once its buffer is full.
+ */
+
+typedef struct {
+	GvStation *station;
+	gchar *stream_uri;
+	GstElement *playbin;
+	GstBus *bus;
+	gint64 start_time;
+	/* What happened while prerolling */
+	GstTagList *tags;
+	gint percent;
+	gboolean started;
+	gboolean failed;
+} GvStandby;
+
+static void
+gv_standby_free(GvStandby *standby)
+{
+	if (standby->playbin) {
+		g_signal_handlers_disconnect_by_data(standby->playbin, standby);
+		set_gst_state(standby->playbin, GST_STATE_NULL);
+		gst_object_unref(standby->playbin);
+	}
+
+	if (standby->bus) {
+		g_signal_handlers_disconnect_by_data(standby->bus, standby);
+		gst_bus_remove_signal_watch(standby->bus);
+		gst_object_unref(standby->bus);
+	}
+
+	if (standby->tags)
+		gst_tag_list_unref(standby->tags);
+
+	g_free(standby->stream_uri);
+	g_object_unref(standby->station);
+	g_free(standby);
+}
+
+static void
+on_standby_source_setup(GstElement *playbin G_GNUC_UNUSED,
+			GstElement *source,
+			GvStandby *standby)
+{
+	setup_playbin_source(source, standby->station);
+}
+
+static void
+on_standby_bus_message(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+		       GvStandby *standby)
+{
+	const gchar *name = gv_station_get_name_or_uri(standby->station);
+	GstTagList *taglist = NULL;
+	GstTagList *merged;
+	gint percent = 0;
+
+	switch (GST_MESSAGE_TYPE(msg)) {
+	case GST_MESSAGE_BUFFERING:
+		gst_message_parse_buffering(msg, &percent);
+		if (percent >= 100 && standby->percent < 100)
+			DEBUG("Standby station '%s' is ready", name);
+		standby->percent = percent;
+		break;
+
+	case GST_MESSAGE_TAG:
+		/* Kept for later, in case the station is played */
+		gst_message_parse_tag(msg, &taglist);
+		if (standby->tags == NULL) {
+			standby->tags = taglist;
+		} else {
+			merged = gst_tag_list_merge(standby->tags, taglist, GST_TAG_MERGE_REPLACE);
+			gst_tag_list_unref(standby->tags);
+			gst_tag_list_unref(taglist);
+			standby->tags = merged;
+		}
+		break;
+
+	case GST_MESSAGE_STREAM_START:
+		standby->started = TRUE;
+		break;
+
+	case GST_MESSAGE_ERROR:
+	case GST_MESSAGE_EOS:
+		/* Don't retry, it's just a standby */
+		DEBUG("Standby station '%s' failed", name);
+		standby->failed = TRUE;
+		set_gst_state(standby->playbin, GST_STATE_NULL);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static GvStandby *
+gv_engine_make_standby(GvEngine *self, GvStation *station, guint buffer_size)
+{
+	GvStandby *standby;
+	GstElement *playbin;
+
+	playbin = gv_engine_make_playbin(self);
+	if (playbin == NULL)
+		return NULL;
+
+	standby = g_new0(GvStandby, 1);
+	standby->station = g_object_ref(station);
+	standby->stream_uri = g_strdup(gv_station_get_first_stream_uri(station));
+	standby->playbin = playbin;
+	standby->start_time = g_get_monotonic_time();
+	standby->percent = -1;
+
+	g_object_set(playbin,
+		     "uri", standby->stream_uri,
+		     "buffer-size", (gint) buffer_size,
+		     NULL);
+	g_signal_connect(playbin, "source-setup",
+			 G_CALLBACK(on_standby_source_setup), standby);
+
+	standby->bus = gst_element_get_bus(playbin);
+	gst_bus_add_signal_watch(standby->bus);
+	g_signal_connect(standby->bus, "message",
+			 G_CALLBACK(on_standby_bus_message), standby);
+
+	INFO("Prerolling station '%s' (%u kB)",
+	     gv_station_get_name_or_uri(station), buffer_size / 1024);
+
+	set_gst_state(playbin, GST_STATE_READY);
+	set_gst_state(playbin, GST_STATE_PAUSED);
+
+	return standby;
+}
+
+static gboolean
+gv_standby_is_stale(GvStandby *standby)
+{
+	return elapsed_ms(standby->start_time) > STANDBY_MAX_AGE;
+}
+
+static void
+gv_engine_clear_standbys(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	g_slist_free_full(priv->standbys, (GDestroyNotify) gv_standby_free);
+	priv->standbys = NULL;
+}
+
+/* Return FALSE if the station was not prerolled */
+static gboolean
+gv_engine_swap_standby(GvEngine *self, GvStation *station)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvStandby *standby = NULL;
+	GSList *item;
+
+	for (item = priv->standbys; item; item = item->next) {
+		GvStandby *candidate = item->data;
+
+		if (candidate->station == station) {
+			standby = candidate;
+			break;
+		}
+	}
+
+	if (standby == NULL)
+		return FALSE;
+
+	priv->standbys = g_slist_remove(priv->standbys, standby);
+
+	/* The station might have changed in the meantime, or waited
+	 * for too long.
+	 */
+	if (standby->failed || gv_standby_is_stale(standby) ||
+	    g_strcmp0(standby->stream_uri, gv_engine_get_stream_uri(self))) {
+		gv_standby_free(standby);
+		return FALSE;
+	}
+
+	INFO("Swapping in standby station '%s'", gv_station_get_name_or_uri(station));
+
+	/* Take over the standby playbin */
+	g_signal_handlers_disconnect_by_data(standby->playbin, standby);
+	g_signal_handlers_disconnect_by_data(standby->bus, standby);
+	gst_bus_remove_signal_watch(standby->bus);
+	g_clear_pointer(&standby->bus, gst_object_unref);
+	g_object_set(standby->playbin, "buffer-size", (gint) -1, NULL);
+	gv_engine_set_playbin(self, g_steal_pointer(&standby->playbin));
+
+	/* Catch up with what happened while prerolling */
+	if (standby->tags) {
+		gv_engine_update_streaminfo_from_tags(self, standby->tags);
+		gv_engine_update_metadata_from_tags(self, standby->tags);
+	}
+
+	if (standby->started)
+		gv_engine_watch_audio_pad(self);
+
+	/* The station connected while it was prerolled */
+	if (standby->percent >= 0)
+		priv->stats.time_to_connect = 0;
+	if (standby->percent > 0)
+		priv->stats.time_to_first_buffer = 0;
+
+	/* Playback starts right away if buffering is complete, otherwise
+	 * the bus buffering handler takes it from here.
+	 */
+	if (standby->percent >= 100) {
+		gv_engine_start_playing(self);
+	} else if (standby->percent >= 0) {
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+	} else {
+		gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	}
+
+	gv_standby_free(standby);
+
+	return TRUE;
+}
+
+void
+gv_engine_set_standby_stations(GvEngine *self, GvStation *next, GvStation *prev)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvStation *stations[STANDBY_MAX_STATIONS] = { next, prev };
+	guint n_stations;
+	guint buffer_size;
+	GSList *item;
+	guint i;
+
+	/* How many stations fit in the budget. With timeshift, stations
+	 * are played from memory, they can't be prerolled.
+	 */
+	n_stations = priv->standby_budget / STANDBY_MIN_BUFFER;
+	if (n_stations > STANDBY_MAX_STATIONS)
+		n_stations = STANDBY_MAX_STATIONS;
+	if (priv->timeshift_duration > 0)
+		n_stations = 0;
+	if (n_stations > 0)
+		buffer_size = priv->standby_budget / n_stations * 1024;
+	else
+		buffer_size = 0;
+
+	/* Drop the standbys that are not wanted anymore */
+	item = priv->standbys;
+	while (item) {
+		GvStandby *standby = item->data;
+		GSList *next_item = item->next;
+		gboolean wanted = FALSE;
+
+		for (i = 0; i < n_stations; i++)
+			if (stations[i] == standby->station)
+				wanted = TRUE;
+
+		/* Stale ones are prerolled again below */
+		if (wanted == FALSE || standby->failed || gv_standby_is_stale(standby)) {
+			gv_standby_free(standby);
+			priv->standbys = g_slist_delete_link(priv->standbys, item);
+		}
+
+		item = next_item;
+	}
+
+	/* Preroll the missing ones */
+	for (i = 0; i < n_stations; i++) {
+		GvStation *station = stations[i];
+		GvStandby *standby;
+		gboolean found = FALSE;
+
+		if (station == NULL || station == priv->station)
+			continue;
+
+		/* Stations that need a playlist download are left aside */
+		if (gv_station_get_first_stream_uri(station) == NULL)
+			continue;
+
+		for (item = priv->standbys; item; item = item->next) {
+			standby = item->data;
+			if (standby->station == station)
+				found = TRUE;
+		}
+
+		if (found)
+			continue;
+
+		standby = gv_engine_make_standby(self, station, buffer_size);
+		if (standby)
+			priv->standbys = g_slist_append(priv->standbys, standby);
+	}
+}
+
+/*
+ * Timeshift
+ */
+
+/* With timeshift, the stream is received by a pipeline of its own, whose
+ * source feeds a fakesink, and the data is kept in a ring buffer. The
+ * playbin is then fed from the ring buffer, through an appsrc. Pausing the
+ * playbin or moving within the ring buffer doesn't affect the receiver,
+ * hence playback can be paused and rewound. The receiver and the appsrc
+ * run in their own streaming threads, hence the locking.
+ */
+
+static gchar *
+parse_icy_title(const gchar *icy_meta)
+{
+	const gchar *start, *end;
+	gchar *title;
+
+	start = strstr(icy_meta, "StreamTitle='");
+	if (start == NULL)
+		return NULL;
+	start += strlen("StreamTitle='");
+
+	end = strstr(start, "';");
+	if (end == NULL)
+		return NULL;
+
+	/* Shoutcast doesn't tell about the encoding, latin-1 is a good guess */
+	title = g_strndup(start, end - start);
+	if (g_utf8_validate(title, -1, NULL) == FALSE) {
+		gchar *tmp;
+
+		tmp = g_convert(title, -1, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+		g_free(title);
+		title = tmp;
+	}
+
+	return title;
+}
+
+static void
+gv_engine_timeshift_feed(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* WARNING! We're likely in the GStreamer streaming thread! */
+
+	g_mutex_lock(&priv->timeshift_lock);
+
+	while (priv->timeshift_src && g_atomic_int_get(&priv->timeshift_want)) {
+		GstFlowReturn ret = GST_FLOW_OK;
+		GstBuffer *buffer;
+		GBytes *bytes;
+		gsize size;
+		gconstpointer data;
+
+		/* Before playback starts, some data must be ahead */
+		bytes = gv_timeshift_read(priv->timeshift,
+					  priv->timeshift_primed ? 0 : priv->timeshift_preroll);
+		if (bytes == NULL)
+			break;
+
+		if (priv->timeshift_primed == FALSE) {
+			GstMessage *msg;
+
+			priv->timeshift_primed = TRUE;
+			msg = gst_message_new_application(GST_OBJECT(priv->timeshift_src),
+							  gst_structure_new_empty("timeshift-ready"));
+			gst_element_post_message(priv->timeshift_src, msg);
+		}
+
+		/* The buffer holds a reference to the data, no copy */
+		data = g_bytes_get_data(bytes, &size);
+		buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+						     (gpointer) data, size, 0, size,
+						     bytes, (GDestroyNotify) g_bytes_unref);
+		g_signal_emit_by_name(priv->timeshift_src, "push-buffer", buffer, &ret);
+		gst_buffer_unref(buffer);
+
+		if (ret != GST_FLOW_OK)
+			g_atomic_int_set(&priv->timeshift_want, FALSE);
+	}
+
+	g_mutex_unlock(&priv->timeshift_lock);
+}
 
 static void
-on_bus_message_tag(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+on_timeshift_src_need_data(GstElement *appsrc G_GNUC_UNUSED,
+			   guint length G_GNUC_UNUSED,
+			   GvEngine *self)
 {
-	GstTagList *taglist = NULL;
+	g_atomic_int_set(&self->priv->timeshift_want, TRUE);
+	gv_engine_timeshift_feed(self);
+}
 
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+static void
+on_timeshift_src_enough_data(GstElement *appsrc G_GNUC_UNUSED,
+			     GvEngine *self)
+{
+	g_atomic_int_set(&self->priv->timeshift_want, FALSE);
+}
 
-	gst_message_parse_tag(msg, &taglist);
+static void
+gv_engine_set_timeshift_src(GvEngine *self, GstElement *source)
+{
+	GvEnginePrivate *priv = self->priv;
 
-#ifdef DEBUG_GST_TAGS
-	DEBUG("->>- GST TAGLIST DUMP ->>-->>-->>-->>-->>-->>-->>-->>----");
-	gst_tag_list_foreach(taglist, (GstTagForeachFunc) tag_list_foreach_dump, NULL);
-	DEBUG("-<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--");
-#endif /* DEBUG_GST_TAGS */
+	/* WARNING! We're likely in the GStreamer streaming thread! */
 
-	gv_engine_update_streaminfo_from_tags(self, taglist);
-	gv_engine_update_metadata_from_tags(self, taglist);
+	if (source) {
+		g_object_set(source, "max-bytes", (guint64) TIMESHIFT_QUEUE_SIZE, NULL);
+		g_signal_connect_object(source, "need-data",
+					G_CALLBACK(on_timeshift_src_need_data), self, 0);
+		g_signal_connect_object(source, "enough-data",
+					G_CALLBACK(on_timeshift_src_enough_data), self, 0);
+	}
 
-	gst_tag_list_unref(taglist);
+	g_mutex_lock(&priv->timeshift_lock);
+	if (priv->timeshift_src)
+		g_signal_handlers_disconnect_by_data(priv->timeshift_src, self);
+	gst_object_replace((GstObject **) &priv->timeshift_src, GST_OBJECT(source));
+	priv->timeshift_primed = FALSE;
+	g_atomic_int_set(&priv->timeshift_want, FALSE);
+	g_mutex_unlock(&priv->timeshift_lock);
 }
 
 static void
-on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+on_receiver_handoff(GstElement *fakesink,
+		    GstBuffer *buffer,
+		    GstPad *pad,
+		    GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	static gint prev_percent = 0;
-	gint percent = 0;
+	GstMapInfo map;
+	gchar *icy_meta;
 
-	/* Handle the buffering message. Some documentation:
-	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstmessage.html#gst_message_new_buffering
-	 */
+	/* WARNING! We're in the GStreamer streaming thread! */
 
-	/* Parse message */
-	gst_message_parse_buffering(msg, &percent);
+	/* Shoutcast metadata is interleaved with the audio, it must go */
+	if (priv->receiver_started == FALSE) {
+		GstCaps *caps;
+		GstMessage *msg;
+		gint interval = 0;
 
-	/* Display buffering steps 20 by 20 */
-	if (ABS(percent - prev_percent) > 20) {
-		prev_percent = percent;
-		DEBUG("Buffering (%3u %%)", percent);
+		/* The receiver might reconnect to a stream without metadata */
+		caps = gst_pad_get_current_caps(pad);
+		if (caps) {
+			GstStructure *s = gst_caps_get_structure(caps, 0);
+
+			if (gst_structure_has_name(s, "application/x-icy"))
+				gst_structure_get_int(s, "metadata-interval", &interval);
+			gst_caps_unref(caps);
+		}
+		gv_timeshift_set_icy_interval(priv->timeshift, interval);
+
+		priv->receiver_started = TRUE;
+		msg = gst_message_new_application(GST_OBJECT(fakesink),
+						  gst_structure_new_empty("timeshift-receiving"));
+		gst_element_post_message(fakesink, msg);
 	}
 
-	/* Now, let's react according to our current state */
-	switch (priv->state) {
-	case GV_ENGINE_STATE_STOPPED:
-		/* This shouldn't happen */
-		WARNING("Received 'bus buffering' while stopped");
-		break;
+	if (gst_buffer_map(buffer, &map, GST_MAP_READ) == FALSE)
+		return;
 
-	case GV_ENGINE_STATE_CONNECTING:
-		/* We successfully connected! */
-		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+	icy_meta = gv_timeshift_push(priv->timeshift, map.data, map.size,
+				     elapsed_ms(priv->timeshift_origin));
+	gst_buffer_unmap(buffer, &map);
 
-		/* NO BREAK HERE!
-		 * This is to handle the (very special) case where the first
-		 * buffering message received is already 100%. I'm not sure this
-		 * can happen, but it doesn't hurt to be ready.
-		 *
-		 * To avoid warnings, the next line could be:
-		 * __attribute__((fallthrough));
-		 *
-		 * However this is gcc-7 only, and I don't know about clang.
-		 * So we use a more portable (and more magic) marker comment.
-		 */
-		// fall through
+	/* The metadata goes to the bus, as icydemux would do */
+	if (icy_meta) {
+		gchar *title;
 
-	case GV_ENGINE_STATE_BUFFERING:
-		/* When buffering complete, start playing */
-		if (percent >= 100) {
-			DEBUG("Buffering complete, starting playback");
-			set_gst_state(priv->playbin, GST_STATE_PLAYING);
-			gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
-			priv->error_count = 0;
-		}
-		break;
+		title = parse_icy_title(icy_meta);
+		if (title) {
+			GstTagList *taglist;
 
-	case GV_ENGINE_STATE_PLAYING:
-		/* In case buffering is < 100%, according to the documentation,
-		 * we should pause. However, more than often, I constantly
-		 * receive 'buffering < 100%' messages. In such cases, following
-		 * the doc and pausing/playing makes constantly cuts the sound.
-		 * While ignoring the messages works just fine, do let's ignore
-		 * for now.
-		 */
-		if (percent < 100) {
-			DEBUG("Buffering < 100%%, ignoring instead of setting to pause");
-			//set_gst_state(priv->playbin, GST_STATE_PAUSED);
-			//gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+			taglist = gst_tag_list_new(GST_TAG_TITLE, title, NULL);
+			gst_element_post_message(fakesink,
+						 gst_message_new_tag(GST_OBJECT(fakesink), taglist));
+			g_free(title);
 		}
-		break;
-
-	default:
-		WARNING("Unhandled engine state %d", priv->state);
+		g_free(icy_meta);
 	}
+
+	gv_engine_timeshift_feed(self);
 }
 
 static void
-on_bus_message_state_changed(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-			     GvEngine *self G_GNUC_UNUSED)
+gv_engine_stop_receiver(GvEngine *self)
 {
-#ifdef DEBUG_GST_STATE_CHANGES
-	GstState old, new, pending;
+	GvEnginePrivate *priv = self->priv;
 
-	/* Parse message */
-	gst_message_parse_state_changed(msg, &old, &new, &pending);
+	if (priv->receiver == NULL)
+		return;
 
-	/* Just used for debug */
-	DEBUG("Gst state changed: old: %s, new: %s, pending: %s",
-	      gst_element_state_get_name(old),
-	      gst_element_state_get_name(new),
-	      gst_element_state_get_name(pending));
-#else
-	(void) msg;
-#endif
+	g_signal_handlers_disconnect_by_data(priv->receiver_bus, self);
+	set_gst_state(priv->receiver, GST_STATE_NULL);
+	gst_bus_remove_signal_watch(priv->receiver_bus);
+	g_clear_pointer(&priv->receiver_bus, gst_object_unref);
+	g_clear_pointer(&priv->receiver, gst_object_unref);
+}
+
+static gboolean
+gv_engine_start_receiver(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const gchar *uri = gv_engine_get_stream_uri(self);
+	GstElement *receiver;
+	GstElement *source;
+	GstElement *sink;
+	GError *err = NULL;
+
+	source = gst_element_make_from_uri(GST_URI_SRC, uri, "source", &err);
+	if (source == NULL) {
+		WARNING("Failed to make source for '%s': %s", uri,
+			err ? err->message : "unknown error");
+		g_clear_error(&err);
+		return FALSE;
+	}
+	setup_playbin_source(source, priv->station);
+
+	sink = gst_element_factory_make("fakesink", NULL);
+	g_object_set(sink, "signal-handoffs", TRUE, "sync", FALSE, "async", FALSE, NULL);
+	g_signal_connect_object(sink, "handoff",
+				G_CALLBACK(on_receiver_handoff), self, 0);
+
+	receiver = gst_pipeline_new("receiver");
+	gst_object_ref_sink(receiver);
+	gst_bin_add_many(GST_BIN(receiver), source, sink, NULL);
+	gst_element_link(source, sink);
+
+	priv->receiver = receiver;
+	priv->receiver_bus = gst_element_get_bus(receiver);
+	priv->receiver_started = FALSE;
+	gst_bus_add_signal_watch(priv->receiver_bus);
+	g_signal_connect_object(priv->receiver_bus, "message::eos",
+				G_CALLBACK(on_bus_message_eos), self, 0);
+	g_signal_connect_object(priv->receiver_bus, "message::error",
+				G_CALLBACK(on_bus_message_error), self, 0);
+	g_signal_connect_object(priv->receiver_bus, "message::tag",
+				G_CALLBACK(on_bus_message_tag), self, 0);
+	g_signal_connect_object(priv->receiver_bus, "message::application",
+				G_CALLBACK(on_bus_message_application), self, 0);
+
+	set_gst_state(receiver, GST_STATE_PLAYING);
+
+	return TRUE;
 }
 
 static void
-on_bus_message_stream_start(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-			    GvEngine *self)
+gv_engine_start_timeshift(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	GstElement *playbin = priv->playbin;
-	GstPad *pad = NULL;
+	gboolean needs_restart;
 
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
-	DEBUG("Stream started");
+	/* If the playbin is still going, only the receiver is restarted,
+	 * and playback goes on with what's in memory meanwhile.
+	 */
+	needs_restart = GST_STATE(priv->playbin) < GST_STATE_PAUSED &&
+			GST_STATE_PENDING(priv->playbin) != GST_STATE_PAUSED;
+	if (needs_restart) {
+		set_gst_state(priv->playbin, GST_STATE_READY);
+		gv_engine_set_timeshift_src(self, NULL);
+	}
 
-	g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
-	if (pad == NULL) {
-		DEBUG("No audio pad after stream started");
+	gv_engine_poll_source(self);
+	gv_engine_stop_receiver(self);
+	if (gv_engine_start_receiver(self) == FALSE) {
+		priv->error_count++;
+		retry_playback(self);
 		return;
 	}
 
-	g_signal_connect_object(pad, "notify::caps",
-				G_CALLBACK(on_playbin_audio_pad_notify_caps), self, 0);
-	gv_engine_update_streaminfo_from_audio_pad(self, pad);
+	if (needs_restart == FALSE)
+		return;
+
+	/* The playbin starts from the read point of the ring buffer */
+	priv->timeshift_preroll = priv->buffering ?
+				  gv_buffering_get_duration(priv->buffering) :
+				  TIMESHIFT_PREROLL;
+	priv->timeshift_base = gv_timeshift_get_position(priv->timeshift);
+	g_object_set(priv->playbin, "uri", "appsrc://", NULL);
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
 }
 
 static void
-on_bus_message_application(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-			   GvEngine *self)
+gv_engine_clear_timeshift(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	const GstStructure *s;
-	const gchar *msg_name;
 
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+	gv_engine_stop_receiver(self);
+	gv_engine_set_timeshift_src(self, NULL);
+	g_clear_pointer(&priv->timeshift, gv_timeshift_free);
+}
 
-	s = gst_message_get_structure(msg);
-	msg_name = gst_structure_get_name(s);
-	g_return_if_fail(msg_name != NULL);
+/*
+ * Crossfade
+ */
 
-	if (!g_strcmp0(msg_name, "audio-caps-changed")) {
-		GstElement *playbin = priv->playbin;
-		GstPad *pad = NULL;
+/* When the station changes, the playbin of the station being played is
+ * set aside and keeps playing, while a new playbin connects to the new
+ * station. Once it's done buffering, the new station fades in while the
+ * old one fades out, and the sound server does the mixing.
+ */
 
-		g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
-		gv_engine_update_streaminfo_from_audio_pad(self, pad);
-	} else {
-		WARNING("Unhandled application message %s", msg_name);
+static void
+gv_engine_stop_fade(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	g_clear_handle_id(&priv->fade_timeout_id, g_source_remove);
+
+	if (priv->fade_playbin == NULL)
+		return;
+
+	DEBUG("Done with the previous station");
+
+	g_signal_handlers_disconnect_by_data(priv->fade_bus, self);
+	set_gst_state(priv->fade_playbin, GST_STATE_NULL);
+	gst_bus_remove_signal_watch(priv->fade_bus);
+	g_clear_pointer(&priv->fade_bus, gst_object_unref);
+	g_clear_pointer(&priv->fade_playbin, gst_object_unref);
+
+	/* In case the fade was interrupted */
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+				     GST_STREAM_VOLUME_FORMAT_CUBIC,
+				     (gdouble) priv->volume / 100.0);
+}
+
+static void
+on_fade_bus_message(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED,
+		    GvEngine *self)
+{
+	/* The previous station failed, no need to wait for the fade */
+	gv_engine_stop_fade(self);
+}
+
+static void
+gv_engine_fade_out(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin;
+
+	playbin = gv_engine_make_playbin(self);
+	if (playbin == NULL)
+		return;
+
+	/* One station fades out at a time */
+	gv_engine_stop_fade(self);
+
+	DEBUG("Keeping the current station until the new one is ready");
+
+	/* Set the current playbin aside */
+	g_signal_handlers_disconnect_by_data(priv->playbin, self);
+	g_signal_handlers_disconnect_by_data(priv->bus, self);
+	priv->fade_playbin = g_steal_pointer(&priv->playbin);
+	priv->fade_bus = g_steal_pointer(&priv->bus);
+	g_signal_connect_object(priv->fade_bus, "message::error",
+				G_CALLBACK(on_fade_bus_message), self, 0);
+	g_signal_connect_object(priv->fade_bus, "message::eos",
+				G_CALLBACK(on_fade_bus_message), self, 0);
+
+	/* The new station gets a new playbin */
+	gv_engine_set_playbin(self, playbin);
+}
+
+static gboolean
+when_fade_timeout_tick(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	gdouble volume = (gdouble) priv->volume / 100.0;
+	gdouble progress;
+
+	progress = (gdouble) (g_get_monotonic_time() - priv->fade_start) /
+		   (priv->crossfade_duration * 1000);
+	if (progress > 1.0)
+		progress = 1.0;
+
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+				     GST_STREAM_VOLUME_FORMAT_CUBIC,
+				     volume * progress);
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->fade_playbin),
+				     GST_STREAM_VOLUME_FORMAT_CUBIC,
+				     volume * (1.0 - progress));
+
+	if (progress < 1.0)
+		return G_SOURCE_CONTINUE;
+
+	priv->fade_timeout_id = 0;
+	gv_engine_stop_fade(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_engine_start_playing(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* Start from silence if there's a station to fade out */
+	if (priv->fade_playbin && priv->fade_timeout_id == 0) {
+		DEBUG("Crossfading over %u ms", priv->crossfade_duration);
+		gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+					     GST_STREAM_VOLUME_FORMAT_CUBIC, 0.0);
+		priv->fade_start = g_get_monotonic_time();
+		priv->fade_timeout_id = g_timeout_add(CROSSFADE_INTERVAL,
+						      (GSourceFunc) when_fade_timeout_tick,
+						      self);
 	}
+
+	set_gst_state(priv->playbin, GST_STATE_PLAYING);
+	gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
+
+	if (priv->buffering)
+		gv_buffering_start(priv->buffering);
 }
 
 /*
@@ -1093,9 +3016,17 @@ gv_engine_finalize(GObject *object)
 
 	/* Remove pending operations */
 	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	g_clear_handle_id(&priv->stats_timeout_id, g_source_remove);
+	gv_engine_race_stop(self);
+	gv_engine_clear_standbys(self);
+	gv_engine_stop_fade(self);
+	gv_engine_clear_buffering(self);
+	gst_object_replace(&priv->stats_source, NULL);
 
 	/* Stop playback */
 	set_gst_state(priv->playbin, GST_STATE_NULL);
+	gv_engine_clear_timeshift(self);
+	g_mutex_clear(&priv->timeshift_lock);
 
 	/* Unref the bus */
 	gst_bus_remove_signal_watch(priv->bus);
@@ -1104,6 +3035,9 @@ gv_engine_finalize(GObject *object)
 	/* Unref the playbin */
 	gst_object_unref(priv->playbin);
 
+	/* Unref the network monitor */
+	g_object_unref(priv->network_monitor);
+
 	/* Unref metadata */
 	g_clear_object(&priv->station);
 	gv_clear_streaminfo(&priv->streaminfo);
@@ -1111,6 +3045,7 @@ gv_engine_finalize(GObject *object)
 
 	/* Free resources */
 	g_free(priv->pipeline_string);
+	g_slist_free_full(priv->stream_uris, g_free);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_FINALIZE(gv_engine, object);
@@ -1121,60 +3056,33 @@ gv_engine_constructed(GObject *object)
 {
 	GvEngine *self = GV_ENGINE(object);
 	GvEnginePrivate *priv = self->priv;
-	GstElement *playbin;
-	GstElement *fakesink;
-	GstBus *bus;
 
 	/* Initialize properties */
 	priv->volume = DEFAULT_VOLUME;
 	priv->mute = DEFAULT_MUTE;
 	priv->pipeline_enabled = FALSE;
 	priv->pipeline_string = NULL;
+	priv->race_streams = DEFAULT_RACE_STREAMS;
+	priv->standby_budget = DEFAULT_STANDBY_BUDGET;
+	priv->crossfade_duration = DEFAULT_CROSSFADE_DURATION;
+	priv->adaptive_buffering = DEFAULT_ADAPTIVE_BUFFERING;
+	priv->timeshift_duration = DEFAULT_TIMESHIFT_DURATION;
+	gv_engine_reset_stats(self);
+
+	/* Timeshift source, fed from the streaming threads */
+	g_mutex_init(&priv->timeshift_lock);
+
+	/* Watch the network */
+	priv->network_monitor = g_object_ref(g_network_monitor_get_default());
+	priv->network_available = g_network_monitor_get_network_available(priv->network_monitor);
+	g_signal_connect_object(priv->network_monitor, "network-changed",
+				G_CALLBACK(on_network_changed), self, 0);
 
 	/* GStreamer must be initialized, let's check that */
 	g_assert(gst_is_initialized());
 
-	/* Make the playbin - returns floating ref */
-	playbin = gst_element_factory_make("playbin", "playbin");
-	g_assert_nonnull(playbin);
-	priv->playbin = g_object_ref_sink(playbin);
-
-	/* Disable video - returns floating ref */
-	fakesink = gst_element_factory_make("fakesink", "fakesink");
-	g_assert_nonnull(fakesink);
-	g_object_set(playbin, "video-sink", fakesink, NULL);
-
-	/* Connect playbin signal handlers */
-	g_signal_connect_object(playbin, "source-setup",
-				G_CALLBACK(on_playbin_source_setup), self, 0);
-
-	/* Get a reference to the message bus - returns full ref */
-	bus = gst_element_get_bus(playbin);
-	g_assert_nonnull(bus);
-	priv->bus = bus;
-
-	/* Add a bus signal watch (so that 'message' signals are emitted) */
-	gst_bus_add_signal_watch(bus);
-
-	/* Connect bus signal handlers */
-	g_signal_connect_object(bus, "message::eos",
-				G_CALLBACK(on_bus_message_eos), self, 0);
-	g_signal_connect_object(bus, "message::error",
-				G_CALLBACK(on_bus_message_error), self, 0);
-	g_signal_connect_object(bus, "message::warning",
-				G_CALLBACK(on_bus_message_warning), self, 0);
-	g_signal_connect_object(bus, "message::info",
-				G_CALLBACK(on_bus_message_info), self, 0);
-	g_signal_connect_object(bus, "message::tag",
-				G_CALLBACK(on_bus_message_tag), self, 0);
-	g_signal_connect_object(bus, "message::buffering",
-				G_CALLBACK(on_bus_message_buffering), self, 0);
-	g_signal_connect_object(bus, "message::state-changed",
-				G_CALLBACK(on_bus_message_state_changed), self, 0);
-	g_signal_connect_object(bus, "message::stream-start",
-				G_CALLBACK(on_bus_message_stream_start), self, 0);
-	g_signal_connect_object(bus, "message::application",
-				G_CALLBACK(on_bus_message_application), self, 0);
+	/* Make the playbin */
+	gv_engine_set_playbin(self, make_playbin("playbin"));
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_CONSTRUCTED(gv_engine, object);
@@ -1244,6 +3152,56 @@ gv_engine_class_init(GvEngineClass *class)
 		g_param_spec_string("pipeline-string", "Custom pipeline string", NULL, NULL,
 				    GV_PARAM_READWRITE);
 
+	properties[PROP_RACE_STREAMS] =
+		g_param_spec_boolean("race-streams", "Race stream uris", NULL,
+				     DEFAULT_RACE_STREAMS,
+				     GV_PARAM_READWRITE);
+
+	properties[PROP_STANDBY_BUDGET] =
+		g_param_spec_uint("standby-budget", "Standby budget", NULL,
+				  0, 1024 * 1024, DEFAULT_STANDBY_BUDGET,
+				  GV_PARAM_READWRITE);
+
+	properties[PROP_CROSSFADE_DURATION] =
+		g_param_spec_uint("crossfade-duration", "Crossfade duration in milliseconds", NULL,
+				  0, 10000, DEFAULT_CROSSFADE_DURATION,
+				  GV_PARAM_READWRITE);
+
+	properties[PROP_ADAPTIVE_BUFFERING] =
+		g_param_spec_boolean("adaptive-buffering", "Adaptive buffering", NULL,
+				     DEFAULT_ADAPTIVE_BUFFERING,
+				     GV_PARAM_READWRITE);
+
+	properties[PROP_TIMESHIFT_DURATION] =
+		g_param_spec_uint("timeshift-duration", "Timeshift duration in minutes", NULL,
+				  0, 60, DEFAULT_TIMESHIFT_DURATION,
+				  GV_PARAM_READWRITE);
+
+	properties[PROP_NETWORK_AVAILABLE] =
+		g_param_spec_boolean("network-available", "Network available", NULL,
+				     TRUE,
+				     GV_PARAM_READABLE);
+
+	properties[PROP_RETRY_COUNT] =
+		g_param_spec_uint("retry-count", "Retries since playback failed", NULL,
+				  0, G_MAXUINT, 0,
+				  GV_PARAM_READABLE);
+
+	properties[PROP_RETRY_DELAY] =
+		g_param_spec_uint("retry-delay", "Delay before the next retry, in milliseconds", NULL,
+				  0, G_MAXUINT, 0,
+				  GV_PARAM_READABLE);
+
+	properties[PROP_RETRY_RECOVERIES] =
+		g_param_spec_uint("retry-recoveries", "Times playback recovered by retrying", NULL,
+				  0, G_MAXUINT, 0,
+				  GV_PARAM_READABLE);
+
+	properties[PROP_STATS] =
+		g_param_spec_boxed("stats", "Playback stats", NULL,
+				   GV_TYPE_ENGINE_STATS,
+				   GV_PARAM_READABLE);
+
 	g_object_class_install_properties(object_class, PROP_N, properties);
 
 	/* Signals */
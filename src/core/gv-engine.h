@@ -39,14 +39,39 @@ typedef enum {
 	GV_ENGINE_STATE_STOPPED = 0,
 	GV_ENGINE_STATE_CONNECTING,
 	GV_ENGINE_STATE_BUFFERING,
-	GV_ENGINE_STATE_PLAYING
+	GV_ENGINE_STATE_PLAYING,
+	GV_ENGINE_STATE_PAUSED
 } GvEngineState;
 
+/* How playback went since the station was played, times in milliseconds */
+typedef struct {
+	gint time_to_connect;      /* -1 until it happens */
+	gint time_to_first_buffer; /* -1 until it happens */
+	gint time_to_audio;        /* -1 until it happens */
+	guint n_buffering;
+	guint buffering_time;
+	guint longest_buffering;
+	guint n_underruns;
+	guint n_reconnects;
+	guint64 bytes_received;
+	guint bitrate; /* kbit/s, measured while playing, 0 if unknown */
+} GvEngineStats;
+
+#define GV_TYPE_ENGINE_STATS gv_engine_stats_get_type()
+
+GType          gv_engine_stats_get_type(void) G_GNUC_CONST;
+GvEngineStats *gv_engine_stats_copy    (GvEngineStats *self);
+void           gv_engine_stats_free    (GvEngineStats *self);
+
 /* Methods */
 
-GvEngine *gv_engine_new (void);
-void      gv_engine_play(GvEngine *self, GvStation *station);
-void      gv_engine_stop(GvEngine *self);
+GvEngine *gv_engine_new                 (void);
+void      gv_engine_play                (GvEngine *self, GvStation *station);
+void      gv_engine_stop                (GvEngine *self);
+void      gv_engine_set_standby_stations(GvEngine *self, GvStation *next, GvStation *prev);
+void      gv_engine_pause               (GvEngine *self);
+void      gv_engine_resume              (GvEngine *self);
+void      gv_engine_seek                (GvEngine *self, gint64 position);
 
 /* Property accessors */
 
@@ -61,3 +86,21 @@ gboolean       gv_engine_get_pipeline_enabled(GvEngine *self);
 void           gv_engine_set_pipeline_enabled(GvEngine *self, gboolean enabled);
 const gchar   *gv_engine_get_pipeline_string (GvEngine *self);
 void           gv_engine_set_pipeline_string (GvEngine *self, const gchar *pipeline);
+gboolean       gv_engine_get_race_streams    (GvEngine *self);
+void           gv_engine_set_race_streams    (GvEngine *self, gboolean race);
+guint          gv_engine_get_standby_budget  (GvEngine *self);
+void           gv_engine_set_standby_budget  (GvEngine *self, guint budget);
+guint          gv_engine_get_crossfade_duration(GvEngine *self);
+void           gv_engine_set_crossfade_duration(GvEngine *self, guint duration);
+gboolean       gv_engine_get_adaptive_buffering(GvEngine *self);
+void           gv_engine_set_adaptive_buffering(GvEngine *self, gboolean adaptive);
+guint          gv_engine_get_timeshift_duration(GvEngine *self);
+void           gv_engine_set_timeshift_duration(GvEngine *self, guint duration);
+gboolean       gv_engine_get_seekable        (GvEngine *self);
+gint64         gv_engine_get_position        (GvEngine *self);
+gint64         gv_engine_get_live_position   (GvEngine *self);
+gboolean       gv_engine_get_network_available(GvEngine *self);
+guint          gv_engine_get_retry_count     (GvEngine *self);
+guint          gv_engine_get_retry_delay     (GvEngine *self);
+guint          gv_engine_get_retry_recoveries(GvEngine *self);
+const GvEngineStats *gv_engine_get_stats     (GvEngine *self);
@@ -58,6 +58,11 @@ enum {
 	PROP_MUTE,
 	PROP_PIPELINE_ENABLED,
 	PROP_PIPELINE_STRING,
+	PROP_RACE_STREAMS,
+	PROP_STANDBY_BUDGET,
+	PROP_CROSSFADE_DURATION,
+	PROP_ADAPTIVE_BUFFERING,
+	PROP_TIMESHIFT_DURATION,
 	/* Properties */
 	PROP_PLAYBACK_STATE,
 	PROP_REPEAT,
@@ -105,6 +110,10 @@ struct _GvPlayerPrivate {
 	gboolean autoplay;
 	/* Current station */
 	GvStation *station;
+	/* Stream uri given to the engine */
+	gchar *stream_uri;
+	/* Playlist downloads */
+	GvPlaylistStats playlist_stats;
 	/* Wished state */
 	GvPlayerWish wish;
 };
@@ -145,6 +154,9 @@ gv_playback_state_to_string(GvPlaybackState state)
 	case GV_PLAYBACK_STATE_BUFFERING:
 		str = _("Buffering…");
 		break;
+	case GV_PLAYBACK_STATE_PAUSED:
+		str = _("Paused");
+		break;
 	case GV_PLAYBACK_STATE_STOPPED:
 	default:
 		str = _("Stopped");
@@ -160,6 +172,17 @@ gv_playback_state_to_string(GvPlaybackState state)
 
 static void gv_player_set_playback_state(GvPlayer *self, GvPlaybackState value);
 
+/* Preroll the stations that are likely to be played next */
+static void
+gv_player_update_standby_stations(GvPlayer *self)
+{
+	GvPlayerPrivate *priv = self->priv;
+
+	gv_engine_set_standby_stations(priv->engine,
+				       gv_player_get_next_station(self),
+				       gv_player_get_prev_station(self));
+}
+
 static void
 on_station_notify(GvStation *station,
 		  GParamSpec *pspec,
@@ -173,10 +196,17 @@ on_station_notify(GvStation *station,
 	g_assert(station == priv->station);
 
 	if (!g_strcmp0(property_name, "stream-uris")) {
+		GSList *uris = gv_station_get_stream_uris(station);
+
 		DEBUG("Station %p: stream URIs have changed", station);
 
-		/* Check if there are some streams, and start playing if needed */
-		if (gv_station_get_stream_uris(station))
+		/* Check if there are some streams, and start playing if needed.
+		 * There's no need to restart if the stream being played is still
+		 * there. This happens when the first stream of a playlist is
+		 * available before the playlist is complete, or when the engine
+		 * reorders the streams after failing over to another one.
+		 */
+		if (uris && !g_slist_find_custom(uris, priv->stream_uri, (GCompareFunc) g_strcmp0))
 			if (priv->wish == GV_PLAYER_WISH_TO_PLAY)
 				gv_player_play(self);
 	}
@@ -185,6 +215,41 @@ on_station_notify(GvStation *station,
 	g_object_notify(G_OBJECT(self), "station");
 }
 
+static void
+on_station_playlist_downloaded(GvStation *station,
+			       GvPlaylist *playlist,
+			       GvPlayer *self)
+{
+	GvPlayerPrivate *priv = self->priv;
+	GvPlaylistStats *stats = &priv->playlist_stats;
+	GvPlaylistStatus status = gv_playlist_get_status(playlist);
+
+	TRACE("%p, %p, %p", station, playlist, self);
+
+	switch (status) {
+	case GV_PLAYLIST_STATUS_RESOLVED:
+		stats->n_resolved++;
+		break;
+	case GV_PLAYLIST_STATUS_FAILED:
+		stats->n_failed++;
+		break;
+	case GV_PLAYLIST_STATUS_TIMED_OUT:
+		stats->n_timed_out++;
+		break;
+	case GV_PLAYLIST_STATUS_CANCELLED:
+		stats->n_cancelled++;
+		break;
+	default:
+		break;
+	}
+
+	stats->last_status = status;
+	stats->last_time = gv_playlist_get_elapsed_time(playlist) / 1000;
+
+	INFO("Playlist %s in %u ms", gv_playlist_status_to_string(status),
+	     stats->last_time);
+}
+
 static void
 on_engine_notify(GvEngine *engine,
 		 GParamSpec *pspec,
@@ -213,6 +278,21 @@ on_engine_notify(GvEngine *engine,
 	} else if (!g_strcmp0(property_name, "pipeline-string")) {
 		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PIPELINE_STRING]);
 
+	} else if (!g_strcmp0(property_name, "race-streams")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RACE_STREAMS]);
+
+	} else if (!g_strcmp0(property_name, "standby-budget")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STANDBY_BUDGET]);
+
+	} else if (!g_strcmp0(property_name, "crossfade-duration")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_CROSSFADE_DURATION]);
+
+	} else if (!g_strcmp0(property_name, "adaptive-buffering")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ADAPTIVE_BUFFERING]);
+
+	} else if (!g_strcmp0(property_name, "timeshift-duration")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_TIMESHIFT_DURATION]);
+
 	} else if (!g_strcmp0(property_name, "playback-state")) {
 		GvEngineState engine_state;
 		GvPlaybackState playback_state;
@@ -233,6 +313,9 @@ on_engine_notify(GvEngine *engine,
 		case GV_ENGINE_STATE_PLAYING:
 			playback_state = GV_PLAYBACK_STATE_PLAYING;
 			break;
+		case GV_ENGINE_STATE_PAUSED:
+			playback_state = GV_PLAYBACK_STATE_PAUSED;
+			break;
 		default:
 			ERROR("Unhandled engine state: %d", engine_state);
 			/* Program execution stops here */
@@ -241,6 +324,12 @@ on_engine_notify(GvEngine *engine,
 
 		/* Set state */
 		gv_player_set_playback_state(self, playback_state);
+
+		/* Wait for the station to play before prerolling others,
+		 * so that they don't compete for bandwidth.
+		 */
+		if (playback_state == GV_PLAYBACK_STATE_PLAYING)
+			gv_player_update_standby_stations(self);
 	}
 }
 
@@ -307,6 +396,44 @@ gv_player_get_streaminfo(GvPlayer *self)
 	return gv_engine_get_streaminfo(engine);
 }
 
+const GvPlaylistStats *
+gv_player_get_playlist_stats(GvPlayer *self)
+{
+	return &self->priv->playlist_stats;
+}
+
+const GvEngineStats *
+gv_player_get_engine_stats(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_stats(engine);
+}
+
+gboolean
+gv_player_get_seekable(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_seekable(engine);
+}
+
+gint64
+gv_player_get_position(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_position(engine);
+}
+
+gint64
+gv_player_get_live_position(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_live_position(engine);
+}
+
 GvMetadata *
 gv_player_get_metadata(GvPlayer *self)
 {
@@ -412,6 +539,86 @@ gv_player_set_pipeline_string(GvPlayer *self, const gchar *pipeline_string)
 	gv_engine_set_pipeline_string(engine, pipeline_string);
 }
 
+gboolean
+gv_player_get_race_streams(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_race_streams(engine);
+}
+
+void
+gv_player_set_race_streams(GvPlayer *self, gboolean race)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_race_streams(engine, race);
+}
+
+guint
+gv_player_get_standby_budget(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_standby_budget(engine);
+}
+
+void
+gv_player_set_standby_budget(GvPlayer *self, guint budget)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_standby_budget(engine, budget);
+}
+
+guint
+gv_player_get_crossfade_duration(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_crossfade_duration(engine);
+}
+
+void
+gv_player_set_crossfade_duration(GvPlayer *self, guint duration)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_crossfade_duration(engine, duration);
+}
+
+gboolean
+gv_player_get_adaptive_buffering(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_adaptive_buffering(engine);
+}
+
+void
+gv_player_set_adaptive_buffering(GvPlayer *self, gboolean adaptive)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_adaptive_buffering(engine, adaptive);
+}
+
+guint
+gv_player_get_timeshift_duration(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_timeshift_duration(engine);
+}
+
+void
+gv_player_set_timeshift_duration(GvPlayer *self, guint duration)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_timeshift_duration(engine, duration);
+}
+
 /*
  * Property accessors - player properties
  */
@@ -535,14 +742,18 @@ gv_player_set_station(GvPlayer *self, GvStation *station)
 		return;
 
 	if (priv->station) {
+		gv_station_cancel_playlist_download(priv->station);
 		g_signal_handlers_disconnect_by_data(priv->station, self);
 		g_object_unref(priv->station);
 		priv->station = NULL;
+		g_clear_pointer(&priv->stream_uri, g_free);
 	}
 
 	if (station) {
 		priv->station = g_object_ref_sink(station);
 		g_signal_connect_object(priv->station, "notify", G_CALLBACK(on_station_notify), self, 0);
+		g_signal_connect_object(priv->station, "playlist-downloaded",
+					G_CALLBACK(on_station_playlist_downloaded), self, 0);
 	}
 
 	g_object_notify(G_OBJECT(self), "station");
@@ -629,6 +840,21 @@ gv_player_get_property(GObject *object,
 	case PROP_PIPELINE_STRING:
 		g_value_set_string(value, gv_player_get_pipeline_string(self));
 		break;
+	case PROP_RACE_STREAMS:
+		g_value_set_boolean(value, gv_player_get_race_streams(self));
+		break;
+	case PROP_STANDBY_BUDGET:
+		g_value_set_uint(value, gv_player_get_standby_budget(self));
+		break;
+	case PROP_CROSSFADE_DURATION:
+		g_value_set_uint(value, gv_player_get_crossfade_duration(self));
+		break;
+	case PROP_ADAPTIVE_BUFFERING:
+		g_value_set_boolean(value, gv_player_get_adaptive_buffering(self));
+		break;
+	case PROP_TIMESHIFT_DURATION:
+		g_value_set_uint(value, gv_player_get_timeshift_duration(self));
+		break;
 	case PROP_PLAYBACK_STATE:
 		g_value_set_enum(value, gv_player_get_playback_state(self));
 		break;
@@ -688,6 +914,21 @@ gv_player_set_property(GObject *object,
 	case PROP_PIPELINE_STRING:
 		gv_player_set_pipeline_string(self, g_value_get_string(value));
 		break;
+	case PROP_RACE_STREAMS:
+		gv_player_set_race_streams(self, g_value_get_boolean(value));
+		break;
+	case PROP_STANDBY_BUDGET:
+		gv_player_set_standby_budget(self, g_value_get_uint(value));
+		break;
+	case PROP_CROSSFADE_DURATION:
+		gv_player_set_crossfade_duration(self, g_value_get_uint(value));
+		break;
+	case PROP_ADAPTIVE_BUFFERING:
+		gv_player_set_adaptive_buffering(self, g_value_get_boolean(value));
+		break;
+	case PROP_TIMESHIFT_DURATION:
+		gv_player_set_timeshift_duration(self, g_value_get_uint(value));
+		break;
 	case PROP_REPEAT:
 		gv_player_set_repeat(self, g_value_get_boolean(value));
 		break;
@@ -721,8 +962,37 @@ gv_player_stop(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_STOP;
 
-	/* Stop playing */
+	/* Stop resolving the station, in case it's in progress */
+	if (priv->station)
+		gv_station_cancel_playlist_download(priv->station);
+
+	/* Stop playing, and stop prerolling */
 	gv_engine_stop(priv->engine);
+	gv_engine_set_standby_stations(priv->engine, NULL, NULL);
+	g_clear_pointer(&priv->stream_uri, g_free);
+}
+
+/* Pause if the station is played from memory, otherwise stop */
+void
+gv_player_pause(GvPlayer *self)
+{
+	GvPlayerPrivate *priv = self->priv;
+
+	if (gv_engine_get_seekable(priv->engine) == FALSE) {
+		gv_player_stop(self);
+		return;
+	}
+
+	gv_engine_pause(priv->engine);
+}
+
+/* Move within what's in memory, position is in milliseconds */
+void
+gv_player_seek(GvPlayer *self, gint64 position)
+{
+	GvPlayerPrivate *priv = self->priv;
+
+	gv_engine_seek(priv->engine, position);
 }
 
 void
@@ -748,8 +1018,14 @@ gv_player_play(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_PLAY;
 
-	/* Stop playing */
-	gv_engine_stop(priv->engine);
+	/* If the station is paused, pick up where it was */
+	if (gv_engine_get_state(priv->engine) == GV_ENGINE_STATE_PAUSED &&
+	    gv_engine_get_station(priv->engine) == station) {
+		gv_engine_resume(priv->engine);
+		return;
+	}
+
+	g_clear_pointer(&priv->stream_uri, g_free);
 
 	/* Get station data */
 	uris = gv_station_get_stream_uris(station);
@@ -758,6 +1034,9 @@ gv_player_play(GvPlayer *self)
 	 * points to a playlist, and we need to download it.
 	 */
 	if (uris == NULL) {
+		/* Stop playing */
+		gv_engine_stop(priv->engine);
+
 		/* Download the playlist that contains the stream URIs */
 		if (!gv_station_download_playlist(station))
 			WARNING("Can't download playlist");
@@ -767,8 +1046,11 @@ gv_player_play(GvPlayer *self)
 		 */
 		return;
 	} else {
-		/* Play the station */
+		/* Play the station. There's no need to stop the engine
+		 * beforehand, it might crossfade from the station being played.
+		 */
 		gv_engine_play(priv->engine, station);
+		priv->stream_uri = g_strdup(gv_station_get_first_stream_uri(station));
 	}
 }
 
@@ -820,7 +1102,10 @@ gv_player_toggle(GvPlayer *self)
 		gv_player_play(self);
 		break;
 	case GV_PLAYER_WISH_TO_PLAY:
-		gv_player_stop(self);
+		if (gv_engine_get_state(priv->engine) == GV_ENGINE_STATE_PAUSED)
+			gv_player_play(self);
+		else
+			gv_player_pause(self);
 		break;
 	default:
 		ERROR("Invalid wish: %d", priv->wish);
@@ -896,6 +1181,16 @@ gv_player_configure(GvConfigurable *configurable)
 			self, "pipeline-enabled", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "pipeline-string",
 			self, "pipeline-string", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "race-streams",
+			self, "race-streams", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "standby-budget",
+			self, "standby-budget", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "crossfade-duration",
+			self, "crossfade-duration", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "adaptive-buffering",
+			self, "adaptive-buffering", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "timeshift-duration",
+			self, "timeshift-duration", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "volume",
 			self, "volume", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "mute",
@@ -931,6 +1226,7 @@ gv_player_finalize(GObject *object)
 	/* Unref the current station */
 	if (priv->station)
 		g_object_unref(priv->station);
+	g_free(priv->stream_uri);
 
 	/* Unref the station list */
 	g_object_unref(priv->station_list);
@@ -1030,6 +1326,31 @@ gv_player_class_init(GvPlayerClass *class)
 				    NULL,
 				    GV_PARAM_READWRITE);
 
+	properties[PROP_RACE_STREAMS] =
+		g_param_spec_boolean("race-streams", "Race stream uris", NULL,
+				     FALSE,
+				     GV_PARAM_READWRITE);
+
+	properties[PROP_STANDBY_BUDGET] =
+		g_param_spec_uint("standby-budget", "Standby budget in kilobytes", NULL,
+				  0, 1024 * 1024, 0,
+				  GV_PARAM_READWRITE);
+
+	properties[PROP_CROSSFADE_DURATION] =
+		g_param_spec_uint("crossfade-duration", "Crossfade duration in milliseconds", NULL,
+				  0, 10000, 0,
+				  GV_PARAM_READWRITE);
+
+	properties[PROP_ADAPTIVE_BUFFERING] =
+		g_param_spec_boolean("adaptive-buffering", "Adaptive buffering", NULL,
+				     TRUE,
+				     GV_PARAM_READWRITE);
+
+	properties[PROP_TIMESHIFT_DURATION] =
+		g_param_spec_uint("timeshift-duration", "Timeshift duration in minutes", NULL,
+				  0, 60, 0,
+				  GV_PARAM_READWRITE);
+
 	/* Player properties */
 	properties[PROP_PLAYBACK_STATE] =
 		g_param_spec_enum("playback-state", "Playback state", NULL,
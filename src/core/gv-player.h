@@ -24,6 +24,7 @@
 
 #include "core/gv-engine.h"
 #include "core/gv-metadata.h"
+#include "core/gv-playlist.h"
 #include "core/gv-station.h"
 #include "core/gv-station-list.h"
 #include "core/gv-streaminfo.h"
@@ -40,11 +41,22 @@ typedef enum {
 	GV_PLAYBACK_STATE_STOPPED,
 	GV_PLAYBACK_STATE_CONNECTING,
 	GV_PLAYBACK_STATE_BUFFERING,
-	GV_PLAYBACK_STATE_PLAYING
+	GV_PLAYBACK_STATE_PLAYING,
+	GV_PLAYBACK_STATE_PAUSED
 } GvPlaybackState;
 
 const gchar *gv_playback_state_to_string(GvPlaybackState);
 
+/* Outcome of the playlist downloads */
+typedef struct {
+	guint n_resolved;
+	guint n_failed;
+	guint n_timed_out;
+	guint n_cancelled;
+	GvPlaylistStatus last_status;
+	guint last_time; /* milliseconds */
+} GvPlaylistStats;
+
 /* Methods */
 
 GvPlayer *gv_player_new   (GvEngine *engine, GvStationList *station_list);
@@ -53,7 +65,9 @@ void      gv_player_go    (GvPlayer *self, const gchar *string_to_play);
 
 void      gv_player_play  (GvPlayer *self);
 void      gv_player_stop  (GvPlayer *self);
+void      gv_player_pause (GvPlayer *self);
 void      gv_player_toggle(GvPlayer *self);
+void      gv_player_seek  (GvPlayer *self, gint64 position);
 gboolean  gv_player_prev  (GvPlayer *self);
 gboolean  gv_player_next  (GvPlayer *self);
 
@@ -63,6 +77,11 @@ GvPlaybackState  gv_player_get_playback_state       (GvPlayer *self);
 guint          gv_player_get_bitrate     (GvPlayer *self);
 GvStreaminfo  *gv_player_get_streaminfo  (GvPlayer *self);
 GvMetadata    *gv_player_get_metadata    (GvPlayer *self);
+const GvPlaylistStats *gv_player_get_playlist_stats(GvPlayer *self);
+const GvEngineStats   *gv_player_get_engine_stats  (GvPlayer *self);
+gboolean       gv_player_get_seekable    (GvPlayer *self);
+gint64         gv_player_get_position    (GvPlayer *self);
+gint64         gv_player_get_live_position(GvPlayer *self);
 
 GvStation   *gv_player_get_station            (GvPlayer *self);
 GvStation   *gv_player_get_prev_station       (GvPlayer *self);
@@ -89,3 +108,13 @@ gboolean     gv_player_get_pipeline_enabled(GvPlayer *self);
 void         gv_player_set_pipeline_enabled(GvPlayer *self, gboolean enabled);
 const gchar *gv_player_get_pipeline_string (GvPlayer *self);
 void         gv_player_set_pipeline_string (GvPlayer *self, const gchar *pipeline);
+gboolean     gv_player_get_race_streams    (GvPlayer *self);
+void         gv_player_set_race_streams    (GvPlayer *self, gboolean race);
+guint        gv_player_get_standby_budget  (GvPlayer *self);
+void         gv_player_set_standby_budget  (GvPlayer *self, guint budget);
+guint        gv_player_get_crossfade_duration(GvPlayer *self);
+void         gv_player_set_crossfade_duration(GvPlayer *self, guint duration);
+gboolean     gv_player_get_adaptive_buffering(GvPlayer *self);
+void         gv_player_set_adaptive_buffering(GvPlayer *self, gboolean adaptive);
+guint        gv_player_get_timeshift_duration(GvPlayer *self);
+void         gv_player_set_timeshift_duration(GvPlayer *self, guint duration);
@@ -36,6 +36,7 @@
 #include "base/glib-object-additions.h"
 #include "base/gv-base.h"
 
+#include "core/gv-core-internal.h"
 #include "core/gv-playlist.h"
 
 // WISHED Test with a lot, really a lot of different stations.
@@ -65,6 +66,7 @@ static GParamSpec *properties[PROP_N];
  */
 
 enum {
+	SIGNAL_FIRST_STREAM_FOUND,
 	SIGNAL_DOWNLOADED,
 	/* Number of signals */
 	SIGNAL_N
@@ -76,10 +78,36 @@ static guint signals[SIGNAL_N];
  * GObject definitions
  */
 
+struct _PlaylistParser;
+
 struct _GvPlaylistPrivate {
 	gchar *uri;
 	GvPlaylistFormat format;
 	GSList *streams;
+	/* Outcome of the last download */
+	GvPlaylistStatus status;
+	gint64 elapsed_time;
+	/* Download in progress */
+	SoupSession *session;
+	SoupMessage *msg;
+	gint64 start_time;
+	guint timeout_id;
+	gboolean timed_out;
+	gboolean cancelled;
+	GString *sniffed;
+	struct _PlaylistParser *parser;
+	gsize body_size;
+	gboolean too_large;
+	gboolean first_stream_found;
+	gboolean is_stream;
+	/* Nested playlists */
+	guint depth;
+	gint64 deadline;
+	gboolean insecure;
+	gchar *user_agent;
+	GHashTable *visited;
+	GHashTable *nested;
+	GSList *children;
 };
 
 typedef struct _GvPlaylistPrivate GvPlaylistPrivate;
@@ -94,299 +122,1094 @@ struct _GvPlaylist {
 G_DEFINE_TYPE_WITH_PRIVATE(GvPlaylist, gv_playlist, G_TYPE_OBJECT)
 
 /*
- * Helpers
+ * Stream cache
+ */
+
+/* The stream uris found in a playlist are cached on disk, along with
+ * the HTTP metadata needed to revalidate the playlist (ETag,
+ * Last-Modified and max-age). This way a station can start playing
+ * right away at startup, while the playlist is revalidated in the
+ * background.
+ *
+ * The cache is a key file, each group being a playlist uri. The stream
+ * that works best is also saved there, so that it's tried first.
  */
 
-typedef GSList *(*PlaylistParser)(const gchar *, gsize);
+#define STREAM_CACHE_FILE "playlists.cache"
 
-/* Parse a M3U playlist, which is a simple text file,
- * each line being an uri.
- * https://en.wikipedia.org/wiki/M3U
+/* How long we remember that a uri is an audio stream, in seconds */
+#define STREAM_CACHE_STREAM_MAX_AGE (24 * 60 * 60)
+
+static GKeyFile *stream_cache;
+
+static GKeyFile *
+stream_cache_get(void)
+{
+	if (stream_cache == NULL)
+		stream_cache = gv_load_app_user_cache_key_file(STREAM_CACHE_FILE);
+
+	return stream_cache;
+}
+
+static void
+stream_cache_save(void)
+{
+	gv_save_app_user_cache_key_file(stream_cache, STREAM_CACHE_FILE);
+}
+
+static void
+stream_cache_set_header(GKeyFile *cache, const gchar *uri, const gchar *key,
+			SoupMessageHeaders *headers, const gchar *name,
+			gboolean keep)
+{
+	const gchar *value;
+
+	value = soup_message_headers_get_one(headers, name);
+	if (value)
+		g_key_file_set_string(cache, uri, key, value);
+	else if (!keep)
+		g_key_file_remove_key(cache, uri, key, NULL);
+}
+
+/* Store the streams of a playlist, with the freshness metadata found in
+ * the response headers. For a revalidation (ie. a 304 response), the
+ * validators that are not part of the response are kept.
+ */
+static void
+stream_cache_store(const gchar *uri, GSList *streams,
+		   SoupMessageHeaders *headers, gboolean revalidated)
+{
+	GKeyFile *cache = stream_cache_get();
+	const gchar *cache_control;
+	gboolean no_store = FALSE;
+	gint64 max_age = 0;
+	const gchar **strv;
+	GSList *item;
+	guint i;
+
+	if (!gv_is_key_file_group_valid(uri))
+		return;
+
+	cache_control = soup_message_headers_get_list(headers, "Cache-Control");
+	if (cache_control) {
+		GHashTable *params;
+		const gchar *value;
+
+		params = soup_header_parse_param_list(cache_control);
+		no_store = g_hash_table_contains(params, "no-store");
+		value = g_hash_table_lookup(params, "max-age");
+		if (value)
+			max_age = MAX(g_ascii_strtoll(value, NULL, 10), 0);
+		soup_header_free_param_list(params);
+	}
+
+	if (no_store) {
+		if (g_key_file_remove_group(cache, uri, NULL))
+			stream_cache_save();
+		return;
+	}
+
+	strv = g_new0(const gchar *, g_slist_length(streams) + 1);
+	for (i = 0, item = streams; item; i++, item = item->next)
+		strv[i] = item->data;
+	g_key_file_set_string_list(cache, uri, "streams", strv, i);
+	g_free(strv);
+
+	stream_cache_set_header(cache, uri, "etag", headers, "ETag", revalidated);
+	stream_cache_set_header(cache, uri, "last-modified", headers, "Last-Modified", revalidated);
+	g_key_file_set_int64(cache, uri, "expires",
+			     g_get_real_time() / G_USEC_PER_SEC + max_age);
+
+	stream_cache_save();
+}
+
+/* Remember that a uri is not a playlist, but the stream itself. Audio
+ * streams don't come with useful validators, the outcome is simply kept
+ * for a while.
  */
+static void
+stream_cache_store_stream(const gchar *uri)
+{
+	GKeyFile *cache = stream_cache_get();
+	const gchar *strv[] = { uri, NULL };
+
+	if (!gv_is_key_file_group_valid(uri))
+		return;
+
+	g_key_file_set_string_list(cache, uri, "streams", strv, 1);
+	g_key_file_remove_key(cache, uri, "etag", NULL);
+	g_key_file_remove_key(cache, uri, "last-modified", NULL);
+	g_key_file_set_int64(cache, uri, "expires",
+			     g_get_real_time() / G_USEC_PER_SEC + STREAM_CACHE_STREAM_MAX_AGE);
+
+	stream_cache_save();
+}
 
+/* Get the streams of a playlist as they were found in the playlist,
+ * ie. nested playlists are not resolved.
+ */
 static GSList *
-parse_playlist_m3u(const gchar *text, gsize text_size G_GNUC_UNUSED)
+stream_cache_lookup(const gchar *uri, gboolean *fresh)
 {
+	GKeyFile *cache = stream_cache_get();
 	GSList *list = NULL;
-	const gchar *eol;
-	gchar **lines;
+	gchar **streams;
 	guint i;
 
-	/* Guess which delimiter is used to separate each lines.
-	 * Traditionnaly, UNIX would only use `\n`, Windows would use `\r\n`.
-	 */
-	if (strstr(text, "\r\n"))
-		eol = "\r\n";
-	else
-		eol = "\n";
+	if (fresh)
+		*fresh = FALSE;
 
-	/* Split into different lines */
-	lines = g_strsplit(text, eol, -1);
-	if (lines == NULL) {
-		WARNING("Empty m3u playlist");
+	streams = g_key_file_get_string_list(cache, uri, "streams", NULL, NULL);
+	if (streams == NULL)
 		return NULL;
+
+	for (i = 0; streams[i]; i++)
+		list = g_slist_prepend(list, streams[i]);
+	list = g_slist_reverse(list);
+	g_free(streams);
+
+	if (fresh) {
+		gint64 expires;
+
+		expires = g_key_file_get_int64(cache, uri, "expires", NULL);
+		*fresh = expires > g_get_real_time() / G_USEC_PER_SEC;
 	}
 
-	/* Iterate on lines */
-	for (i = 0; lines[i] != NULL; i++) {
-		gchar *line = lines[i];
+	return list;
+}
+
+/*
+ * Helpers
+ */
+
+#define UTF8_BOM "\xef\xbb\xbf"
 
-		/* Remove leading & trailing whitespaces */
-		line = g_strstrip(line);
+/* How many bytes are looked at to detect the format */
+#define SNIFF_LENGTH 512
 
-		/* Ignore emtpy lines and comments */
-		if (line[0] == '\0' || line[0] == '#')
-			continue;
+/* Playlists larger than that are truncated */
+#define PLAYLIST_MAX_SIZE (1024 * 1024)
+
+/* Time budget for a download, in milliseconds. For nested playlists,
+ * it's the budget for the whole resolution.
+ */
+#define PLAYLIST_TIMEOUT 3000
+
+/* How deep nested playlists are resolved */
+#define PLAYLIST_MAX_DEPTH 4
+
+static void
+free_stream_list(GSList *list)
+{
+	g_slist_free_full(list, g_free);
+}
+
+static gboolean
+is_stream_content_type(const gchar *content_type)
+{
+	return g_str_has_prefix(content_type, "audio/") ||
+	       g_str_has_prefix(content_type, "video/") ||
+	       !g_ascii_strcasecmp(content_type, "application/ogg");
+}
+
+static gboolean
+is_playlist_uri(const gchar *uri)
+{
+	return gv_playlist_get_format(uri) != GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+/* Get the streams of a playlist from the cache, with nested playlists
+ * resolved from the cache as well. Nested playlists that are not in
+ * the cache are dropped, and the result is not fresh.
+ */
+static GSList *
+cache_lookup_nested(const gchar *uri, guint depth, GHashTable *visited, gboolean *fresh)
+{
+	GSList *list, *item, *result = NULL;
+
+	list = stream_cache_lookup(uri, fresh);
 
-		/* If it's not an URI, we discard it */
-		if (!strstr(line, "://"))
+	for (item = list; item; item = item->next) {
+		gchar *stream = item->data;
+		GSList *nested;
+		gboolean nested_fresh;
+
+		if (!is_playlist_uri(stream)) {
+			result = g_slist_prepend(result, stream);
 			continue;
+		}
+
+		if (depth < PLAYLIST_MAX_DEPTH &&
+		    g_hash_table_add(visited, g_strdup(stream))) {
+			nested = cache_lookup_nested(stream, depth + 1, visited, &nested_fresh);
+			if (nested == NULL && fresh)
+				*fresh = FALSE;
+			else if (fresh)
+				*fresh = *fresh && nested_fresh;
+			result = g_slist_concat(g_slist_reverse(nested), result);
+		}
 
-		/* Add to stream list */
-		list = g_slist_append(list, g_strdup(line));
+		g_free(stream);
 	}
 
-	g_strfreev(lines);
-	return list;
+	g_slist_free(list);
+
+	return g_slist_reverse(result);
+}
+
+/* Get the next line of a text buffer, without leading and trailing
+ * whitespaces. Both `\n` and `\r\n` delimiters are handled, and the
+ * buffer doesn't need to be nul-terminated.
+ */
+static gboolean
+next_line(const gchar **ptr, const gchar *end, const gchar **line, gsize *line_len)
+{
+	const gchar *start = *ptr;
+	const gchar *eol, *stop;
+
+	if (start >= end)
+		return FALSE;
+
+	eol = memchr(start, '\n', end - start);
+	stop = eol ? eol : end;
+	*ptr = eol ? eol + 1 : end;
+
+	while (start < stop && g_ascii_isspace(*start))
+		start++;
+	while (stop > start && g_ascii_isspace(stop[-1]))
+		stop--;
+
+	*line = start;
+	*line_len = stop - start;
+
+	return TRUE;
+}
+
+static const gchar *
+skip_bom(const gchar *text, gsize *text_size)
+{
+	gsize bom_len = strlen(UTF8_BOM);
+
+	if (*text_size >= bom_len && !memcmp(text, UTF8_BOM, bom_len)) {
+		*text_size -= bom_len;
+		return text + bom_len;
+	}
+
+	return text;
+}
+
+static gboolean
+has_prefix_ci(const gchar *text, gsize text_size, const gchar *prefix)
+{
+	gsize len = strlen(prefix);
+
+	return text_size >= len && !g_ascii_strncasecmp(text, prefix, len);
+}
+
+static gboolean
+contains_ci(const gchar *text, gsize text_size, const gchar *needle)
+{
+	gsize len = strlen(needle);
+	gsize i;
+
+	for (i = 0; i + len <= text_size; i++)
+		if (!g_ascii_strncasecmp(text + i, needle, len))
+			return TRUE;
+
+	return FALSE;
+}
+
+/*
+ * Incremental parser
+ */
+
+/* The parser is fed with chunks of data as they're downloaded, so that
+ * the first stream can be used before the whole playlist is there.
+ * Line-based formats (m3u and pls) keep the last incomplete line until
+ * more data comes in, XML formats (asx and xspf) rely on GMarkup, which
+ * can parse a document chunk by chunk.
+ */
+
+struct _PlsEntry {
+	guint64 index;
+	guint position;
+	gchar *uri;
+};
+
+typedef struct _PlsEntry PlsEntry;
+
+struct _PlaylistParser {
+	GvPlaylistFormat format;
+	/* Line-based formats */
+	gboolean bom_checked;
+	GString *pending;
+	GArray *pls_entries;
+	/* XML formats */
+	GMarkupParseContext *markup;
+	gboolean markup_failed;
+	/* Streams found, in reverse order */
+	GSList *streams;
+	/* First stream found */
+	const gchar *first_stream;
+};
+
+typedef struct _PlaylistParser PlaylistParser;
+
+static void
+playlist_parser_add_stream(PlaylistParser *parser, gchar *uri)
+{
+	if (parser->first_stream == NULL)
+		parser->first_stream = uri;
+
+	parser->streams = g_slist_prepend(parser->streams, uri);
+}
+
+/* Parse a M3U playlist, which is a simple text file,
+ * each line being an uri.
+ * https://en.wikipedia.org/wiki/M3U
+ */
+
+static void
+m3u_parse_line(PlaylistParser *parser, const gchar *line, gsize len)
+{
+	/* Ignore emtpy lines and comments */
+	if (len == 0 || line[0] == '#')
+		return;
+
+	/* If it's not an URI, we discard it */
+	if (!g_strstr_len(line, len, "://"))
+		return;
+
+	/* Add to stream list */
+	playlist_parser_add_stream(parser, g_strndup(line, len));
 }
 
 /* Parse a PLS playlist, which is a "Desktop Entry File" in the Unix world,
- * or an "INI File" in the windows realm.
+ * or an "INI File" in the windows realm. We're only interested in the
+ * `FileN=uri` entries, which are sorted by their number N.
  * https://en.wikipedia.org/wiki/PLS_(file_format)
  */
 
-static guint
-pls_get_n_items(GKeyFile *keyfile)
+static gint
+pls_entry_compare(gconstpointer a, gconstpointer b)
 {
-	const gchar *keys[] = { "NumberOfEntries", "numberofentries",
-				"NumberOfEvents", "numberofevents",
-				NULL };
-	const gchar **ptr;
-	const gchar *key = NULL;
-	GError *err = NULL;
-	gint n_items;
+	const PlsEntry *entry_a = a;
+	const PlsEntry *entry_b = b;
+
+	if (entry_a->index < entry_b->index)
+		return -1;
+	if (entry_a->index > entry_b->index)
+		return 1;
+	return (gint) entry_a->position - (gint) entry_b->position;
+}
+
+static void
+pls_parse_line(PlaylistParser *parser, const gchar *line, gsize len)
+{
+	GArray *entries = parser->pls_entries;
+	const gchar *eq, *value;
+	gchar *index_end;
+	PlsEntry entry;
+
+	/* We want 'File<N>=<uri>' */
+	if (!has_prefix_ci(line, len, "file"))
+		return;
+
+	eq = memchr(line, '=', len);
+	if (eq == NULL)
+		return;
+
+	entry.index = g_ascii_strtoull(line + 4, &index_end, 10);
+	if (index_end == line + 4)
+		return;
+	while (index_end < eq && g_ascii_isspace(*index_end))
+		index_end++;
+	if (index_end != eq)
+		return;
+
+	value = eq + 1;
+	while (value < line + len && g_ascii_isspace(*value))
+		value++;
+	if (value == line + len)
+		return;
+
+	entry.position = entries->len;
+	entry.uri = g_strndup(value, line + len - value);
+	g_array_append_val(entries, entry);
+
+	if (parser->first_stream == NULL)
+		parser->first_stream = entry.uri;
+}
+
+static GSList *
+pls_take_streams(PlaylistParser *parser)
+{
+	GArray *entries = parser->pls_entries;
+	GSList *list = NULL;
+	guint i;
+
+	if (entries->len == 0)
+		WARNING("No entries in pls playlist");
+
+	/* Sort by index, then by order of appearance */
+	g_array_sort(entries, pls_entry_compare);
+
+	for (i = entries->len; i > 0; i--) {
+		PlsEntry *entry = &g_array_index(entries, PlsEntry, i - 1);
+		list = g_slist_prepend(list, entry->uri);
+	}
+
+	g_array_set_size(entries, 0);
+
+	return list;
+}
+
+/* Parse an ASX (Advanced Stream Redirector) playlist.
+ * https://en.wikipedia.org/wiki/Advanced_Stream_Redirector
+ */
+
+static void
+asx_parse_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
+		     const gchar *element_name,
+		     const gchar **attribute_names,
+		     const gchar **attribute_values,
+		     gpointer user_data,
+		     GError **err G_GNUC_UNUSED)
+{
+	PlaylistParser *parser = user_data;
+	const gchar *href;
+	guint i;
+
+	/* We're only interested in the 'ref' element */
+	if (g_ascii_strcasecmp(element_name, "ref"))
+		return;
 
-	for (ptr = keys; *ptr; ptr++) {
-		if (g_key_file_has_key(keyfile, "playlist", *ptr, NULL)) {
-			key = *ptr;
+	/* Get 'href' attribute */
+	href = NULL;
+	for (i = 0; attribute_names[i]; i++) {
+		if (!g_ascii_strcasecmp(attribute_names[i], "href")) {
+			href = attribute_values[i];
 			break;
 		}
 	}
 
-	if (key == NULL) {
-		WARNING("Failed to get the number of items in pls playlist");
-		return 0;
+	/* Add to stream list */
+	if (href)
+		playlist_parser_add_stream(parser, g_strdup(href));
+}
+
+/* Parse an XSPF (XML Shareable Playlist Format) playlist.
+ * https://en.wikipedia.org/wiki/XML_Shareable_Playlist_Format
+ */
+
+static void
+xspf_text_cb(GMarkupParseContext *context,
+	     const gchar *text,
+	     gsize text_len G_GNUC_UNUSED,
+	     gpointer user_data,
+	     GError **err G_GNUC_UNUSED)
+{
+	PlaylistParser *parser = user_data;
+	const gchar *element_name;
+
+	element_name = g_markup_parse_context_get_element(context);
+
+	/* We're only interested in the 'location' element */
+	if (g_ascii_strcasecmp(element_name, "location"))
+		return;
+
+	/* Add to stream list */
+	playlist_parser_add_stream(parser, g_strstrip(g_strdup(text)));
+}
+
+/* Parser methods */
+
+static void
+playlist_parser_parse_line(PlaylistParser *parser, const gchar *line, gsize len)
+{
+	/* Skip the byte order mark of the first line */
+	if (parser->bom_checked == FALSE) {
+		line = skip_bom(line, &len);
+		parser->bom_checked = TRUE;
 	}
 
-	n_items = g_key_file_get_integer(keyfile, "playlist", key, &err);
-	if (err) {
-		WARNING("Failed to get key '%s': %s", key, err->message);
-		g_error_free(err);
-		return 0;
+	if (parser->format == GV_PLAYLIST_FORMAT_M3U)
+		m3u_parse_line(parser, line, len);
+	else
+		pls_parse_line(parser, line, len);
+}
+
+static void
+playlist_parser_feed_lines(PlaylistParser *parser, const gchar *data, gsize size)
+{
+	GString *pending = parser->pending;
+	const gchar *ptr, *end, *eol, *line;
+	gsize len;
+
+	end = data + size;
+
+	/* Complete the pending line first */
+	if (pending->len > 0) {
+		eol = memchr(data, '\n', size);
+		if (eol == NULL) {
+			g_string_append_len(pending, data, size);
+			return;
+		}
+
+		g_string_append_len(pending, data, eol + 1 - data);
+		ptr = pending->str;
+		next_line(&ptr, pending->str + pending->len, &line, &len);
+		playlist_parser_parse_line(parser, line, len);
+		g_string_truncate(pending, 0);
+		data = eol + 1;
 	}
 
-	return n_items;
+	/* Parse complete lines, and keep the last one if incomplete */
+	ptr = data;
+	while (ptr < end) {
+		eol = memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			g_string_append_len(pending, ptr, end - ptr);
+			break;
+		}
+
+		next_line(&ptr, end, &line, &len);
+		playlist_parser_parse_line(parser, line, len);
+	}
 }
 
-static GSList *
-parse_playlist_pls(const gchar *text, gsize text_size)
+static void
+playlist_parser_feed_markup(PlaylistParser *parser, const gchar *data, gsize size)
 {
-	GSList *list = NULL;
-	GKeyFile *keyfile;
 	GError *err = NULL;
-	guint i, n_items;
 
-	keyfile = g_key_file_new();
+	/* GMarkup can't go on after an error */
+	if (parser->markup_failed)
+		return;
+
+	if (parser->bom_checked == FALSE) {
+		data = skip_bom(data, &size);
+		parser->bom_checked = TRUE;
+	}
 
-	/* Parse the file */
-	g_key_file_load_from_data(keyfile, text, text_size, 0, &err);
-	if (err) {
-		WARNING("Failed to parse pls playlist: %s", err->message);
+	if (!g_markup_parse_context_parse(parser->markup, data, size, &err)) {
+		WARNING("Failed to parse context: %s", err->message);
 		g_error_free(err);
-		goto end;
+		parser->markup_failed = TRUE;
+	}
+}
+
+static void
+playlist_parser_feed(PlaylistParser *parser, const gchar *data, gsize size)
+{
+	if (size == 0)
+		return;
+
+	if (parser->markup)
+		playlist_parser_feed_markup(parser, data, size);
+	else
+		playlist_parser_feed_lines(parser, data, size);
+}
+
+/* Get the first stream found so far, or NULL */
+static const gchar *
+playlist_parser_peek_first_stream(PlaylistParser *parser)
+{
+	return parser->first_stream;
+}
+
+/* Parse the remaining data, and return the list of streams found */
+static GSList *
+playlist_parser_finish(PlaylistParser *parser)
+{
+	GSList *list;
+
+	/* The last line might not be terminated */
+	if (parser->pending && parser->pending->len > 0) {
+		const gchar *ptr, *line;
+		gsize len;
+
+		ptr = parser->pending->str;
+		next_line(&ptr, ptr + parser->pending->len, &line, &len);
+		playlist_parser_parse_line(parser, line, len);
+		g_string_truncate(parser->pending, 0);
+	}
+
+	if (parser->format == GV_PLAYLIST_FORMAT_PLS) {
+		list = pls_take_streams(parser);
+	} else {
+		list = g_slist_reverse(parser->streams);
+		parser->streams = NULL;
+		if (list == NULL && parser->format == GV_PLAYLIST_FORMAT_M3U)
+			WARNING("Empty m3u playlist");
+	}
+
+	parser->first_stream = NULL;
+
+	return list;
+}
+
+static void
+playlist_parser_free(PlaylistParser *parser)
+{
+	guint i;
+
+	if (parser->pls_entries) {
+		for (i = 0; i < parser->pls_entries->len; i++)
+			g_free(g_array_index(parser->pls_entries, PlsEntry, i).uri);
+		g_array_free(parser->pls_entries, TRUE);
+	}
+
+	if (parser->pending)
+		g_string_free(parser->pending, TRUE);
+
+	if (parser->markup)
+		g_markup_parse_context_free(parser->markup);
+
+	g_slist_free_full(parser->streams, g_free);
+	g_free(parser);
+}
+
+static PlaylistParser *
+playlist_parser_new(GvPlaylistFormat format)
+{
+	static const GMarkupParser asx_parser = {
+		asx_parse_element_cb,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+	};
+	static const GMarkupParser xspf_parser = {
+		NULL,
+		NULL,
+		xspf_text_cb,
+		NULL,
+		NULL,
+	};
+	PlaylistParser *parser;
+
+	parser = g_new0(PlaylistParser, 1);
+	parser->format = format;
+
+	switch (format) {
+	case GV_PLAYLIST_FORMAT_M3U:
+		parser->pending = g_string_new(NULL);
+		break;
+	case GV_PLAYLIST_FORMAT_PLS:
+		parser->pending = g_string_new(NULL);
+		parser->pls_entries = g_array_new(FALSE, FALSE, sizeof(PlsEntry));
+		break;
+	case GV_PLAYLIST_FORMAT_ASX:
+		parser->markup = g_markup_parse_context_new(&asx_parser, 0, parser, NULL);
+		break;
+	case GV_PLAYLIST_FORMAT_XSPF:
+		parser->markup = g_markup_parse_context_new(&xspf_parser, 0, parser, NULL);
+		break;
+	default:
+		WARNING("No parser for playlist format: %d", format);
+		g_free(parser);
+		return NULL;
+	}
+
+	return parser;
+}
+
+/*
+ * Signal handlers & callbacks
+ */
+
+static void
+gv_playlist_reset_download(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	if (priv->sniffed) {
+		g_string_free(priv->sniffed, TRUE);
+		priv->sniffed = NULL;
+	}
+
+	g_clear_pointer(&priv->parser, playlist_parser_free);
+	priv->body_size = 0;
+	priv->too_large = FALSE;
+	priv->first_stream_found = FALSE;
+	priv->is_stream = FALSE;
+}
+
+/* The uri didn't say it's a playlist, and the response doesn't look
+ * like one either: it's the stream itself, no need to download it.
+ */
+static void
+gv_playlist_found_stream(GvPlaylist *self, SoupMessage *msg)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	priv->is_stream = TRUE;
+	soup_session_cancel_message(priv->session, msg, SOUP_STATUS_CANCELLED);
+}
+
+static void
+gv_playlist_use_stream(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	DEBUG("Not a playlist, but a stream: %s", priv->uri);
+
+	if (priv->streams)
+		g_slist_free_full(priv->streams, g_free);
+	priv->streams = g_slist_prepend(NULL, g_strdup(priv->uri));
+	stream_cache_store_stream(priv->uri);
+	g_signal_emit(self, signals[SIGNAL_FIRST_STREAM_FOUND], 0, priv->uri);
+}
+
+/* Detect the format from the data sniffed so far, and create the parser */
+static void
+gv_playlist_start_parser(GvPlaylist *self, SoupMessage *msg)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	const gchar *content_type;
+	GvPlaylistFormat format;
+
+	/* The uri extension is just a hint, what the server sent is more
+	 * reliable. Fall back to the extension if nothing was detected.
+	 */
+	content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
+	format = gv_playlist_detect_format(content_type, priv->sniffed->str,
+					   priv->sniffed->len);
+	if (format == GV_PLAYLIST_FORMAT_UNKNOWN)
+		format = priv->format;
+	else if (format != priv->format)
+		DEBUG("Playlist format detected: %d (uri says %d)", format, priv->format);
+
+	if (format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+		g_string_free(priv->sniffed, TRUE);
+		priv->sniffed = NULL;
+		priv->is_stream = TRUE;
+		return;
+	}
+
+	priv->parser = playlist_parser_new(format);
+	if (priv->parser)
+		playlist_parser_feed(priv->parser, priv->sniffed->str, priv->sniffed->len);
+
+	g_string_free(priv->sniffed, TRUE);
+	priv->sniffed = NULL;
+}
+
+static void
+on_message_got_headers(SoupMessage *msg,
+		       GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	TRACE("%p, %p", msg, self);
+
+	/* Headers are received again after a redirection */
+	gv_playlist_reset_download(self);
+
+	/* Only the body of a successful response is a playlist */
+	if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE)
+		return;
+
+	/* If the uri didn't tell, an audio content type is enough to know
+	 * that it's a stream.
+	 */
+	if (priv->format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+		const gchar *content_type;
+
+		content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
+		if (content_type && is_stream_content_type(content_type) &&
+		    gv_playlist_detect_format(content_type, NULL, 0) == GV_PLAYLIST_FORMAT_UNKNOWN) {
+			gv_playlist_found_stream(self, msg);
+			return;
+		}
+	}
+
+	priv->sniffed = g_string_new(NULL);
+}
+
+static void
+on_message_got_chunk(SoupMessage *msg,
+		     SoupBuffer *chunk,
+		     GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	const gchar *first_stream;
+
+	/* Either not a playlist, or no parser for this format */
+	if (priv->sniffed == NULL && priv->parser == NULL)
+		return;
+
+	if (priv->is_stream)
+		return;
+
+	if (priv->too_large)
+		return;
+
+	/* Don't download too much, some servers keep the connection open */
+	priv->body_size += chunk->length;
+	if (priv->body_size > PLAYLIST_MAX_SIZE) {
+		WARNING("Playlist is larger than %u bytes, truncating", PLAYLIST_MAX_SIZE);
+		priv->too_large = TRUE;
+		soup_session_cancel_message(priv->session, msg, SOUP_STATUS_CANCELLED);
+		return;
 	}
 
-	/* Get the number of items */
-	n_items = pls_get_n_items(keyfile);
-	if (n_items == 0)
-		goto end;
+	/* Buffer data until there's enough to detect the format */
+	if (priv->sniffed) {
+		g_string_append_len(priv->sniffed, chunk->data, chunk->length);
+		if (priv->sniffed->len < SNIFF_LENGTH)
+			return;
+		gv_playlist_start_parser(self, msg);
+		if (priv->is_stream) {
+			gv_playlist_found_stream(self, msg);
+			return;
+		}
+	} else {
+		playlist_parser_feed(priv->parser, chunk->data, chunk->length);
+	}
+
+	/* Let the first stream be used while the rest of the playlist downloads */
+	if (priv->first_stream_found || priv->parser == NULL)
+		return;
+
+	first_stream = playlist_parser_peek_first_stream(priv->parser);
+	if (first_stream == NULL)
+		return;
 
-	/* Get all stream uris */
-	for (i = 0; i < n_items; i++) {
-		gchar key[8];
-		gchar *str;
+	/* A nested playlist is not something that can be played */
+	priv->first_stream_found = TRUE;
+	if (is_playlist_uri(first_stream))
+		return;
 
-		g_snprintf(key, sizeof key, "File%u", i + 1);
+	DEBUG("First stream found: %s", first_stream);
+	g_signal_emit(self, signals[SIGNAL_FIRST_STREAM_FOUND], 0, first_stream);
+}
 
-		str = g_key_file_get_string(keyfile, "playlist", key, &err);
-		if (err) {
-			WARNING("Failed to get '%s': %s", key, err->message);
-			g_error_free(err);
-			err = NULL;
-			continue;
-		}
+static gboolean
+when_timeout_expired(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
 
-		/* Add to stream list.
-		 * No need to duplicate str, it's already an allocated string.
-		 */
-		list = g_slist_append(list, str);
-	}
+	WARNING("Playlist download timed out after %u ms", PLAYLIST_TIMEOUT);
 
-end:
-	g_key_file_free(keyfile);
+	/* Nested playlists share the same deadline, they time out on
+	 * their own, there's nothing to cancel here.
+	 */
+	priv->timeout_id = 0;
+	priv->timed_out = TRUE;
+	if (priv->msg)
+		soup_session_cancel_message(priv->session, priv->msg, SOUP_STATUS_CANCELLED);
 
-	return list;
+	return G_SOURCE_REMOVE;
 }
 
-/* Parse an ASX (Advanced Stream Redirector) playlist.
- * https://en.wikipedia.org/wiki/Advanced_Stream_Redirector
+/* Replace nested playlists by the streams they contain. Those that
+ * could not be resolved are dropped, as well as duplicates.
  */
-
 static void
-asx_parse_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
-		     const gchar *element_name,
-		     const gchar **attribute_names,
-		     const gchar **attribute_values,
-		     gpointer user_data,
-		     GError **err G_GNUC_UNUSED)
+gv_playlist_flatten(GvPlaylist *self)
 {
-	GSList **llink = (GSList **) user_data;
-	const gchar *href;
-	guint i;
+	GvPlaylistPrivate *priv = self->priv;
+	GSList *item, *result = NULL;
 
-	/* We're only interested in the 'ref' element */
-	if (g_ascii_strcasecmp(element_name, "ref"))
-		return;
+	for (item = priv->streams; item; item = item->next) {
+		gchar *stream = item->data;
+		GSList *nested = NULL;
 
-	/* Get 'href' attribute */
-	href = NULL;
-	for (i = 0; attribute_names[i]; i++) {
-		if (!g_ascii_strcasecmp(attribute_names[i], "href")) {
-			href = attribute_values[i];
-			break;
+		if (!is_playlist_uri(stream)) {
+			result = g_slist_prepend(result, stream);
+			continue;
+		}
+
+		/* Removed once used, so that duplicates are dropped */
+		if (priv->nested) {
+			nested = g_slist_copy_deep(g_hash_table_lookup(priv->nested, stream),
+						   (GCopyFunc) g_strdup, NULL);
+			g_hash_table_remove(priv->nested, stream);
 		}
+		if (nested == NULL)
+			DEBUG("Dropping unresolved playlist: %s", stream);
+
+		result = g_slist_concat(g_slist_reverse(nested), result);
+		g_free(stream);
 	}
 
-	/* Add to stream list */
-	if (href)
-		*llink = g_slist_append(*llink, g_strdup(href));
+	g_slist_free(priv->streams);
+	priv->streams = g_slist_reverse(result);
 }
 
 static void
-asx_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
-	     GError *err G_GNUC_UNUSED,
-	     gpointer user_data)
+gv_playlist_complete(GvPlaylist *self)
 {
-	GSList **llink = (GSList **) user_data;
+	GvPlaylistPrivate *priv = self->priv;
+
+	/* Only playable streams are kept */
+	gv_playlist_flatten(self);
+
+	/* Sum up. The status of a cancelled download was set already. */
+	if (priv->cancelled == FALSE) {
+		if (priv->timed_out)
+			priv->status = GV_PLAYLIST_STATUS_TIMED_OUT;
+		else if (priv->streams)
+			priv->status = GV_PLAYLIST_STATUS_RESOLVED;
+		else
+			priv->status = GV_PLAYLIST_STATUS_FAILED;
+		priv->elapsed_time = g_get_monotonic_time() - priv->start_time;
+	}
+
+	DEBUG("Playlist download status: %s, %" G_GINT64_FORMAT " ms",
+	      gv_playlist_status_to_string(priv->status),
+	      priv->elapsed_time / 1000);
+
+	g_clear_handle_id(&priv->timeout_id, g_source_remove);
+	g_clear_pointer(&priv->nested, g_hash_table_unref);
+	g_clear_pointer(&priv->visited, g_hash_table_unref);
+	priv->timed_out = FALSE;
+	priv->cancelled = FALSE;
+
+	/* Emit completion signal */
+	g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
 
-	g_slist_free_full(*llink, g_free);
-	*llink = NULL;
+	/* Release the reference taken when the download started */
+	g_object_unref(self);
 }
 
-static GSList *
-parse_playlist_asx(const gchar *text, gsize text_size)
+static void
+on_child_downloaded(GvPlaylist *child,
+		    GvPlaylist *self)
 {
-	GMarkupParseContext *context;
-	GMarkupParser parser = {
-		asx_parse_element_cb,
-		NULL,
-		NULL,
-		NULL,
-		asx_error_cb,
-	};
-	GError *err = NULL;
-	GSList *list = NULL;
+	GvPlaylistPrivate *priv = self->priv;
+	GvPlaylistPrivate *child_priv = child->priv;
 
-	context = g_markup_parse_context_new(&parser, 0, &list, NULL);
+	TRACE("%p, %p", child, self);
 
-	if (!g_markup_parse_context_parse(context, text, text_size, &err)) {
-		WARNING("Failed to parse context: %s", err->message);
-		g_error_free(err);
-	}
+	if (child_priv->status == GV_PLAYLIST_STATUS_TIMED_OUT)
+		priv->timed_out = TRUE;
 
-	g_markup_parse_context_free(context);
+	g_hash_table_replace(priv->nested, g_strdup(child_priv->uri),
+			     g_slist_copy_deep(child_priv->streams,
+					       (GCopyFunc) g_strdup, NULL));
 
-	return list;
+	priv->children = g_slist_remove(priv->children, child);
+	g_signal_handlers_disconnect_by_data(child, self);
+	g_object_unref(child);
+
+	if (priv->children == NULL)
+		gv_playlist_complete(self);
 }
 
-/* Parse an XSPF (XML Shareable Playlist Format) playlist.
- * https://en.wikipedia.org/wiki/XML_Shareable_Playlist_Format
- */
+static void gv_playlist_download_with_deadline(GvPlaylist *self, gboolean insecure,
+					       const gchar *user_agent, gint64 deadline);
 
-static void
-xspf_text_cb(GMarkupParseContext *context,
-	     const gchar *text,
-	     gsize text_len G_GNUC_UNUSED,
-	     gpointer user_data,
-	     GError **err G_GNUC_UNUSED)
+/* Resolve the nested playlists, either from the cache, either by
+ * downloading them. Return TRUE if some downloads are in progress.
+ */
+static gboolean
+gv_playlist_resolve_nested(GvPlaylist *self)
 {
-	GSList **llink = (GSList **) user_data;
-	const gchar *element_name;
+	GvPlaylistPrivate *priv = self->priv;
+	GSList *item;
 
-	element_name = g_markup_parse_context_get_element(context);
+	g_assert_null(priv->nested);
+	priv->nested = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) free_stream_list);
 
-	/* We're only interested in the 'location' element */
-	if (g_ascii_strcasecmp(element_name, "location"))
-		return;
+	for (item = priv->streams; item; item = item->next) {
+		const gchar *uri = item->data;
+		GHashTable *visited;
+		GvPlaylist *child;
+		GSList *cached;
+		gboolean fresh;
 
-	/* Add to stream list */
-	*llink = g_slist_append(*llink, g_strdup(text));
-}
+		if (!is_playlist_uri(uri))
+			continue;
 
-static void
-xspf_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
-	      GError *err G_GNUC_UNUSED,
-	      gpointer user_data)
-{
-	GSList **llink = (GSList **) user_data;
+		if (priv->depth >= PLAYLIST_MAX_DEPTH) {
+			WARNING("Playlist nested too deep, ignoring: %s", uri);
+			continue;
+		}
 
-	g_slist_free_full(*llink, g_free);
-	*llink = NULL;
-}
+		if (g_hash_table_add(priv->visited, g_strdup(uri)) == FALSE) {
+			INFO("Playlist already visited, ignoring: %s", uri);
+			continue;
+		}
 
-static GSList *
-parse_playlist_xspf(const gchar *text, gsize text_size)
-{
-	GMarkupParseContext *context;
-	GMarkupParser parser = {
-		NULL,
-		NULL,
-		xspf_text_cb,
-		NULL,
-		xspf_error_cb,
-	};
-	GError *err = NULL;
-	GSList *list = NULL;
+		/* Each hop is cached on its own */
+		visited = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_add(visited, g_strdup(uri));
+		cached = cache_lookup_nested(uri, priv->depth + 1, visited, &fresh);
+		g_hash_table_unref(visited);
 
-	context = g_markup_parse_context_new(&parser, 0, &list, NULL);
+		if (fresh || priv->timed_out || priv->cancelled) {
+			DEBUG("Using cached streams for nested playlist: %s", uri);
+			g_hash_table_insert(priv->nested, g_strdup(uri), cached);
+			continue;
+		}
 
-	if (!g_markup_parse_context_parse(context, text, text_size, &err)) {
-		WARNING("Failed to parse context: %s", err->message);
-		g_error_free(err);
+		g_slist_free_full(cached, g_free);
+
+		DEBUG("Resolving nested playlist: %s", uri);
+		child = gv_playlist_new(uri);
+		child->priv->depth = priv->depth + 1;
+		child->priv->visited = g_hash_table_ref(priv->visited);
+		g_signal_connect_object(child, "downloaded",
+					G_CALLBACK(on_child_downloaded), self, 0);
+		priv->children = g_slist_prepend(priv->children, child);
+		gv_playlist_download_with_deadline(child, priv->insecure,
+						   priv->user_agent, priv->deadline);
 	}
 
-	g_markup_parse_context_free(context);
-
-	return list;
+	return priv->children != NULL;
 }
 
-/*
- * Signal handlers & callbacks
- */
-
 static void
 on_message_completed(SoupSession *session,
 		     SoupMessage *msg,
 		     GvPlaylist *self)
 {
 	GvPlaylistPrivate *priv = self->priv;
-	PlaylistParser parser;
 	GSList *item;
 
 	TRACE("%p, %p, %p", session, msg, self);
 
-	/* Check the response */
-	if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE) {
+	/* Cancelled by the user, nothing to do */
+	if (priv->cancelled) {
+		DEBUG("Playlist download cancelled");
+		goto end;
+	}
+
+	/* Not a playlist, the uri is to be played as is */
+	if (priv->is_stream) {
+		gv_playlist_use_stream(self);
+		goto end;
+	}
+
+	/* The playlist didn't change, the cached streams are still good */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		DEBUG("Playlist not modified");
+		if (priv->streams)
+			g_slist_free_full(priv->streams, g_free);
+		priv->streams = stream_cache_lookup(priv->uri, NULL);
+		if (priv->streams)
+			stream_cache_store(priv->uri, priv->streams,
+					   msg->response_headers, TRUE);
+		goto end;
+	}
+
+	/* From now on, the streams can only come from this download. The
+	 * streams of a previous download must not make it look resolved.
+	 */
+	g_slist_free_full(priv->streams, g_free);
+	priv->streams = NULL;
+
+	/* Check the response. If the playlist was too large or too slow,
+	 * the message was cancelled, but we can still use what was parsed
+	 * so far.
+	 */
+	if (priv->too_large || priv->timed_out) {
+		DEBUG("Playlist truncated");
+	} else if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE) {
 		WARNING("Failed to download playlist (%u): %s", msg->status_code, msg->reason_phrase);
 		if (!g_strcmp0(soup_status_get_phrase(msg->status_code), "SSL handshake failed")) {
 			/* XXX This is an error we can handle,  we should ask user if they
@@ -416,37 +1239,25 @@ on_message_completed(SoupSession *session,
 		DEBUG("Playlist downloaded (Content-Type: %s)", content_type);
 	}
 
-	if (msg->response_body->length == 0) {
+	if (priv->body_size == 0) {
 		WARNING("Empty playlist");
 		goto end;
 	}
 
-	//PRINT("%s", msg->response_body->data);
+	/* A small playlist might not have been enough to detect the format */
+	if (priv->sniffed)
+		gv_playlist_start_parser(self, msg);
 
-	/* Get the right parser */
-	switch (priv->format) {
-	case GV_PLAYLIST_FORMAT_M3U:
-		parser = parse_playlist_m3u;
-		break;
-	case GV_PLAYLIST_FORMAT_PLS:
-		parser = parse_playlist_pls;
-		break;
-	case GV_PLAYLIST_FORMAT_ASX:
-		parser = parse_playlist_asx;
-		break;
-	case GV_PLAYLIST_FORMAT_XSPF:
-		parser = parse_playlist_xspf;
-		break;
-	default:
-		WARNING("No parser for playlist format: %d", priv->format);
+	if (priv->is_stream) {
+		gv_playlist_use_stream(self);
 		goto end;
 	}
 
-	/* Parse */
-	if (priv->streams)
-		g_slist_free_full(priv->streams, g_free);
+	if (priv->parser == NULL)
+		goto end;
 
-	priv->streams = parser(msg->response_body->data, msg->response_body->length);
+	/* Parse what's left */
+	priv->streams = playlist_parser_finish(priv->parser);
 
 	/* Was it parsed successfully ? */
 	if (priv->streams == NULL) {
@@ -460,16 +1271,26 @@ on_message_completed(SoupSession *session,
 		DEBUG(". %s", item->data);
 	}
 
+	/* A truncated playlist is good enough to play, but it must not be
+	 * cached: it would be revalidated and served forever.
+	 */
+	if (priv->too_large == FALSE && priv->timed_out == FALSE)
+		stream_cache_store(priv->uri, priv->streams, msg->response_headers, FALSE);
+
 end:
-	// TODO Is it ok to unref that here ?
-	g_object_unref(session);
+	gv_playlist_reset_download(self);
 
 	/* msg needs not to be unreferenced. According to the doc,
 	 * it's consumed when using the queue() API.
 	 */
+	priv->msg = NULL;
+	g_clear_object(&priv->session);
 
-	/* Emit completion signal */
-	g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+	/* Some streams might be playlists, that need to be resolved */
+	if (gv_playlist_resolve_nested(self) == TRUE)
+		return;
+
+	gv_playlist_complete(self);
 }
 
 /*
@@ -502,6 +1323,19 @@ gv_playlist_get_stream_list(GvPlaylist *self)
 	return self->priv->streams;
 }
 
+GvPlaylistStatus
+gv_playlist_get_status(GvPlaylist *self)
+{
+	return self->priv->status;
+}
+
+/* Duration of the last download, in microseconds */
+gint64
+gv_playlist_get_elapsed_time(GvPlaylist *self)
+{
+	return self->priv->elapsed_time;
+}
+
 static void
 gv_playlist_get_property(GObject *object,
 			 guint property_id,
@@ -549,22 +1383,98 @@ gv_playlist_set_property(GObject *object,
  * Public methods
  */
 
-void
-gv_playlist_download(GvPlaylist *self, gboolean insecure, const gchar *user_agent)
+static void
+gv_playlist_download_with_deadline(GvPlaylist *self, gboolean insecure,
+				   const gchar *user_agent, gint64 deadline)
 {
 	GvPlaylistPrivate *priv = self->priv;
+	GKeyFile *cache = stream_cache_get();
 	SoupSession *session;
 	SoupMessage *msg;
+	gchar *etag, *last_modified;
+	gint64 now;
 
 	DEBUG("Downloading playlist '%s' (user-agent: '%s')", priv->uri, user_agent);
-	session = soup_session_new_with_options(SOUP_SESSION_SSL_STRICT, !insecure,
-						SOUP_SESSION_USER_AGENT, user_agent,
-						NULL);
+	session = gv_core_get_soup_session(insecure, user_agent);
 	msg = soup_message_new("GET", priv->uri);
 
+	/* The body is parsed as it comes, no need to accumulate it */
+	soup_message_body_set_accumulate(msg->response_body, FALSE);
+	g_signal_connect_object(msg, "got-headers", G_CALLBACK(on_message_got_headers), self, 0);
+	g_signal_connect_object(msg, "got-chunk", G_CALLBACK(on_message_got_chunk), self, 0);
+
+	/* Make it a conditional request if the streams are cached */
+	etag = g_key_file_get_string(cache, priv->uri, "etag", NULL);
+	if (etag)
+		soup_message_headers_append(msg->request_headers, "If-None-Match", etag);
+	last_modified = g_key_file_get_string(cache, priv->uri, "last-modified", NULL);
+	if (last_modified)
+		soup_message_headers_append(msg->request_headers, "If-Modified-Since", last_modified);
+	g_free(last_modified);
+	g_free(etag);
+
+	/* Nested playlists are needed to resolve the playlist */
+	priv->insecure = insecure;
+	g_free(priv->user_agent);
+	priv->user_agent = g_strdup(user_agent);
+	if (priv->visited == NULL) {
+		priv->visited = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_add(priv->visited, g_strdup(priv->uri));
+	}
+
+	/* Keep the playlist alive until the download completes */
+	g_assert_null(priv->session);
+	now = g_get_monotonic_time();
+	priv->session = g_object_ref(session);
+	priv->msg = msg;
+	priv->start_time = now;
+	priv->deadline = deadline;
+	priv->status = GV_PLAYLIST_STATUS_NONE;
+	priv->timeout_id = g_timeout_add(MAX(deadline - now, 0) / 1000,
+					 (GSourceFunc) when_timeout_expired, self);
 	soup_session_queue_message(session, msg,
 				   (SoupSessionCallback) on_message_completed,
-				   self);
+				   g_object_ref(self));
+}
+
+void
+gv_playlist_download(GvPlaylist *self, gboolean insecure, const gchar *user_agent)
+{
+	gint64 deadline;
+
+	deadline = g_get_monotonic_time() + PLAYLIST_TIMEOUT * 1000;
+	gv_playlist_download_with_deadline(self, insecure, user_agent, deadline);
+}
+
+/* Cancel the download in progress, if any. The downloaded signal might
+ * be emitted before this function returns, or later on.
+ */
+void
+gv_playlist_cancel(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	GSList *children;
+
+	if ((priv->msg == NULL && priv->children == NULL) || priv->cancelled)
+		return;
+
+	DEBUG("Cancelling playlist download '%s'", priv->uri);
+
+	priv->cancelled = TRUE;
+	priv->status = GV_PLAYLIST_STATUS_CANCELLED;
+	priv->elapsed_time = g_get_monotonic_time() - priv->start_time;
+	g_clear_handle_id(&priv->timeout_id, g_source_remove);
+
+	if (priv->msg) {
+		soup_session_cancel_message(priv->session, priv->msg, SOUP_STATUS_CANCELLED);
+		return;
+	}
+
+	/* Children are removed from the list as they complete */
+	children = g_slist_copy_deep(priv->children, (GCopyFunc) g_object_ref, NULL);
+	g_slist_foreach(children, (GFunc) gv_playlist_cancel, NULL);
+	g_slist_free_full(children, g_object_unref);
 }
 
 GvPlaylist *
@@ -585,6 +1495,11 @@ gv_playlist_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Free any allocated resources */
+	gv_playlist_reset_download(GV_PLAYLIST(object));
+	g_clear_pointer(&priv->nested, g_hash_table_unref);
+	g_clear_pointer(&priv->visited, g_hash_table_unref);
+	g_free(priv->user_agent);
+	g_slist_free_full(priv->streams, g_free);
 	g_free(priv->uri);
 
 	/* Chain up */
@@ -641,6 +1556,11 @@ gv_playlist_class_init(GvPlaylistClass *class)
 	g_object_class_install_properties(object_class, PROP_N, properties);
 
 	/* Signals */
+	signals[SIGNAL_FIRST_STREAM_FOUND] =
+		g_signal_new("first-stream-found", G_TYPE_FROM_CLASS(class),
+			     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+			     G_TYPE_NONE, 1, G_TYPE_STRING);
+
 	signals[SIGNAL_DOWNLOADED] =
 		g_signal_new("downloaded", G_TYPE_FROM_CLASS(class),
 			     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
@@ -651,6 +1571,174 @@ gv_playlist_class_init(GvPlaylistClass *class)
  * Class methods
  */
 
+const gchar *
+gv_playlist_status_to_string(GvPlaylistStatus status)
+{
+	switch (status) {
+	case GV_PLAYLIST_STATUS_NONE:
+		return "none";
+	case GV_PLAYLIST_STATUS_RESOLVED:
+		return "resolved";
+	case GV_PLAYLIST_STATUS_FAILED:
+		return "failed";
+	case GV_PLAYLIST_STATUS_TIMED_OUT:
+		return "timed-out";
+	case GV_PLAYLIST_STATUS_CANCELLED:
+		return "cancelled";
+	default:
+		return "unknown";
+	}
+}
+
+/* Sniff the format from the first bytes of a playlist */
+static GvPlaylistFormat
+format_from_data(const gchar *data, gsize size)
+{
+	const gchar *ptr, *end, *line;
+	gsize len;
+
+	ptr = skip_bom(data, &size);
+	end = ptr + size;
+	while (ptr < end && g_ascii_isspace(*ptr))
+		ptr++;
+	len = MIN((gsize) (end - ptr), SNIFF_LENGTH);
+
+	if (has_prefix_ci(ptr, len, "#EXTM3U"))
+		return GV_PLAYLIST_FORMAT_M3U;
+
+	if (has_prefix_ci(ptr, len, "[playlist]"))
+		return GV_PLAYLIST_FORMAT_PLS;
+
+	/* A XML document, look for the root element */
+	if (has_prefix_ci(ptr, len, "<")) {
+		if (contains_ci(ptr, len, "<asx"))
+			return GV_PLAYLIST_FORMAT_ASX;
+		if (contains_ci(ptr, len, "<playlist"))
+			return GV_PLAYLIST_FORMAT_XSPF;
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
+	}
+
+	/* A plain list of uris */
+	end = ptr + len;
+	if (next_line(&ptr, end, &line, &len) && g_strstr_len(line, len, "://"))
+		return GV_PLAYLIST_FORMAT_M3U;
+
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+static GvPlaylistFormat
+format_from_content_type(const gchar *content_type)
+{
+	static const struct {
+		const gchar *mime_type;
+		GvPlaylistFormat format;
+	} mime_types[] = {
+		{ "audio/x-mpegurl",               GV_PLAYLIST_FORMAT_M3U  },
+		{ "audio/mpegurl",                 GV_PLAYLIST_FORMAT_M3U  },
+		{ "application/x-mpegurl",         GV_PLAYLIST_FORMAT_M3U  },
+		{ "application/vnd.apple.mpegurl", GV_PLAYLIST_FORMAT_M3U  },
+		{ "audio/x-pn-realaudio",          GV_PLAYLIST_FORMAT_M3U  },
+		{ "audio/x-scpls",                 GV_PLAYLIST_FORMAT_PLS  },
+		{ "audio/scpls",                   GV_PLAYLIST_FORMAT_PLS  },
+		{ "video/x-ms-asf",                GV_PLAYLIST_FORMAT_ASX  },
+		{ "video/x-ms-asx",                GV_PLAYLIST_FORMAT_ASX  },
+		{ "audio/x-ms-asx",                GV_PLAYLIST_FORMAT_ASX  },
+		{ "application/xspf+xml",          GV_PLAYLIST_FORMAT_XSPF },
+	};
+	guint i;
+
+	if (content_type == NULL)
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
+
+	for (i = 0; i < G_N_ELEMENTS(mime_types); i++)
+		if (!g_ascii_strcasecmp(content_type, mime_types[i].mime_type))
+			return mime_types[i].format;
+
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+/* Detect the format of a playlist from its content, or from the
+ * Content-Type header if the content is not conclusive. Servers are
+ * not always right about the Content-Type, hence the content first.
+ */
+GvPlaylistFormat
+gv_playlist_detect_format(const gchar *content_type, const gchar *data, gsize size)
+{
+	GvPlaylistFormat fmt = GV_PLAYLIST_FORMAT_UNKNOWN;
+
+	if (data)
+		fmt = format_from_data(data, size);
+
+	if (fmt == GV_PLAYLIST_FORMAT_UNKNOWN)
+		fmt = format_from_content_type(content_type);
+
+	return fmt;
+}
+
+/* Parse a playlist in a single pass, and return the list of stream
+ * uris found, to be freed with g_slist_free_full().
+ */
+GSList *
+gv_playlist_parse(GvPlaylistFormat format, const gchar *data, gsize size)
+{
+	PlaylistParser *parser;
+	GSList *list;
+
+	parser = playlist_parser_new(format);
+	if (parser == NULL)
+		return NULL;
+
+	playlist_parser_feed(parser, data, size);
+	list = playlist_parser_finish(parser);
+	playlist_parser_free(parser);
+
+	return list;
+}
+
+/* Lookup the cached streams of a playlist, nested playlists included.
+ * The list returned must be freed with g_slist_free_full(). If the
+ * cached streams are still fresh, there's no need to download the
+ * playlist again.
+ */
+GSList *
+gv_playlist_cache_lookup(const gchar *uri, gboolean *fresh)
+{
+	GHashTable *visited;
+	GSList *list;
+
+	visited = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_add(visited, g_strdup(uri));
+	list = cache_lookup_nested(uri, 0, visited, fresh);
+	g_hash_table_unref(visited);
+
+	return list;
+}
+
+/* The stream that works best for a playlist, if any */
+gchar *
+gv_playlist_cache_get_preferred(const gchar *uri)
+{
+	GKeyFile *cache = stream_cache_get();
+
+	return g_key_file_get_string(cache, uri, "preferred", NULL);
+}
+
+void
+gv_playlist_cache_set_preferred(const gchar *uri, const gchar *stream_uri)
+{
+	GKeyFile *cache = stream_cache_get();
+
+	if (!gv_is_key_file_group_valid(uri))
+		return;
+
+	if (stream_uri)
+		g_key_file_set_string(cache, uri, "preferred", stream_uri);
+	else
+		g_key_file_remove_key(cache, uri, "preferred", NULL);
+
+	stream_cache_save();
+}
+
 GvPlaylistFormat
 gv_playlist_get_format(const gchar *uri_string)
 {
@@ -693,3 +1781,44 @@ gv_playlist_get_format(const gchar *uri_string)
 
 	return fmt;
 }
+
+/* Whether the uri might point to a playlist: either it says so, either
+ * it's a web uri that doesn't say anything, like 'listen.php?id=1'. In
+ * the latter case, only the response can tell.
+ */
+gboolean
+gv_playlist_maybe_playlist(const gchar *uri_string)
+{
+	static const gchar *const audio_extensions[] = {
+		"aac", "aacp", "flac", "m4a", "mp3", "mp4", "mpga",
+		"oga", "ogg", "opus", "wav", "wma", NULL
+	};
+	const gchar *path, *ext;
+	gboolean maybe = TRUE;
+	SoupURI *uri;
+	guint i;
+
+	if (gv_playlist_get_format(uri_string) != GV_PLAYLIST_FORMAT_UNKNOWN)
+		return TRUE;
+
+	uri = soup_uri_new(uri_string);
+	if (uri == NULL)
+		return FALSE;
+
+	if (uri->scheme != SOUP_URI_SCHEME_HTTP && uri->scheme != SOUP_URI_SCHEME_HTTPS) {
+		soup_uri_free(uri);
+		return FALSE;
+	}
+
+	path = soup_uri_get_path(uri);
+	ext = strrchr(path, '.');
+	if (ext && strchr(ext, '/') == NULL) {
+		for (i = 0; audio_extensions[i]; i++)
+			if (!g_ascii_strcasecmp(ext + 1, audio_extensions[i]))
+				maybe = FALSE;
+	}
+
+	soup_uri_free(uri);
+
+	return maybe;
+}
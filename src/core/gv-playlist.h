@@ -38,9 +38,28 @@ typedef enum {
 	GV_PLAYLIST_FORMAT_XSPF
 } GvPlaylistFormat;
 
+typedef enum {
+	GV_PLAYLIST_STATUS_NONE,
+	GV_PLAYLIST_STATUS_RESOLVED,
+	GV_PLAYLIST_STATUS_FAILED,
+	GV_PLAYLIST_STATUS_TIMED_OUT,
+	GV_PLAYLIST_STATUS_CANCELLED
+} GvPlaylistStatus;
+
 /* Class methods */
 
-GvPlaylistFormat gv_playlist_get_format(const gchar *uri);
+const gchar     *gv_playlist_status_to_string   (GvPlaylistStatus status);
+GvPlaylistFormat gv_playlist_get_format         (const gchar *uri);
+gboolean         gv_playlist_maybe_playlist     (const gchar *uri);
+GvPlaylistFormat gv_playlist_detect_format      (const gchar *content_type,
+                                                 const gchar *data,
+                                                 gsize        size);
+GSList          *gv_playlist_parse              (GvPlaylistFormat format,
+                                                 const gchar     *data,
+                                                 gsize            size);
+GSList          *gv_playlist_cache_lookup       (const gchar *uri, gboolean *fresh);
+gchar           *gv_playlist_cache_get_preferred(const gchar *uri);
+void             gv_playlist_cache_set_preferred(const gchar *uri, const gchar *stream_uri);
 
 /* Methods */
 
@@ -48,8 +67,11 @@ GvPlaylist *gv_playlist_new     (const gchar *uri);
 void        gv_playlist_download(GvPlaylist  *playlist,
                                  gboolean     insecure,
                                  const gchar *user_agent);
+void        gv_playlist_cancel  (GvPlaylist  *playlist);
 
 /* Property accessors */
 
-const gchar *gv_playlist_get_uri        (GvPlaylist *self);
-GSList      *gv_playlist_get_stream_list(GvPlaylist *playlist);
+const gchar     *gv_playlist_get_uri         (GvPlaylist *self);
+GSList          *gv_playlist_get_stream_list (GvPlaylist *playlist);
+GvPlaylistStatus gv_playlist_get_status      (GvPlaylist *playlist);
+gint64           gv_playlist_get_elapsed_time(GvPlaylist *playlist);
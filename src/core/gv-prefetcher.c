@@ -0,0 +1,637 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Resolve the playlists of the stations in the background, so that
+ * switching to a station doesn't require a playlist download, and
+ * playback can start right away.
+ *
+ * Stations are resolved at idle priority, a few at a time, and without
+ * hammering a server: there's only one download at a time per host, and
+ * a delay before the next one.
+ */
+
+#include <glib-object.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+#include "base/glib-object-additions.h"
+#include "base/gv-base.h"
+#include "core/gv-core-internal.h"
+#include "core/gv-playlist.h"
+#include "core/gv-station-list.h"
+#include "core/gv-station.h"
+
+#include "core/gv-prefetcher.h"
+
+/* How many playlists are downloaded at the same time */
+#define MAX_DOWNLOADS 2
+
+/* Delay between two downloads from the same host, in milliseconds */
+#define HOST_DELAY 1000
+
+/*
+ * Properties
+ */
+
+#define DEFAULT_ENABLED FALSE
+
+enum {
+	/* Reserved */
+	PROP_0,
+	/* Construct-only properties */
+	PROP_STATION_LIST,
+	/* Properties */
+	PROP_ENABLED,
+	/* Number of properties */
+	PROP_N
+};
+
+static GParamSpec *properties[PROP_N];
+
+/*
+ * GObject definitions
+ */
+
+struct _GvPrefetcherPrivate {
+	/* Construct-only properties */
+	GvStationList *station_list;
+	/* Properties */
+	gboolean enabled;
+	/* Stations that point to a playlist */
+	GHashTable *stations;
+	/* Stations waiting to be resolved */
+	GQueue *queue;
+	/* Stations being resolved */
+	GList *downloads;
+	/* Host -> time when the next download is allowed */
+	GHashTable *hosts;
+	guint source_id;
+	GvPrefetchStats stats;
+};
+
+typedef struct _GvPrefetcherPrivate GvPrefetcherPrivate;
+
+struct _GvPrefetcher {
+	/* Parent instance structure */
+	GObject parent_instance;
+	/* Private data */
+	GvPrefetcherPrivate *priv;
+};
+
+static void gv_prefetcher_configurable_interface_init(GvConfigurableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(GvPrefetcher, gv_prefetcher, G_TYPE_OBJECT,
+			G_ADD_PRIVATE(GvPrefetcher)
+			G_IMPLEMENT_INTERFACE(GV_TYPE_CONFIGURABLE,
+					      gv_prefetcher_configurable_interface_init))
+
+/*
+ * Helpers
+ */
+
+static gchar *
+get_host(GvStation *station)
+{
+	SoupURI *uri;
+	gchar *host;
+
+	uri = soup_uri_new(gv_station_get_uri(station));
+	if (uri == NULL)
+		return g_strdup("");
+
+	host = g_strdup(uri->host ? uri->host : "");
+	soup_uri_free(uri);
+
+	return host;
+}
+
+/*
+ * Scheduling
+ */
+
+static gboolean when_source_dispatched(GvPrefetcher *self);
+
+static void
+gv_prefetcher_schedule(GvPrefetcher *self, guint delay)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	if (priv->source_id)
+		return;
+
+	if (delay == 0)
+		priv->source_id = g_idle_add_full(G_PRIORITY_LOW,
+						  (GSourceFunc) when_source_dispatched,
+						  self, NULL);
+	else
+		priv->source_id = g_timeout_add_full(G_PRIORITY_LOW, delay,
+						     (GSourceFunc) when_source_dispatched,
+						     self, NULL);
+}
+
+static void
+gv_prefetcher_update_pending(GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	priv->stats.n_pending = g_queue_get_length(priv->queue) +
+				g_list_length(priv->downloads);
+}
+
+static void
+on_station_playlist_downloaded(GvStation *station,
+			       GvPlaylist *playlist,
+			       GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	GvPlaylistStatus status = gv_playlist_get_status(playlist);
+	gint64 *next_time;
+	gchar *host;
+
+	TRACE("%p, %p, %p", station, playlist, self);
+
+	/* A cancelled download is not an outcome, most likely the player
+	 * needs the station now and downloads the playlist itself.
+	 */
+	if (status == GV_PLAYLIST_STATUS_CANCELLED)
+		DEBUG("Prefetch cancelled: %s", gv_station_get_uri(station));
+	else if (gv_station_get_stream_uris(station))
+		priv->stats.n_resolved++;
+	else
+		priv->stats.n_failed++;
+
+	/* Leave the host alone for a while */
+	host = get_host(station);
+	next_time = g_new(gint64, 1);
+	*next_time = g_get_monotonic_time() + HOST_DELAY * 1000;
+	g_hash_table_replace(priv->hosts, host, next_time);
+
+	g_signal_handlers_disconnect_by_data(station, self);
+	priv->downloads = g_list_remove(priv->downloads, station);
+	g_object_unref(station);
+	gv_prefetcher_update_pending(self);
+
+	gv_prefetcher_schedule(self, 0);
+}
+
+/* Start downloading, return FALSE if it failed to start */
+static gboolean
+gv_prefetcher_download(GvPrefetcher *self, GvStation *station)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	gint64 *next_time;
+
+	/* Resolved in the meantime, by the player most likely */
+	if (gv_station_get_stream_uris(station)) {
+		priv->stats.n_resolved++;
+		return FALSE;
+	}
+
+	/* Being resolved by the player, starting over would cancel it */
+	if (gv_station_is_downloading_playlist(station))
+		return FALSE;
+
+	DEBUG("Prefetching: %s", gv_station_get_uri(station));
+
+	g_signal_connect_object(station, "playlist-downloaded",
+				G_CALLBACK(on_station_playlist_downloaded), self, 0);
+	if (gv_station_download_playlist(station) == FALSE) {
+		g_signal_handlers_disconnect_by_data(station, self);
+		priv->stats.n_failed++;
+		return FALSE;
+	}
+
+	/* The host is busy until the download completes */
+	next_time = g_new(gint64, 1);
+	*next_time = G_MAXINT64;
+	g_hash_table_replace(priv->hosts, get_host(station), next_time);
+
+	priv->downloads = g_list_prepend(priv->downloads, station);
+
+	return TRUE;
+}
+
+static gboolean
+when_source_dispatched(GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	gint64 now = g_get_monotonic_time();
+	gint64 wake_time = G_MAXINT64;
+	GList *link, *next;
+
+	priv->source_id = 0;
+
+	for (link = priv->queue->head; link; link = next) {
+		GvStation *station = link->data;
+		gint64 *next_time;
+		gchar *host;
+
+		next = link->next;
+
+		if (g_list_length(priv->downloads) >= MAX_DOWNLOADS)
+			break;
+
+		/* Per-host rate limit */
+		host = get_host(station);
+		next_time = g_hash_table_lookup(priv->hosts, host);
+		g_free(host);
+		if (next_time && *next_time > now) {
+			wake_time = MIN(wake_time, *next_time);
+			continue;
+		}
+
+		g_queue_delete_link(priv->queue, link);
+		if (gv_prefetcher_download(self, station) == FALSE)
+			g_object_unref(station);
+	}
+
+	gv_prefetcher_update_pending(self);
+
+	/* Come back when a host is available again. If it's busy, we'll
+	 * come back when its download completes.
+	 */
+	if (!g_queue_is_empty(priv->queue) &&
+	    g_list_length(priv->downloads) < MAX_DOWNLOADS &&
+	    wake_time != G_MAXINT64)
+		gv_prefetcher_schedule(self, (wake_time - now) / 1000 + 1);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Station queue
+ */
+
+static void
+gv_prefetcher_enqueue(GvPrefetcher *self, GvStation *station)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	const gchar *uri = gv_station_get_uri(station);
+	GSList *cached;
+	gboolean fresh;
+
+	if (uri == NULL || gv_playlist_maybe_playlist(uri) == FALSE)
+		return;
+
+	/* Each station is counted once */
+	if (g_hash_table_add(priv->stations, station) == FALSE)
+		return;
+	priv->stats.n_stations = g_hash_table_size(priv->stations);
+
+	if (gv_station_get_stream_uris(station)) {
+		priv->stats.n_resolved++;
+		return;
+	}
+
+	if (g_queue_find(priv->queue, station) || g_list_find(priv->downloads, station))
+		return;
+
+	/* Being resolved by the player already */
+	if (gv_station_is_downloading_playlist(station))
+		return;
+
+	/* Fresh streams in the cache, no need to queue. Stale ones are
+	 * left alone, the download revalidates them.
+	 */
+	cached = gv_playlist_cache_lookup(uri, &fresh);
+	g_slist_free_full(cached, g_free);
+	if (cached && fresh) {
+		gv_station_load_cached_streams(station);
+		priv->stats.n_resolved++;
+		return;
+	}
+
+	g_queue_push_tail(priv->queue, g_object_ref(station));
+	gv_prefetcher_update_pending(self);
+	gv_prefetcher_schedule(self, 0);
+}
+
+static void
+gv_prefetcher_start(GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	GvStationListIter *iter;
+	GvStation *station;
+
+	INFO("Prefetching station playlists");
+
+	memset(&priv->stats, 0, sizeof priv->stats);
+	g_hash_table_remove_all(priv->stations);
+
+	iter = gv_station_list_iter_new(priv->station_list);
+	while (gv_station_list_iter_loop(iter, &station))
+		gv_prefetcher_enqueue(self, station);
+	gv_station_list_iter_free(iter);
+}
+
+static void
+gv_prefetcher_stop(GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+	GList *downloads, *item;
+	GvStation *station;
+
+	g_clear_handle_id(&priv->source_id, g_source_remove);
+	while ((station = g_queue_pop_head(priv->queue)))
+		g_object_unref(station);
+
+	/* Stop listening first, we don't care about the outcome */
+	downloads = priv->downloads;
+	priv->downloads = NULL;
+	for (item = downloads; item; item = item->next) {
+		station = item->data;
+		g_signal_handlers_disconnect_by_data(station, self);
+		gv_station_cancel_playlist_download(station);
+	}
+	g_list_free_full(downloads, g_object_unref);
+
+	g_hash_table_remove_all(priv->hosts);
+	gv_prefetcher_update_pending(self);
+}
+
+/*
+ * Signal handlers & callbacks
+ */
+
+static void
+on_station_list_loaded(GvStationList *station_list,
+		       GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	TRACE("%p, %p", station_list, self);
+
+	if (priv->enabled == FALSE)
+		return;
+
+	gv_prefetcher_stop(self);
+	gv_prefetcher_start(self);
+}
+
+static void
+on_station_list_station_added(GvStationList *station_list,
+			      GvStation *station,
+			      GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	TRACE("%p, %p, %p", station_list, station, self);
+
+	if (priv->enabled == FALSE)
+		return;
+
+	gv_prefetcher_enqueue(self, station);
+}
+
+static void
+on_station_list_station_removed(GvStationList *station_list,
+				GvStation *station,
+				GvPrefetcher *self)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	TRACE("%p, %p, %p", station_list, station, self);
+
+	if (g_hash_table_remove(priv->stations, station))
+		priv->stats.n_stations = g_hash_table_size(priv->stations);
+
+	if (g_queue_remove(priv->queue, station)) {
+		g_object_unref(station);
+		gv_prefetcher_update_pending(self);
+	}
+}
+
+/*
+ * Property accessors
+ */
+
+static void
+gv_prefetcher_set_station_list(GvPrefetcher *self, GvStationList *station_list)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	/* This is a construct-only property */
+	g_assert_null(priv->station_list);
+	g_assert_nonnull(station_list);
+	priv->station_list = g_object_ref(station_list);
+}
+
+gboolean
+gv_prefetcher_get_enabled(GvPrefetcher *self)
+{
+	return self->priv->enabled;
+}
+
+void
+gv_prefetcher_set_enabled(GvPrefetcher *self, gboolean enabled)
+{
+	GvPrefetcherPrivate *priv = self->priv;
+
+	if (priv->enabled == enabled)
+		return;
+
+	priv->enabled = enabled;
+
+	if (enabled)
+		gv_prefetcher_start(self);
+	else
+		gv_prefetcher_stop(self);
+
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_ENABLED]);
+}
+
+const GvPrefetchStats *
+gv_prefetcher_get_stats(GvPrefetcher *self)
+{
+	return &self->priv->stats;
+}
+
+static void
+gv_prefetcher_get_property(GObject *object,
+			   guint property_id,
+			   GValue *value,
+			   GParamSpec *pspec)
+{
+	GvPrefetcher *self = GV_PREFETCHER(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_ENABLED:
+		g_value_set_boolean(value, gv_prefetcher_get_enabled(self));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void
+gv_prefetcher_set_property(GObject *object,
+			   guint property_id,
+			   const GValue *value,
+			   GParamSpec *pspec)
+{
+	GvPrefetcher *self = GV_PREFETCHER(object);
+
+	TRACE_SET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_STATION_LIST:
+		gv_prefetcher_set_station_list(self, g_value_get_object(value));
+		break;
+	case PROP_ENABLED:
+		gv_prefetcher_set_enabled(self, g_value_get_boolean(value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+/*
+ * Public methods
+ */
+
+GvPrefetcher *
+gv_prefetcher_new(GvStationList *station_list)
+{
+	return g_object_new(GV_TYPE_PREFETCHER,
+			    "station-list", station_list,
+			    NULL);
+}
+
+/*
+ * GvConfigurable interface
+ */
+
+static void
+gv_prefetcher_configure(GvConfigurable *configurable)
+{
+	GvPrefetcher *self = GV_PREFETCHER(configurable);
+
+	TRACE("%p", self);
+
+	g_assert(gv_core_settings);
+	g_settings_bind(gv_core_settings, "prefetch-enabled",
+			self, "enabled", G_SETTINGS_BIND_DEFAULT);
+}
+
+static void
+gv_prefetcher_configurable_interface_init(GvConfigurableInterface *iface)
+{
+	iface->configure = gv_prefetcher_configure;
+}
+
+/*
+ * GObject methods
+ */
+
+static void
+gv_prefetcher_finalize(GObject *object)
+{
+	GvPrefetcher *self = GV_PREFETCHER(object);
+	GvPrefetcherPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Stop prefetching */
+	gv_prefetcher_stop(self);
+	g_queue_free(priv->queue);
+	g_hash_table_destroy(priv->hosts);
+	g_hash_table_destroy(priv->stations);
+
+	/* Unref the station list */
+	g_signal_handlers_disconnect_by_data(priv->station_list, self);
+	g_object_unref(priv->station_list);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_prefetcher, object);
+}
+
+static void
+gv_prefetcher_constructed(GObject *object)
+{
+	GvPrefetcher *self = GV_PREFETCHER(object);
+	GvPrefetcherPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Ensure construct-only properties have been set */
+	g_assert_nonnull(priv->station_list);
+
+	/* Initialize properties */
+	priv->enabled = DEFAULT_ENABLED;
+
+	/* Initialize internal state */
+	priv->queue = g_queue_new();
+	priv->hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	priv->stations = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* Follow the station list */
+	g_signal_connect_object(priv->station_list, "loaded",
+				G_CALLBACK(on_station_list_loaded), self, 0);
+	g_signal_connect_object(priv->station_list, "station-added",
+				G_CALLBACK(on_station_list_station_added), self, 0);
+	g_signal_connect_object(priv->station_list, "station-removed",
+				G_CALLBACK(on_station_list_station_removed), self, 0);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_CONSTRUCTED(gv_prefetcher, object);
+}
+
+static void
+gv_prefetcher_init(GvPrefetcher *self)
+{
+	TRACE("%p", self);
+
+	/* Initialize private pointer */
+	self->priv = gv_prefetcher_get_instance_private(self);
+}
+
+static void
+gv_prefetcher_class_init(GvPrefetcherClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	TRACE("%p", class);
+
+	/* Override GObject methods */
+	object_class->finalize = gv_prefetcher_finalize;
+	object_class->constructed = gv_prefetcher_constructed;
+
+	/* Properties */
+	object_class->get_property = gv_prefetcher_get_property;
+	object_class->set_property = gv_prefetcher_set_property;
+
+	properties[PROP_STATION_LIST] =
+		g_param_spec_object("station-list", "Station list", NULL,
+				    GV_TYPE_STATION_LIST,
+				    GV_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY);
+
+	properties[PROP_ENABLED] =
+		g_param_spec_boolean("enabled", "Enabled", NULL,
+				     DEFAULT_ENABLED,
+				     GV_PARAM_READWRITE);
+
+	g_object_class_install_properties(object_class, PROP_N, properties);
+}
@@ -0,0 +1,51 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "core/gv-station-list.h"
+
+/* GObject declarations */
+
+#define GV_TYPE_PREFETCHER gv_prefetcher_get_type()
+
+G_DECLARE_FINAL_TYPE(GvPrefetcher, gv_prefetcher, GV, PREFETCHER, GObject)
+
+/* Data types */
+
+typedef struct {
+	guint n_stations; /* stations that point to a playlist */
+	guint n_pending;
+	guint n_resolved;
+	guint n_failed;
+} GvPrefetchStats;
+
+/* Methods */
+
+GvPrefetcher *gv_prefetcher_new(GvStationList *station_list);
+
+/* Property accessors */
+
+gboolean               gv_prefetcher_get_enabled(GvPrefetcher *self);
+void                   gv_prefetcher_set_enabled(GvPrefetcher *self, gboolean enabled);
+const GvPrefetchStats *gv_prefetcher_get_stats  (GvPrefetcher *self);
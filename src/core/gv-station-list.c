@@ -19,6 +19,7 @@
  */
 
 #include <errno.h>
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -29,15 +30,17 @@
 
 #include "core/gv-station-list.h"
 
-// WISHED Try with a huge number of stations to see how it behaves.
-//        It might be slow. The implementation never tried to be fast.
-
 /*
  * More defines...
  */
 
 #define SAVE_DELAY	  1		 // how long to wait before writing changes to disk
 #define STATION_LIST_FILE "stations.xml" // where to write the stations
+#define CACHE_FILE_SUFFIX ".cache"	 // binary cache, next to the station list file
+#define JOURNAL_FILE_SUFFIX ".journal"	 // journal of changes, next to the station list file
+#define JOURNAL_MAX_SIZE  65536		 // journal size that triggers a full save
+#define SEARCH_GRAM_LENGTH 3		 // length of the n-grams of the search index
+#define BATCH_DELAY	  100		 // how long a deferred batch collects changes, in ms
 
 /*
  * Properties
@@ -67,6 +70,7 @@ enum {
 	SIGNAL_STATION_REMOVED,
 	SIGNAL_STATION_MODIFIED,
 	SIGNAL_STATION_MOVED,
+	SIGNAL_STATIONS_CHANGED,
 	/* Number of signals */
 	SIGNAL_N
 };
@@ -85,14 +89,51 @@ struct _GvStationListPrivate {
 	gchar *save_path;
 	/* Timeout id, > 0 if a save operation is scheduled */
 	guint save_timeout_id;
+	/* Background save. The mutex and cond are used to wait for
+	 * the save thread, save_in_flight is protected by the mutex.
+	 * save_again is set if a save was requested while in flight.
+	 */
+	GMutex save_mutex;
+	GCond save_cond;
+	gboolean save_in_flight;
+	gboolean save_again;
+	/* Journal of changes since the last full save. It's opened only
+	 * when it's known to apply on top of the file at the save path.
+	 */
+	GOutputStream *journal;
+	gsize journal_size;
+	guint journal_n_records;
+	/* Batch of changes. Signals are deferred until the outermost
+	 * batch is committed, and so are the journal records.
+	 */
+	guint batch_depth;
+	GPtrArray *batch_changes;
+	GHashTable *batch_modified;
+	GString *batch_journal;
+	guint batch_n_records;
+	/* Timeout id, > 0 if a deferred batch is pending */
+	guint batch_timeout_id;
 	/* Set to true during object finalization */
 	gboolean finalization;
-	/* Ordered list of stations */
-	GList *stations;
-	/* Shuffled list of stations, automatically created
-	 * and destroyed when needed.
+	/* Ordered sequence of stations */
+	GSequence *stations;
+	/* Lookup indexes: station to node in the sequence,
+	 * and uid/name/uri to stations.
 	 */
-	GList *shuffled;
+	GHashTable *station_nodes;
+	GHashTable *uid_index;
+	GHashTable *name_index;
+	GHashTable *uri_index;
+	/* Search index: trigram to stations */
+	GHashTable *search_index;
+	/* Shuffle order, a permutation of the stations, automatically
+	 * created and destroyed when needed. The cursor is the position
+	 * of the current station in there, or -1 if there's none yet.
+	 */
+	GPtrArray *shuffled;
+	gint shuffle_cursor;
+	/* Live iterators that still walk the sequence */
+	GList *iters;
 };
 
 typedef struct _GvStationListPrivate GvStationListPrivate;
@@ -108,16 +149,6 @@ G_DEFINE_TYPE_WITH_CODE(GvStationList, gv_station_list, G_TYPE_OBJECT,
 			G_ADD_PRIVATE(GvStationList)
 			G_IMPLEMENT_INTERFACE(GV_TYPE_ERRORABLE, NULL))
 
-/*
- * Helpers
- */
-
-static gpointer
-copy_func_object_ref(gconstpointer src, gpointer data G_GNUC_UNUSED)
-{
-	return g_object_ref((gpointer) src);
-}
-
 /*
  * Paths helpers
  */
@@ -157,6 +188,68 @@ make_station_list_save_path(const gchar *filename)
 	return path;
 }
 
+/*
+ * Station snapshots
+ */
+
+/* A snapshot is an immutable copy of the station list, that can be
+ * handed over to another thread to be written to disk.
+ */
+
+struct _StationSnapshot {
+	gchar *uid;
+	gchar *uri;
+	gchar *name;
+	gboolean insecure;
+	gchar *user_agent;
+};
+
+typedef struct _StationSnapshot StationSnapshot;
+
+static void
+station_snapshot_free(StationSnapshot *snapshot)
+{
+	g_free(snapshot->uid);
+	g_free(snapshot->uri);
+	g_free(snapshot->name);
+	g_free(snapshot->user_agent);
+	g_free(snapshot);
+}
+
+static StationSnapshot *
+station_snapshot_new(GvStation *station)
+{
+	StationSnapshot *snapshot;
+
+	snapshot = g_new0(StationSnapshot, 1);
+	snapshot->uid = g_strdup(gv_station_get_uid(station));
+	snapshot->uri = g_strdup(gv_station_get_uri(station));
+	snapshot->name = g_strdup(gv_station_get_name(station));
+	snapshot->insecure = gv_station_get_insecure(station);
+	snapshot->user_agent = g_strdup(gv_station_get_user_agent(station));
+
+	return snapshot;
+}
+
+static GPtrArray *
+make_station_list_snapshot(GSequence *seq)
+{
+	GSequenceIter *iter;
+	GPtrArray *snapshot;
+
+	snapshot = g_ptr_array_new_full(g_sequence_get_length(seq),
+					(GDestroyNotify) station_snapshot_free);
+
+	for (iter = g_sequence_get_begin_iter(seq); !g_sequence_iter_is_end(iter);
+	     iter = g_sequence_iter_next(iter)) {
+		GvStation *station = GV_STATION(g_sequence_get(iter));
+
+		g_ptr_array_add(snapshot, station_snapshot_new(station));
+	}
+
+	return snapshot;
+}
+
 /*
  * Markup handling
  */
@@ -166,6 +259,7 @@ struct _GvMarkupParsing {
 	GList *list;
 	/* Current iteration */
 	gchar **cur;
+	gchar *uid;
 	gchar *name;
 	gchar *uri;
 	gchar *insecure;
@@ -218,6 +312,8 @@ markup_on_end_element(GMarkupParseContext *context G_GNUC_UNUSED,
 
 	/* Create a new station */
 	station = gv_station_new(parsing->name, parsing->uri);
+	if (parsing->uid)
+		gv_station_set_uid(station, parsing->uid);
 	if (!g_strcmp0(parsing->insecure, "true"))
 		gv_station_set_insecure(station, TRUE);
 	if (parsing->user_agent)
@@ -231,6 +327,7 @@ markup_on_end_element(GMarkupParseContext *context G_GNUC_UNUSED,
 
 cleanup:
 	/* Cleanup */
+	g_clear_pointer(&parsing->uid, g_free);
 	g_clear_pointer(&parsing->name, g_free);
 	g_clear_pointer(&parsing->uri, g_free);
 	g_clear_pointer(&parsing->insecure, g_free);
@@ -253,6 +350,7 @@ markup_on_start_element(GMarkupParseContext *context G_GNUC_UNUSED,
 
 	/* Entering a station node */
 	if (!g_strcmp0(element_name, "Station")) {
+		g_assert_null(parsing->uid);
 		g_assert_null(parsing->name);
 		g_assert_null(parsing->uri);
 		g_assert_null(parsing->insecure);
@@ -260,6 +358,13 @@ markup_on_start_element(GMarkupParseContext *context G_GNUC_UNUSED,
 		return;
 	}
 
+	/* Uid property */
+	if (!g_strcmp0(element_name, "uid")) {
+		g_assert_null(parsing->cur);
+		parsing->cur = &parsing->uid;
+		return;
+	}
+
 	/* Name property */
 	if (!g_strcmp0(element_name, "name")) {
 		g_assert_null(parsing->cur);
@@ -299,6 +404,7 @@ markup_on_error(GMarkupParseContext *context G_GNUC_UNUSED,
 	GvMarkupParsing *parsing = user_data;
 
 	parsing->cur = NULL;
+	g_clear_pointer(&parsing->uid, g_free);
 	g_clear_pointer(&parsing->name, g_free);
 	g_clear_pointer(&parsing->uri, g_free);
 	g_clear_pointer(&parsing->insecure, g_free);
@@ -322,6 +428,7 @@ parse_markup(const gchar *text, GList **list, GError **err)
 		NULL,
 		NULL,
 		NULL,
+		NULL,
 		NULL
 	};
 	gboolean ret;
@@ -355,12 +462,13 @@ g_string_append_markup_tag_escaped(GString *string, const gchar *tag, const gcha
 }
 
 static gchar *
-print_markup_station(GvStation *station)
+print_markup_station(StationSnapshot *station)
 {
-	const gchar *name = gv_station_get_name(station);
-	const gchar *uri = gv_station_get_uri(station);
-	const gchar *insecure = gv_station_get_insecure(station) ? "true" : NULL;
-	const gchar *user_agent = gv_station_get_user_agent(station);
+	const gchar *uid = station->uid;
+	const gchar *name = station->name;
+	const gchar *uri = station->uri;
+	const gchar *insecure = station->insecure ? "true" : NULL;
+	const gchar *user_agent = station->user_agent;
 	GString *string;
 
 	/* A station is supposed to have an uri */
@@ -384,6 +492,9 @@ print_markup_station(GvStation *station)
 	if (user_agent)
 		g_string_append_markup_tag_escaped(string, "user-agent", user_agent);
 
+	if (uid)
+		g_string_append_markup_tag_escaped(string, "uid", uid);
+
 	g_string_append(string, "  </Station>\n");
 
 	/* Return */
@@ -391,10 +502,10 @@ print_markup_station(GvStation *station)
 }
 
 static gboolean
-print_markup(GList *list, gchar **markup, GError **err)
+print_markup(GPtrArray *snapshot, gchar **markup, GError **err)
 {
-	GList *item;
 	GString *string;
+	guint i;
 
 	g_return_val_if_fail(markup != NULL, FALSE);
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
@@ -402,8 +513,8 @@ print_markup(GList *list, gchar **markup, GError **err)
 	string = g_string_new(NULL);
 	g_string_append(string, "<Stations>\n");
 
-	for (item = list; item; item = item->next) {
-		GvStation *station = GV_STATION(item->data);
+	for (i = 0; i < snapshot->len; i++) {
+		StationSnapshot *station = g_ptr_array_index(snapshot, i);
 		gchar *text;
 
 		text = print_markup_station(station);
@@ -421,250 +532,1827 @@ print_markup(GList *list, gchar **markup, GError **err)
 }
 
 /*
- * File I/O
+ * Binary cache
  */
 
-static gboolean
-load_station_list_from_string(const gchar *text, GList **list, GError **err)
+/* The binary cache is a sidecar file of the station list file. It's much
+ * faster to load than the XML: it's mapped in memory, and there's nothing
+ * to parse. It's valid as long as the station list file has the same mtime
+ * and size as when the cache was written. The XML file remains the source
+ * of truth, the cache can be deleted at any time.
+ *
+ * The cache is made of a header, an array of fixed-size station records,
+ * and a string table. Strings are referred to by their offset in the string
+ * table, which starts with an empty string, so that offset 0 means NULL.
+ * Integers are stored in host byte order, a cache file that comes from
+ * another architecture won't pass the magic check.
+ */
+
+#define CACHE_MAGIC   0x4c535647 // "GVSL"
+#define CACHE_VERSION 2
+
+enum {
+	CACHE_STATION_INSECURE = 1 << 0,
+};
+
+struct _CacheHeader {
+	guint32 magic;
+	guint32 version;
+	gint64 xml_mtime;
+	guint64 xml_size;
+	guint32 n_stations;
+	guint32 strtab_size;
+};
+
+typedef struct _CacheHeader CacheHeader;
+
+struct _CacheStation {
+	guint32 uid;
+	guint32 uri;
+	guint32 name;
+	guint32 user_agent;
+	guint32 flags;
+};
+
+typedef struct _CacheStation CacheStation;
+
+static gchar *
+make_cache_path(const gchar *path)
 {
-	return parse_markup(text, list, err);
+	return g_strconcat(path, CACHE_FILE_SUFFIX, NULL);
 }
 
 static gboolean
-load_station_list_from_file(const gchar *path, GList **list, GError **err)
+get_file_mtime_and_size(const gchar *path, gint64 *mtime, guint64 *size, GError **err)
 {
-	gchar *text = NULL;
-	gboolean ret;
-
-	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+	GFile *file;
+	GFileInfo *info;
+
+	file = g_file_new_for_path(path);
+	info = g_file_query_info(file,
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+				 G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				 G_FILE_QUERY_INFO_NONE, NULL, err);
+	g_object_unref(file);
+
+	if (info == NULL)
+		return FALSE;
 
-	ret = g_file_get_contents(path, &text, NULL, err);
-	if (ret == FALSE) {
-		g_assert(err == NULL || *err != NULL);
-		goto end;
-	}
+	*mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	*mtime *= G_USEC_PER_SEC;
+	*mtime += g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	*size = g_file_info_get_size(info);
 
-	ret = load_station_list_from_string(text, list, err);
-	if (ret == FALSE) {
-		g_assert(err == NULL || *err != NULL);
-		goto end;
-	}
+	g_object_unref(info);
 
-end:
-	g_free(text);
-	return ret;
+	return TRUE;
 }
 
-static gboolean
-save_station_list_to_string(GList *list, gchar **text, GError **err)
+static guint32
+cache_strtab_add(GByteArray *strtab, const gchar *str)
 {
-	return print_markup(list, text, err);
+	guint32 offset;
+
+	if (str == NULL)
+		return 0;
+
+	offset = strtab->len;
+	g_byte_array_append(strtab, (const guint8 *) str, strlen(str) + 1);
+
+	return offset;
 }
 
 static gboolean
-save_station_list_to_file(GList *list, const gchar *path, GError **err)
+load_station_list_from_cache(const gchar *path, GList **list, GError **err)
 {
+	GMappedFile *mapped_file = NULL;
+	gchar *cache_path = NULL;
+	const gchar *data, *strtab;
+	const CacheStation *records;
+	CacheHeader header;
+	GList *stations = NULL;
+	gint64 xml_mtime;
+	guint64 xml_size;
+	gsize length;
 	gboolean ret;
-	gchar *text = NULL;
-	gchar *dirname = NULL;
+	guint i;
 
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
-	ret = save_station_list_to_string(list, &text, err);
-	if (ret == FALSE) {
-		g_assert(err == NULL || *err != NULL);
+	ret = get_file_mtime_and_size(path, &xml_mtime, &xml_size, err);
+	if (ret == FALSE)
+		goto end;
+
+	cache_path = make_cache_path(path);
+	mapped_file = g_mapped_file_new(cache_path, FALSE, err);
+	if (mapped_file == NULL) {
+		ret = FALSE;
 		goto end;
 	}
 
-	/* g_file_set_contents() doesn't work with /dev/null, due to
-	 * the way it's implemented (see documentation for details).
-	 * However it's convenient to set the save path to /dev/null
-	 * when we actually don't want to save (ie. test suite).
-	 * So we handle this special case explicitly here.
-	 */
-	if (!g_strcmp0(path, "/dev/null")) {
-		ret = TRUE;
+	data = g_mapped_file_get_contents(mapped_file);
+	length = g_mapped_file_get_length(mapped_file);
+
+	/* Validate the header */
+	ret = FALSE;
+
+	if (length < sizeof header) {
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Cache is truncated");
 		goto end;
 	}
 
-	dirname = g_path_get_dirname(path);
-	if (g_mkdir_with_parents(dirname, S_IRWXU) != 0) {
-		g_set_error(err, G_FILE_ERROR,
-			    g_file_error_from_errno(errno),
-			    "Failed to make directory: %s", g_strerror(errno));
-		ret = FALSE;
+	memcpy(&header, data, sizeof header);
+
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Cache has wrong format");
 		goto end;
 	}
 
-	ret = g_file_set_contents(path, text, -1, err);
-	if (ret == FALSE) {
-		g_assert(err == NULL || *err != NULL);
+	if (header.xml_mtime != xml_mtime || header.xml_size != xml_size) {
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_FAILED, "Cache is out of date");
+		goto end;
+	}
+
+	if ((guint64) length != sizeof header +
+	    (guint64) header.n_stations * sizeof(CacheStation) +
+	    header.strtab_size) {
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Cache has wrong size");
 		goto end;
 	}
 
+	records = (const CacheStation *) (data + sizeof header);
+	strtab = (const gchar *) (records + header.n_stations);
+
+	if (header.strtab_size == 0 || strtab[header.strtab_size - 1] != '\0') {
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Cache has invalid strings");
+		goto end;
+	}
+
+	/* Create the stations */
+	for (i = 0; i < header.n_stations; i++) {
+		const CacheStation *record = &records[i];
+		GvStation *station;
+
+		if (record->uri == 0 ||
+		    record->uid >= header.strtab_size ||
+		    record->uri >= header.strtab_size ||
+		    record->name >= header.strtab_size ||
+		    record->user_agent >= header.strtab_size) {
+			g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				    "Cache has invalid station record");
+			g_list_free_full(stations, g_object_unref);
+			goto end;
+		}
+
+		/* Discard stations with empty uri, as the XML parser does */
+		if (strtab[record->uri] == '\0')
+			continue;
+
+		station = gv_station_new(record->name ? strtab + record->name : NULL,
+					 strtab + record->uri);
+		if (record->uid)
+			gv_station_set_uid(station, strtab + record->uid);
+		if (record->flags & CACHE_STATION_INSECURE)
+			gv_station_set_insecure(station, TRUE);
+		if (record->user_agent)
+			gv_station_set_user_agent(station, strtab + record->user_agent);
+
+		/* We must take ownership right now */
+		g_object_ref_sink(station);
+
+		stations = g_list_prepend(stations, station);
+	}
+
+	*list = g_list_reverse(stations);
+	ret = TRUE;
+
 end:
-	g_free(dirname);
-	g_free(text);
+	if (mapped_file)
+		g_mapped_file_unref(mapped_file);
+	g_free(cache_path);
+	return ret;
+}
+
+static gboolean
+save_station_list_to_cache(GPtrArray *snapshot, const gchar *path, GError **err)
+{
+	GByteArray *records, *strtab, *data;
+	CacheHeader header;
+	gchar *cache_path;
+	gint64 xml_mtime;
+	guint64 xml_size;
+	guint n_stations;
+	gboolean ret;
+	guint i;
+
+	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+	/* The cache is bound to the file that was just written */
+	ret = get_file_mtime_and_size(path, &xml_mtime, &xml_size, err);
+	if (ret == FALSE)
+		return FALSE;
+
+	/* Serialize stations, the first string is the empty string */
+	records = g_byte_array_new();
+	strtab = g_byte_array_new();
+	g_byte_array_append(strtab, (const guint8 *) "", 1);
+	n_stations = 0;
+
+	for (i = 0; i < snapshot->len; i++) {
+		StationSnapshot *station = g_ptr_array_index(snapshot, i);
+		CacheStation record = { 0 };
+
+		/* Stations without uri are not saved, see print_markup_station() */
+		if (station->uri == NULL)
+			continue;
+
+		record.uid = cache_strtab_add(strtab, station->uid);
+		record.uri = cache_strtab_add(strtab, station->uri);
+		record.name = cache_strtab_add(strtab, station->name);
+		record.user_agent = cache_strtab_add(strtab, station->user_agent);
+		if (station->insecure)
+			record.flags |= CACHE_STATION_INSECURE;
+
+		g_byte_array_append(records, (const guint8 *) &record, sizeof record);
+		n_stations++;
+	}
+
+	/* Assemble and write */
+	memset(&header, 0, sizeof header);
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.xml_mtime = xml_mtime;
+	header.xml_size = xml_size;
+	header.n_stations = n_stations;
+	header.strtab_size = strtab->len;
+
+	data = g_byte_array_sized_new(sizeof header + records->len + strtab->len);
+	g_byte_array_append(data, (const guint8 *) &header, sizeof header);
+	g_byte_array_append(data, records->data, records->len);
+	g_byte_array_append(data, strtab->data, strtab->len);
+
+	cache_path = make_cache_path(path);
+	ret = g_file_set_contents(cache_path, (const gchar *) data->data, data->len, err);
+
+	/* Don't leave a previous cache behind */
+	if (ret == FALSE)
+		g_unlink(cache_path);
+
+	g_free(cache_path);
+	g_byte_array_unref(data);
+	g_byte_array_unref(strtab);
+	g_byte_array_unref(records);
+
 	return ret;
 }
 
 /*
- * Iterator implementation
+ * Journal
  */
 
-struct _GvStationListIter {
-	GList *head, *item;
-};
+/* Rather than rewriting the whole station list file for every change,
+ * changes are appended to a journal, one record per line. The journal is
+ * bound to a station list file by a header line, that holds the mtime
+ * and size of this file. At load time, the journal is replayed on top of
+ * the station list, provided that the header matches.
+ *
+ * Records refer to stations by position. Strings are escaped, and
+ * prefixed with '=' so that NULL (an empty field) can be told apart from
+ * the empty string.
+ *
+ *   I <pos> <uri> <name> <insecure> <user-agent> <uid>   insert a station
+ *   R <pos>                                              remove a station
+ *   M <pos> <new-pos>                                    move a station
+ *   S <pos> <property> <value>                           set a property
+ *
+ * Insert records written before uids were saved don't have a uid, it's
+ * derived from the uri then.
+ */
 
-GvStationListIter *
-gv_station_list_iter_new(GvStationList *self)
+#define JOURNAL_MAGIC "GVJ1"
+
+static gchar *
+make_journal_path(const gchar *path)
 {
-	GList *list = self->priv->stations;
-	GvStationListIter *iter;
+	gchar *basename;
+	gchar *journal_path;
 
-	iter = g_new0(GvStationListIter, 1);
-	iter->head = g_list_copy_deep(list, copy_func_object_ref, NULL);
-	iter->item = iter->head;
+	if (!g_str_has_suffix(path, ".xml"))
+		return g_strconcat(path, JOURNAL_FILE_SUFFIX, NULL);
 
-	return iter;
+	basename = g_strndup(path, strlen(path) - strlen(".xml"));
+	journal_path = g_strconcat(basename, JOURNAL_FILE_SUFFIX, NULL);
+	g_free(basename);
+
+	return journal_path;
 }
 
-void
-gv_station_list_iter_free(GvStationListIter *iter)
+static void
+journal_append_string(GString *record, const gchar *value)
 {
-	g_return_if_fail(iter != NULL);
+	gchar *escaped;
 
-	g_list_free_full(iter->head, g_object_unref);
-	g_free(iter);
+	g_string_append_c(record, '\t');
+	if (value == NULL)
+		return;
+
+	escaped = g_strescape(value, NULL);
+	g_string_append_c(record, '=');
+	g_string_append(record, escaped);
+	g_free(escaped);
 }
 
-gboolean
-gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station)
+static gboolean
+journal_parse_string(const gchar *field, gchar **value)
 {
-	g_return_val_if_fail(iter != NULL, FALSE);
-	g_return_val_if_fail(station != NULL, FALSE);
-
-	*station = NULL;
+	if (field[0] == '\0') {
+		*value = NULL;
+		return TRUE;
+	}
 
-	if (iter->item == NULL)
+	if (field[0] != '=')
 		return FALSE;
 
-	*station = iter->item->data;
-	iter->item = iter->item->next;
-
+	*value = g_strcompress(field + 1);
 	return TRUE;
 }
 
-/*
- * GList additions
- */
-
-static gint
-glist_sortfunc_random(gconstpointer a G_GNUC_UNUSED, gconstpointer b G_GNUC_UNUSED)
+static gboolean
+journal_parse_position(const gchar *field, gint *pos)
 {
-	return g_random_boolean() ? 1 : -1;
+	gint64 value;
+
+	if (!g_ascii_string_to_signed(field, 10, -1, G_MAXINT, &value, NULL))
+		return FALSE;
+
+	*pos = value;
+	return TRUE;
 }
 
-static GList *
-g_list_shuffle(GList *list)
+static gboolean
+save_journal_header(const gchar *path, GError **err)
 {
-	/* Shuffle twice. Credits goes to:
-	 * http://www.linuxforums.org/forum/programming-scripting/
-	 * 202125-fastest-way-shuffle-linked-list.html
-	 */
-	list = g_list_sort(list, glist_sortfunc_random);
-	list = g_list_sort(list, glist_sortfunc_random);
-	return list;
+	gchar *journal_path;
+	gchar *header;
+	gint64 xml_mtime;
+	guint64 xml_size;
+	gboolean ret;
+
+	ret = get_file_mtime_and_size(path, &xml_mtime, &xml_size, err);
+	if (ret == FALSE)
+		return FALSE;
+
+	journal_path = make_journal_path(path);
+	header = g_strdup_printf(JOURNAL_MAGIC "\t%" G_GINT64_FORMAT "\t%" G_GUINT64_FORMAT "\n",
+				 xml_mtime, xml_size);
+
+	ret = g_file_set_contents(journal_path, header, -1, err);
+	if (ret == FALSE)
+		g_unlink(journal_path);
+
+	g_free(header);
+	g_free(journal_path);
+
+	return ret;
 }
 
-static GList *
-g_list_copy_deep_shuffle(GList *list, GCopyFunc func, gpointer user_data)
+static gboolean
+replay_journal_record(GSequence *seq, gchar **fields)
 {
-	list = g_list_copy_deep(list, func, user_data);
-	list = g_list_shuffle(list);
-	return list;
-}
+	guint n_fields = g_strv_length(fields);
+	gint len = g_sequence_get_length(seq);
+	GSequenceIter *iter;
+	gint pos;
 
-/*
- * Helpers
- */
+	if (n_fields < 2 || !journal_parse_position(fields[1], &pos))
+		return FALSE;
 
-static gint
-are_stations_similar(GvStation *s1, GvStation *s2)
-{
-	if (s1 == s2) {
-		WARNING("Stations %p and %p are the same", s1, s2);
-		return 0;
+	if (!g_strcmp0(fields[0], "I") && (n_fields == 6 || n_fields == 7)) {
+		gchar *uri, *name, *insecure, *user_agent, *uid = NULL;
+		GvStation *station;
+
+		if (pos > len)
+			return FALSE;
+		if (!journal_parse_string(fields[2], &uri) || uri == NULL)
+			return FALSE;
+
+		journal_parse_string(fields[3], &name);
+		journal_parse_string(fields[4], &insecure);
+		journal_parse_string(fields[5], &user_agent);
+		if (n_fields == 7)
+			journal_parse_string(fields[6], &uid);
+
+		station = gv_station_new(name, uri);
+		if (uid)
+			gv_station_set_uid(station, uid);
+		if (!g_strcmp0(insecure, "true"))
+			gv_station_set_insecure(station, TRUE);
+		if (user_agent)
+			gv_station_set_user_agent(station, user_agent);
+		g_object_ref_sink(station);
+		g_sequence_insert_before(g_sequence_get_iter_at_pos(seq, pos), station);
+
+		g_free(uid);
+		g_free(uri);
+		g_free(name);
+		g_free(insecure);
+		g_free(user_agent);
+		return TRUE;
 	}
 
-	if (s1 == NULL || s2 == NULL)
-		return -1;
+	/* Other records refer to an existing station */
+	if (pos >= len)
+		return FALSE;
+	iter = g_sequence_get_iter_at_pos(seq, pos);
+
+	if (!g_strcmp0(fields[0], "R") && n_fields == 2) {
+		g_object_unref(g_sequence_get(iter));
+		g_sequence_remove(iter);
+		return TRUE;
+	}
 
-	/* Compare uids */
-	const gchar *s1_uid, *s2_uid;
-	s1_uid = gv_station_get_uid(s1);
-	s2_uid = gv_station_get_uid(s2);
+	if (!g_strcmp0(fields[0], "M") && n_fields == 3) {
+		gint new_pos;
 
-	if (!g_strcmp0(s1_uid, s2_uid)) {
-		WARNING("Stations %p and %p have the same uid '%s'", s1, s2, s1_uid);
-		return 0;
+		if (!journal_parse_position(fields[2], &new_pos))
+			return FALSE;
+
+		g_sequence_move(iter, g_sequence_get_iter_at_pos(seq, new_pos));
+		return TRUE;
 	}
 
-	/* Compare names.
-	 * Two stations who don't have name are different.
-	 */
-	const gchar *s1_name, *s2_name;
-	s1_name = gv_station_get_name(s1);
-	s2_name = gv_station_get_name(s2);
+	if (!g_strcmp0(fields[0], "S") && n_fields == 4) {
+		GvStation *station = g_sequence_get(iter);
+		const gchar *property = fields[2];
+		gchar *value;
+
+		if (!journal_parse_string(fields[3], &value))
+			return FALSE;
+
+		if (!g_strcmp0(property, "uri") && value)
+			gv_station_set_uri(station, value);
+		else if (!g_strcmp0(property, "name"))
+			gv_station_set_name(station, value);
+		else if (!g_strcmp0(property, "insecure"))
+			gv_station_set_insecure(station, !g_strcmp0(value, "true"));
+		else if (!g_strcmp0(property, "user-agent"))
+			gv_station_set_user_agent(station, value);
+		else
+			WARNING("Unexpected property in journal: '%s'", property);
+
+		g_free(value);
+		return TRUE;
+	}
 
-	if (s1_name == NULL && s2_name == NULL)
-		return -1;
+	return FALSE;
+}
 
-	if (!g_strcmp0(s1_name, s2_name)) {
-		DEBUG("Stations %p and %p have the same name '%s'", s1, s2, s1_name);
-		return 0;
+/* Replay the journal of the station list file at 'path' on top of the
+ * stations. Returns the number of records replayed, or -1 if there's no
+ * valid journal for this file.
+ */
+static gint
+replay_journal(const gchar *path, GSequence *seq)
+{
+	gchar *journal_path = NULL;
+	gchar *text = NULL;
+	gchar **lines = NULL;
+	gchar **header = NULL;
+	gint64 xml_mtime;
+	guint64 xml_size;
+	gint n_records = -1;
+	guint i;
+
+	if (!get_file_mtime_and_size(path, &xml_mtime, &xml_size, NULL))
+		goto end;
+
+	journal_path = make_journal_path(path);
+	if (!g_file_get_contents(journal_path, &text, NULL, NULL))
+		goto end;
+
+	/* Check the header */
+	lines = g_strsplit(text, "\n", -1);
+	header = g_strsplit(lines[0] ? lines[0] : "", "\t", -1);
+	if (g_strv_length(header) != 3 ||
+	    g_strcmp0(header[0], JOURNAL_MAGIC) ||
+	    g_ascii_strtoll(header[1], NULL, 10) != xml_mtime ||
+	    g_ascii_strtoull(header[2], NULL, 10) != xml_size) {
+		INFO("Station list journal doesn't match, ignoring it");
+		goto end;
 	}
 
-	/* Compare uris */
-	const gchar *s1_uri, *s2_uri;
-	s1_uri = gv_station_get_uri(s1);
-	s2_uri = gv_station_get_uri(s2);
+	/* Replay records. A truncated last line (ie. a crash while writing)
+	 * is expected, and we stop at the first invalid record anyway.
+	 */
+	n_records = 0;
+	for (i = 1; lines[i] && lines[i][0] != '\0'; i++) {
+		gchar **fields;
+		gboolean ret;
 
-	if (!g_strcmp0(s1_uri, s2_uri)) {
-		DEBUG("Stations %p and %p have the same uri '%s'", s1, s2, s1_uri);
-		return 0;
+		fields = g_strsplit(lines[i], "\t", -1);
+		ret = replay_journal_record(seq, fields);
+		g_strfreev(fields);
+
+		if (ret == FALSE) {
+			WARNING("Invalid record in station list journal, line %u", i + 1);
+			break;
+		}
+
+		n_records++;
 	}
 
-	return -1;
+end:
+	g_strfreev(header);
+	g_strfreev(lines);
+	g_free(text);
+	g_free(journal_path);
+	return n_records;
 }
 
 /*
- * Signal handlers
+ * File I/O
  */
 
 static gboolean
-when_timeout_save_station_list(gpointer data)
+load_station_list_from_string(const gchar *text, GList **list, GError **err)
+{
+	return parse_markup(text, list, err);
+}
+
+static gboolean
+load_station_list_from_file(const gchar *path, GList **list, GError **err)
+{
+	GError *cache_err = NULL;
+	gchar *text = NULL;
+	gboolean ret;
+
+	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+	/* Try the binary cache first, it's much faster */
+	ret = load_station_list_from_cache(path, list, &cache_err);
+	if (ret == TRUE) {
+		DEBUG("Station list loaded from cache");
+		return TRUE;
+	}
+
+	DEBUG("Not using station list cache: %s", cache_err->message);
+	g_clear_error(&cache_err);
+
+	ret = g_file_get_contents(path, &text, NULL, err);
+	if (ret == FALSE) {
+		g_assert(err == NULL || *err != NULL);
+		goto end;
+	}
+
+	ret = load_station_list_from_string(text, list, err);
+	if (ret == FALSE) {
+		g_assert(err == NULL || *err != NULL);
+		goto end;
+	}
+
+end:
+	g_free(text);
+	return ret;
+}
+
+static gboolean
+save_station_list_to_string(GPtrArray *snapshot, gchar **text, GError **err)
+{
+	return print_markup(snapshot, text, err);
+}
+
+/* Write the station list to disk. It's safe to call this function from
+ * any thread, as it only works on a snapshot. g_file_set_contents()
+ * writes to a temporary file, then renames it, so the file is replaced
+ * atomically.
+ */
+static gboolean
+save_station_list_to_file(GPtrArray *snapshot, const gchar *path, GError **err)
+{
+	GError *aux_err = NULL;
+	gboolean ret;
+	gchar *text = NULL;
+	gchar *dirname = NULL;
+
+	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+	ret = save_station_list_to_string(snapshot, &text, err);
+	if (ret == FALSE) {
+		g_assert(err == NULL || *err != NULL);
+		goto end;
+	}
+
+	/* g_file_set_contents() doesn't work with /dev/null, due to
+	 * the way it's implemented (see documentation for details).
+	 * However it's convenient to set the save path to /dev/null
+	 * when we actually don't want to save (ie. test suite).
+	 * So we handle this special case explicitly here.
+	 */
+	if (!g_strcmp0(path, "/dev/null")) {
+		ret = TRUE;
+		goto end;
+	}
+
+	dirname = g_path_get_dirname(path);
+	if (g_mkdir_with_parents(dirname, S_IRWXU) != 0) {
+		g_set_error(err, G_FILE_ERROR,
+			    g_file_error_from_errno(errno),
+			    "Failed to make directory: %s", g_strerror(errno));
+		ret = FALSE;
+		goto end;
+	}
+
+	ret = g_file_set_contents(path, text, -1, err);
+	if (ret == FALSE) {
+		g_assert(err == NULL || *err != NULL);
+		goto end;
+	}
+
+	/* Rebuild the binary cache. Failing is not an error, the cache
+	 * is just an optimization.
+	 */
+	if (save_station_list_to_cache(snapshot, path, &aux_err) == FALSE) {
+		WARNING("Failed to save station list cache: %s", aux_err->message);
+		g_clear_error(&aux_err);
+	}
+
+	/* Start a new journal, that applies on top of this file. If it
+	 * fails, there's no journal, and next changes will trigger a full
+	 * save, as usual.
+	 */
+	if (save_journal_header(path, &aux_err) == FALSE) {
+		WARNING("Failed to save station list journal: %s", aux_err->message);
+		g_clear_error(&aux_err);
+	}
+
+end:
+	g_free(dirname);
+	g_free(text);
+	return ret;
+}
+
+/*
+ * Iterator implementation
+ */
+
+/* An iterator walks the sequence directly, without copying anything.
+ * When the list is about to be modified, all the live iterators are
+ * detached: they get a snapshot of the list, which is shared among
+ * them, and they continue with it. Hence an iterator always sees the
+ * list as it was when the iterator was created.
+ */
+
+struct _GvStationListIter {
+	/* While attached */
+	GvStationList *list;
+	GSequenceIter *item;
+	/* Once detached */
+	GPtrArray *snapshot;
+	guint index;
+};
+
+static void
+gv_station_list_detach_iters(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *item;
+	GPtrArray *snapshot;
+	GList *link;
+
+	if (priv->iters == NULL)
+		return;
+
+	snapshot = g_ptr_array_new_full(g_sequence_get_length(priv->stations),
+					g_object_unref);
+	for (item = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(item); item = g_sequence_iter_next(item))
+		g_ptr_array_add(snapshot, g_object_ref(g_sequence_get(item)));
+
+	for (link = priv->iters; link; link = link->next) {
+		GvStationListIter *iter = link->data;
+
+		iter->snapshot = g_ptr_array_ref(snapshot);
+		iter->index = g_sequence_iter_get_position(iter->item);
+		iter->item = NULL;
+		iter->list = NULL;
+	}
+
+	TRACE("Detached %u iterators", g_list_length(priv->iters));
+
+	g_list_free(priv->iters);
+	priv->iters = NULL;
+	g_ptr_array_unref(snapshot);
+}
+
+GvStationListIter *
+gv_station_list_iter_new(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationListIter *iter;
+
+	iter = g_new0(GvStationListIter, 1);
+	iter->list = self;
+	iter->item = g_sequence_get_begin_iter(priv->stations);
+
+	priv->iters = g_list_prepend(priv->iters, iter);
+
+	return iter;
+}
+
+void
+gv_station_list_iter_free(GvStationListIter *iter)
+{
+	g_return_if_fail(iter != NULL);
+
+	if (iter->list) {
+		GvStationListPrivate *priv = iter->list->priv;
+
+		priv->iters = g_list_remove(priv->iters, iter);
+	}
+
+	if (iter->snapshot)
+		g_ptr_array_unref(iter->snapshot);
+
+	g_free(iter);
+}
+
+gboolean
+gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station)
+{
+	g_return_val_if_fail(iter != NULL, FALSE);
+	g_return_val_if_fail(station != NULL, FALSE);
+
+	*station = NULL;
+
+	if (iter->snapshot) {
+		if (iter->index >= iter->snapshot->len)
+			return FALSE;
+
+		*station = g_ptr_array_index(iter->snapshot, iter->index);
+		iter->index++;
+
+		return TRUE;
+	}
+
+	if (iter->item == NULL || g_sequence_iter_is_end(iter->item))
+		return FALSE;
+
+	*station = g_sequence_get(iter->item);
+	iter->item = g_sequence_iter_next(iter->item);
+
+	return TRUE;
+}
+
+/*
+ * Search index
+ *
+ * Stations are searched by name and uri, ignoring case and accents. Both
+ * are normalized, and each trigram (ie. sequence of 3 characters) of the
+ * normalized strings maps to the set of stations that contain it. For a
+ * search, the candidates are the stations of the rarest trigram of the
+ * query, then each candidate is checked with a plain substring match.
+ */
+
+/* Case fold, then decompose and drop the combining marks, so that
+ * 'Café' becomes 'cafe'.
+ */
+static gchar *
+search_normalize(const gchar *str)
+{
+	gchar *folded, *decomposed;
+	const gchar *ptr;
+	GString *out;
+
+	if (str == NULL)
+		return NULL;
+
+	folded = g_utf8_casefold(str, -1);
+	decomposed = g_utf8_normalize(folded, -1, G_NORMALIZE_NFKD);
+	g_free(folded);
+	if (decomposed == NULL)
+		return NULL;
+
+	out = g_string_sized_new(strlen(decomposed));
+	for (ptr = decomposed; *ptr != '\0'; ptr = g_utf8_next_char(ptr)) {
+		gunichar c = g_utf8_get_char(ptr);
+
+		if (g_unichar_ismark(c))
+			continue;
+
+		g_string_append_unichar(out, c);
+	}
+	g_free(decomposed);
+
+	return g_string_free(out, FALSE);
+}
+
+/* Return the trigrams of a normalized string, possibly with duplicates */
+static GPtrArray *
+search_make_grams(const gchar *text)
+{
+	GPtrArray *grams;
+	const gchar *start;
+
+	grams = g_ptr_array_new_with_free_func(g_free);
+	if (text == NULL)
+		return grams;
+
+	for (start = text; *start != '\0'; start = g_utf8_next_char(start)) {
+		const gchar *end = start;
+		guint i;
+
+		for (i = 0; i < SEARCH_GRAM_LENGTH && *end != '\0'; i++)
+			end = g_utf8_next_char(end);
+
+		if (i < SEARCH_GRAM_LENGTH)
+			break;
+
+		g_ptr_array_add(grams, g_strndup(start, end - start));
+	}
+
+	return grams;
+}
+
+static GHashTable *
+search_index_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal,
+				     g_free, (GDestroyNotify) g_hash_table_destroy);
+}
+
+static void
+search_index_add(GHashTable *index, const gchar *text, GvStation *station)
+{
+	GPtrArray *grams;
+	guint i;
+
+	grams = search_make_grams(text);
+
+	for (i = 0; i < grams->len; i++) {
+		gchar *gram = g_ptr_array_index(grams, i);
+		GHashTable *stations;
+
+		stations = g_hash_table_lookup(index, gram);
+		if (stations == NULL) {
+			stations = g_hash_table_new(g_direct_hash, g_direct_equal);
+			g_hash_table_insert(index, g_strdup(gram), stations);
+		}
+
+		g_hash_table_add(stations, station);
+	}
+
+	g_ptr_array_unref(grams);
+}
+
+static void
+search_index_remove(GHashTable *index, const gchar *text, GvStation *station)
+{
+	GPtrArray *grams;
+	guint i;
+
+	grams = search_make_grams(text);
+
+	for (i = 0; i < grams->len; i++) {
+		gchar *gram = g_ptr_array_index(grams, i);
+		GHashTable *stations;
+
+		stations = g_hash_table_lookup(index, gram);
+		if (stations == NULL)
+			continue;
+
+		g_hash_table_remove(stations, station);
+		if (g_hash_table_size(stations) == 0)
+			g_hash_table_remove(index, gram);
+	}
+
+	g_ptr_array_unref(grams);
+}
+
+/* Return the stations that might match the query, or NULL if there's
+ * no candidate. If the query is too short to have trigrams, every station
+ * is a candidate.
+ */
+static GHashTable *
+search_index_candidates(GHashTable *index, GHashTable *all, const gchar *query)
+{
+	GHashTable *candidates = all;
+	GPtrArray *grams;
+	guint i;
+
+	grams = search_make_grams(query);
+
+	for (i = 0; i < grams->len; i++) {
+		GHashTable *stations;
+
+		stations = g_hash_table_lookup(index, g_ptr_array_index(grams, i));
+		if (stations == NULL) {
+			candidates = NULL;
+			break;
+		}
+
+		if (i == 0 || g_hash_table_size(stations) < g_hash_table_size(candidates))
+			candidates = stations;
+	}
+
+	g_ptr_array_unref(grams);
+
+	return candidates;
+}
+
+/*
+ * Lookup indexes
+ */
+
+/* Each station in the list has a node, that holds its position in the
+ * sequence, its position in the shuffle order, the keys under which it's
+ * indexed, and its normalized name and uri for searching.
+ *
+ * Each index maps a key (uid, name or uri) to a queue of stations. In
+ * practice, there's one station per key, however nothing prevents the
+ * user from creating stations with the same name, so we need to be ready
+ * for that. A lookup returns the station that was indexed first.
+ */
+
+struct _GvStationNode {
+	GSequenceIter *iter;
+	guint shuffle_pos;
+	gchar *uid;
+	gchar *name;
+	gchar *uri;
+	gchar *search_name;
+	gchar *search_uri;
+};
+
+typedef struct _GvStationNode GvStationNode;
+
+static void
+gv_station_node_free(GvStationNode *node)
+{
+	g_free(node->search_name);
+	g_free(node->search_uri);
+	g_free(node->uid);
+	g_free(node->name);
+	g_free(node->uri);
+	g_free(node);
+}
+
+static GHashTable *
+station_index_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal,
+				     g_free, (GDestroyNotify) g_queue_free);
+}
+
+static void
+station_index_add(GHashTable *index, const gchar *key, GvStation *station)
+{
+	GQueue *queue;
+
+	if (key == NULL)
+		return;
+
+	queue = g_hash_table_lookup(index, key);
+	if (queue == NULL) {
+		queue = g_queue_new();
+		g_hash_table_insert(index, g_strdup(key), queue);
+	}
+
+	g_queue_push_tail(queue, station);
+}
+
+static void
+station_index_remove(GHashTable *index, const gchar *key, GvStation *station)
+{
+	GQueue *queue;
+
+	if (key == NULL)
+		return;
+
+	queue = g_hash_table_lookup(index, key);
+	if (queue == NULL)
+		return;
+
+	g_queue_remove(queue, station);
+	if (g_queue_is_empty(queue))
+		g_hash_table_remove(index, key);
+}
+
+static GvStationNode *
+gv_station_list_lookup_node(GvStationList *self, GvStation *station)
+{
+	return g_hash_table_lookup(self->priv->station_nodes, station);
+}
+
+/* Lookup a station in one of the indexes. If there are several matches,
+ * return the first one in the list, as walking the list would do.
+ */
+static GvStation *
+gv_station_list_index_lookup(GvStationList *self, GHashTable *index, const gchar *key)
+{
+	GvStation *match = NULL;
+	GSequenceIter *match_iter = NULL;
+	GQueue *queue;
+	GList *item;
+
+	queue = g_hash_table_lookup(index, key);
+	if (queue == NULL)
+		return NULL;
+
+	if (g_queue_get_length(queue) == 1)
+		return g_queue_peek_head(queue);
+
+	for (item = queue->head; item; item = item->next) {
+		GvStation *station = item->data;
+		GvStationNode *node = gv_station_list_lookup_node(self, station);
+
+		if (match_iter == NULL || g_sequence_iter_compare(node->iter, match_iter) < 0) {
+			match = station;
+			match_iter = node->iter;
+		}
+	}
+
+	return match;
+}
+
+static GSequenceIter *
+gv_station_list_lookup_iter(GvStationList *self, GvStation *station)
+{
+	GvStationNode *node;
+
+	node = gv_station_list_lookup_node(self, station);
+	if (node == NULL)
+		return NULL;
+
+	return node->iter;
+}
+
+static void
+gv_station_list_index_station(GvStationList *self, GvStation *station,
+			      GSequenceIter *iter)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationNode *node;
+
+	node = g_new0(GvStationNode, 1);
+	node->iter = iter;
+	node->uid = g_strdup(gv_station_get_uid(station));
+	node->name = g_strdup(gv_station_get_name(station));
+	node->uri = g_strdup(gv_station_get_uri(station));
+	node->search_name = search_normalize(node->name);
+	node->search_uri = search_normalize(node->uri);
+	g_hash_table_insert(priv->station_nodes, station, node);
+
+	station_index_add(priv->uid_index, node->uid, station);
+	station_index_add(priv->name_index, node->name, station);
+	station_index_add(priv->uri_index, node->uri, station);
+	search_index_add(priv->search_index, node->search_name, station);
+	search_index_add(priv->search_index, node->search_uri, station);
+}
+
+static void
+gv_station_list_unindex_station(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationNode *node;
+
+	node = g_hash_table_lookup(priv->station_nodes, station);
+	if (node == NULL)
+		return;
+
+	station_index_remove(priv->uid_index, node->uid, station);
+	station_index_remove(priv->name_index, node->name, station);
+	station_index_remove(priv->uri_index, node->uri, station);
+	search_index_remove(priv->search_index, node->search_name, station);
+	search_index_remove(priv->search_index, node->search_uri, station);
+
+	g_hash_table_remove(priv->station_nodes, station);
+}
+
+/* Uids are derived from the uri when a station is created, so a station
+ * might clash with a station whose uri has changed since, or with a
+ * station that has the same uri. Uids must be unique, give it a random
+ * one then. Return TRUE if the uid was changed.
+ */
+static gboolean
+gv_station_list_ensure_unique_uid(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	gchar *uid;
+
+	if (gv_station_list_index_lookup(self, priv->uid_index, gv_station_get_uid(station)) == NULL)
+		return FALSE;
+
+	uid = g_strdup_printf("%08x%08x", g_random_int(), g_random_int());
+	DEBUG("Station uid '%s' already in use, changing it to '%s'",
+	      gv_station_get_uid(station), uid);
+	gv_station_set_uid(station, uid);
+	g_free(uid);
+
+	return TRUE;
+}
+
+static void
+gv_station_list_reindex_station(GvStationList *self, GvStation *station)
+{
+	GvStationNode *node;
+	GSequenceIter *iter;
+	guint shuffle_pos;
+
+	node = gv_station_list_lookup_node(self, station);
+	if (node == NULL)
+		return;
+
+	iter = node->iter;
+	shuffle_pos = node->shuffle_pos;
+
+	gv_station_list_unindex_station(self, station);
+	gv_station_list_index_station(self, station, iter);
+
+	node = gv_station_list_lookup_node(self, station);
+	node->shuffle_pos = shuffle_pos;
+}
+
+/*
+ * Shuffle order
+ *
+ * The shuffle order is an array of stations, and each station node holds
+ * its position in this array, so that stepping through the stations is
+ * O(1). It's created with a Fisher-Yates shuffle, then it's maintained
+ * incrementally, so that a cycle through the stations doesn't skip nor
+ * repeat any of them: new stations are inserted at a random position
+ * after the cursor, among the stations not played yet, and removals keep
+ * the stations that were played before the cursor.
+ */
+
+static void
+gv_station_list_shuffle_swap(GvStationList *self, guint i, guint j)
+{
+	GPtrArray *shuffled = self->priv->shuffled;
+	GvStationNode *node;
+	gpointer tmp;
+
+	tmp = shuffled->pdata[i];
+	shuffled->pdata[i] = shuffled->pdata[j];
+	shuffled->pdata[j] = tmp;
+
+	node = gv_station_list_lookup_node(self, shuffled->pdata[i]);
+	node->shuffle_pos = i;
+	node = gv_station_list_lookup_node(self, shuffled->pdata[j]);
+	node->shuffle_pos = j;
+}
+
+static void
+gv_station_list_shuffle(GvStationList *self)
+{
+	GPtrArray *shuffled = self->priv->shuffled;
+	guint i;
+
+	/* Fisher-Yates */
+	for (i = shuffled->len; i > 1; i--)
+		gv_station_list_shuffle_swap(self, i - 1, g_random_int_range(0, i));
+}
+
+static void
+gv_station_list_shuffle_create(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
+
+	if (priv->shuffled != NULL)
+		return;
+
+	priv->shuffled = g_ptr_array_sized_new(g_sequence_get_length(priv->stations));
+
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter); iter = g_sequence_iter_next(iter)) {
+		GvStation *station = g_sequence_get(iter);
+		GvStationNode *node = gv_station_list_lookup_node(self, station);
+
+		node->shuffle_pos = priv->shuffled->len;
+		g_ptr_array_add(priv->shuffled, station);
+	}
+
+	gv_station_list_shuffle(self);
+	priv->shuffle_cursor = -1;
+}
+
+static void
+gv_station_list_shuffle_destroy(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_clear_pointer(&priv->shuffled, g_ptr_array_unref);
+}
+
+static void
+gv_station_list_shuffle_add(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationNode *node;
+	guint pos;
+
+	if (priv->shuffled == NULL)
+		return;
+
+	node = gv_station_list_lookup_node(self, station);
+	pos = priv->shuffled->len;
+	node->shuffle_pos = pos;
+	g_ptr_array_add(priv->shuffled, station);
+
+	gv_station_list_shuffle_swap(self, pos,
+				     g_random_int_range(priv->shuffle_cursor + 1, pos + 1));
+}
+
+static void
+gv_station_list_shuffle_remove(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *shuffled = priv->shuffled;
+	GvStationNode *node;
+	guint last;
+	guint pos;
+
+	if (shuffled == NULL)
+		return;
+
+	node = gv_station_list_lookup_node(self, station);
+	last = shuffled->len - 1;
+	pos = node->shuffle_pos;
+
+	/* A station up to the cursor was played, the ones after it keep
+	 * their order, and the cursor moves back by one. The hole is now
+	 * right after the cursor, among the stations not played yet.
+	 */
+	if ((gint) pos <= priv->shuffle_cursor) {
+		for (; (gint) pos < priv->shuffle_cursor; pos++)
+			gv_station_list_shuffle_swap(self, pos, pos + 1);
+		priv->shuffle_cursor -= 1;
+	}
+
+	/* The order of the stations not played yet doesn't matter */
+	gv_station_list_shuffle_swap(self, pos, last);
+	g_ptr_array_remove_index(shuffled, last);
+}
+
+/* Make a station of the shuffle order the current one */
+static GvStation *
+gv_station_list_shuffle_pick(GvStationList *self, guint pos)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	priv->shuffle_cursor = pos;
+
+	return g_ptr_array_index(priv->shuffled, pos);
+}
+
+/*
+ * Helpers
+ */
+
+static gboolean
+has_similar_station(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	const gchar *name, *uri;
+	GvStation *match;
+
+	/* Same station */
+	if (g_hash_table_contains(priv->station_nodes, station)) {
+		WARNING("Station %p is already part of the list", station);
+		return TRUE;
+	}
+
+	/* Compare names.
+	 * Two stations who don't have name are different.
+	 */
+	name = gv_station_get_name(station);
+	match = name ? gv_station_list_index_lookup(self, priv->name_index, name) : NULL;
+	if (match) {
+		DEBUG("Stations %p and %p have the same name '%s'", station, match, name);
+		return TRUE;
+	}
+
+	/* Compare uris */
+	uri = gv_station_get_uri(station);
+	match = uri ? gv_station_list_index_lookup(self, priv->uri_index, uri) : NULL;
+	if (match) {
+		DEBUG("Stations %p and %p have the same uri '%s'", station, match, uri);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Background save
+ */
+
+/* Saves run in a worker thread, so that the main loop doesn't stall while
+ * the station list is serialized and written to disk. At most one save is
+ * in flight at a time: saves that are requested meanwhile are coalesced
+ * into a single one, that runs when the current one completes.
+ */
+
+struct _SaveData {
+	GvStationListPrivate *priv;
+	GWeakRef self;
+	GPtrArray *snapshot;
+	gchar *path;
+};
+
+typedef struct _SaveData SaveData;
+
+static void
+save_data_free(SaveData *data)
+{
+	g_weak_ref_clear(&data->self);
+	g_ptr_array_unref(data->snapshot);
+	g_free(data->path);
+	g_free(data);
+}
+
+static void
+gv_station_list_report_save(GvStationList *self, const gchar *path, GError *err)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (err == NULL) {
+		INFO("Station list saved to '%s'", path);
+		return;
+	}
+
+	WARNING("Failed to save station list: %s", err->message);
+	if (priv->finalization == FALSE)
+		gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
+					_("Failed to save station list"), err->message);
+}
+
+static void
+gv_station_list_wait_for_save(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_mutex_lock(&priv->save_mutex);
+	while (priv->save_in_flight)
+		g_cond_wait(&priv->save_cond, &priv->save_mutex);
+	g_mutex_unlock(&priv->save_mutex);
+}
+
+static void
+save_thread_func(GTask *task,
+		 gpointer source_object G_GNUC_UNUSED,
+		 gpointer task_data,
+		 GCancellable *cancellable G_GNUC_UNUSED)
+{
+	SaveData *data = task_data;
+	GvStationListPrivate *priv = data->priv;
+	GError *err = NULL;
+	gboolean ret;
+
+	ret = save_station_list_to_file(data->snapshot, data->path, &err);
+
+	/* The station list might be waiting for us to finish, in its
+	 * finalize method. Don't touch priv after that.
+	 */
+	g_mutex_lock(&priv->save_mutex);
+	priv->save_in_flight = FALSE;
+	g_cond_broadcast(&priv->save_cond);
+	g_mutex_unlock(&priv->save_mutex);
+
+	if (ret == TRUE)
+		g_task_return_boolean(task, TRUE);
+	else
+		g_task_return_error(task, err);
+}
+
+static void gv_station_list_save_in_background(GvStationList *self);
+static void gv_station_list_open_journal(GvStationList *self, guint n_records);
+static void gv_station_list_close_journal(GvStationList *self);
+
+static void
+on_save_done(GObject *source_object G_GNUC_UNUSED,
+	     GAsyncResult *result,
+	     gpointer user_data G_GNUC_UNUSED)
+{
+	GTask *task = G_TASK(result);
+	SaveData *data = g_task_get_task_data(task);
+	GvStationList *self;
+	GError *err = NULL;
+
+	g_task_propagate_boolean(task, &err);
+
+	/* The station list might be gone already */
+	self = g_weak_ref_get(&data->self);
+	if (self == NULL) {
+		if (err)
+			WARNING("Failed to save station list: %s", err->message);
+		g_clear_error(&err);
+		return;
+	}
+
+	gv_station_list_report_save(self, data->path, err);
+
+	/* Run the save that was requested meanwhile, or start journaling */
+	if (self->priv->save_again)
+		gv_station_list_save_in_background(self);
+	else if (err == NULL)
+		gv_station_list_open_journal(self, 0);
+
+	g_clear_error(&err);
+
+	g_object_unref(self);
+}
+
+static void
+gv_station_list_save_in_background(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	SaveData *data;
+	GTask *task;
+
+	/* Coalesce with the save in flight, if any */
+	g_mutex_lock(&priv->save_mutex);
+	if (priv->save_in_flight) {
+		priv->save_again = TRUE;
+		g_mutex_unlock(&priv->save_mutex);
+		return;
+	}
+	priv->save_in_flight = TRUE;
+	priv->save_again = FALSE;
+	g_mutex_unlock(&priv->save_mutex);
+
+	/* The journal is reset by the save, so changes that happen while
+	 * the save is in flight can't go there. They trigger another save.
+	 */
+	gv_station_list_close_journal(self);
+
+	/* Hand over a snapshot to the worker thread */
+	data = g_new0(SaveData, 1);
+	data->priv = priv;
+	g_weak_ref_init(&data->self, self);
+	data->snapshot = make_station_list_snapshot(priv->stations);
+	data->path = g_strdup(priv->save_path);
+
+	/* Records of the current batch are part of the snapshot */
+	g_string_truncate(priv->batch_journal, 0);
+	priv->batch_n_records = 0;
+
+	task = g_task_new(NULL, NULL, on_save_done, NULL);
+	g_task_set_task_data(task, data, (GDestroyNotify) save_data_free);
+	g_task_run_in_thread(task, save_thread_func);
+	g_object_unref(task);
+}
+
+static gboolean
+when_timeout_save_station_list(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	gv_station_list_save_in_background(self);
+
+	priv->save_timeout_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_station_list_save_delayed(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
+	priv->save_timeout_id =
+		g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+}
+
+/*
+ * Journaling
+ */
+
+static void
+gv_station_list_open_journal(GvStationList *self, guint n_records)
+{
+	GvStationListPrivate *priv = self->priv;
+	GFileOutputStream *stream;
+	GFileInfo *info;
+	GFile *file;
+	gchar *path;
+	GError *err = NULL;
+
+	g_assert_null(priv->journal);
+
+	if (!g_strcmp0(priv->save_path, "/dev/null"))
+		return;
+
+	path = make_journal_path(priv->save_path);
+	file = g_file_new_for_path(path);
+
+	/* The journal must exist, as it's created along with the
+	 * station list file. Otherwise, it's not to be trusted.
+	 */
+	info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (info == NULL)
+		goto end;
+
+	stream = g_file_append_to(file, G_FILE_CREATE_NONE, NULL, &err);
+	if (stream == NULL) {
+		WARNING("Failed to open station list journal: %s", err->message);
+		g_clear_error(&err);
+		goto end;
+	}
+
+	DEBUG("Station list journal opened, %u records", n_records);
+	priv->journal = G_OUTPUT_STREAM(stream);
+	priv->journal_size = g_file_info_get_size(info);
+	priv->journal_n_records = n_records;
+
+end:
+	g_clear_object(&info);
+	g_object_unref(file);
+	g_free(path);
+}
+
+static void
+gv_station_list_close_journal(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal == NULL)
+		return;
+
+	g_output_stream_close(priv->journal, NULL, NULL);
+	g_clear_object(&priv->journal);
+	priv->journal_size = 0;
+	priv->journal_n_records = 0;
+}
+
+/* Write records to the journal. If there's no journal, or if it's
+ * grown too big, fall back to a full save of the station list.
+ */
+static void
+gv_station_list_write_journal(GvStationList *self, const gchar *records,
+			      gsize len, guint n_records)
+{
+	GvStationListPrivate *priv = self->priv;
+	GError *err = NULL;
+
+	if (priv->journal == NULL) {
+		gv_station_list_save_delayed(self);
+		return;
+	}
+
+	if (!g_output_stream_write_all(priv->journal, records, len,
+				       NULL, NULL, &err)) {
+		WARNING("Failed to write to station list journal: %s", err->message);
+		g_clear_error(&err);
+		gv_station_list_close_journal(self);
+		gv_station_list_save_delayed(self);
+		return;
+	}
+
+	priv->journal_size += len;
+	priv->journal_n_records += n_records;
+
+	if (priv->journal_size > JOURNAL_MAX_SIZE) {
+		DEBUG("Station list journal is too big, compacting");
+		gv_station_list_close_journal(self);
+		gv_station_list_save_delayed(self);
+	}
+}
+
+/* Append a record to the journal. Within a batch, records are buffered
+ * and written all at once when the batch is committed.
+ */
+static void
+gv_station_list_append_to_journal(GvStationList *self, GString *record)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_string_append_c(record, '\n');
+
+	if (priv->batch_depth > 0) {
+		g_string_append_len(priv->batch_journal, record->str, record->len);
+		priv->batch_n_records += 1;
+		return;
+	}
+
+	gv_station_list_write_journal(self, record->str, record->len, 1);
+}
+
+static void
+gv_station_list_journal_insert(GvStationList *self, GvStation *station, GSequenceIter *iter)
+{
+	GString *record;
+
+	record = g_string_new("I");
+	g_string_append_printf(record, "\t%d", g_sequence_iter_get_position(iter));
+	journal_append_string(record, gv_station_get_uri(station));
+	journal_append_string(record, gv_station_get_name(station));
+	journal_append_string(record, gv_station_get_insecure(station) ? "true" : "false");
+	journal_append_string(record, gv_station_get_user_agent(station));
+	journal_append_string(record, gv_station_get_uid(station));
+	gv_station_list_append_to_journal(self, record);
+	g_string_free(record, TRUE);
+}
+
+static void
+gv_station_list_journal_remove(GvStationList *self, gint pos)
+{
+	GString *record;
+
+	record = g_string_new("R");
+	g_string_append_printf(record, "\t%d", pos);
+	gv_station_list_append_to_journal(self, record);
+	g_string_free(record, TRUE);
+}
+
+static void
+gv_station_list_journal_move(GvStationList *self, gint pos, gint new_pos)
+{
+	GString *record;
+
+	record = g_string_new("M");
+	g_string_append_printf(record, "\t%d\t%d", pos, new_pos);
+	gv_station_list_append_to_journal(self, record);
+	g_string_free(record, TRUE);
+}
+
+static void
+gv_station_list_journal_set(GvStationList *self, GvStation *station, const gchar *property)
+{
+	GSequenceIter *iter;
+	const gchar *value = NULL;
+	GString *record;
+
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL)
+		return;
+
+	if (!g_strcmp0(property, "uri"))
+		value = gv_station_get_uri(station);
+	else if (!g_strcmp0(property, "name"))
+		value = gv_station_get_name(station);
+	else if (!g_strcmp0(property, "insecure"))
+		value = gv_station_get_insecure(station) ? "true" : "false";
+	else if (!g_strcmp0(property, "user-agent"))
+		value = gv_station_get_user_agent(station);
+	else
+		g_assert_not_reached();
+
+	record = g_string_new("S");
+	g_string_append_printf(record, "\t%d\t%s", g_sequence_iter_get_position(iter), property);
+	journal_append_string(record, value);
+	gv_station_list_append_to_journal(self, record);
+	g_string_free(record, TRUE);
+}
+
+/*
+ * Batches
+ *
+ * Outside of a batch, each change is notified right away with one of the
+ * station-* signals. Within a batch, changes are recorded in a diff, that
+ * is emitted with the stations-changed signal when the batch is committed.
+ *
+ * The diff is compact: consecutive moves of a station are merged, and
+ * modifications are deduplicated and come last, at their final position.
+ */
+
+static GvStationListChange *
+gv_station_list_change_new(GvStationListChangeKind kind, GvStation *station,
+			   gint position, gint old_position)
+{
+	GvStationListChange *change;
+
+	change = g_new0(GvStationListChange, 1);
+	change->kind = kind;
+	change->station = g_object_ref(station);
+	change->position = position;
+	change->old_position = old_position;
+
+	return change;
+}
+
+static void
+gv_station_list_change_free(GvStationListChange *change)
+{
+	g_object_unref(change->station);
+	g_free(change);
+}
+
+static gint
+gv_station_list_change_compare(GvStationListChange **a, GvStationListChange **b)
+{
+	return (*a)->position - (*b)->position;
+}
+
+static void
+gv_station_list_emit_change(GvStationList *self, GvStationListChangeKind kind,
+			    GvStation *station, gint position, gint old_position)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *changes = priv->batch_changes;
+	GvStationListChange *last;
+
+	/* Not in a batch, emit a signal right away */
+	if (priv->batch_depth == 0) {
+		switch (kind) {
+		case GV_STATION_LIST_CHANGE_ADDED:
+			g_signal_emit(self, signals[SIGNAL_STATION_ADDED], 0, station);
+			break;
+		case GV_STATION_LIST_CHANGE_REMOVED:
+			g_signal_emit(self, signals[SIGNAL_STATION_REMOVED], 0, station);
+			break;
+		case GV_STATION_LIST_CHANGE_MOVED:
+			g_signal_emit(self, signals[SIGNAL_STATION_MOVED], 0, station);
+			break;
+		case GV_STATION_LIST_CHANGE_MODIFIED:
+			g_signal_emit(self, signals[SIGNAL_STATION_MODIFIED], 0, station);
+			break;
+		default:
+			g_assert_not_reached();
+		}
+		return;
+	}
+
+	/* Modifications are sorted out at commit time */
+	if (kind == GV_STATION_LIST_CHANGE_MODIFIED) {
+		if (!g_hash_table_contains(priv->batch_modified, station))
+			g_hash_table_add(priv->batch_modified, g_object_ref(station));
+		return;
+	}
+
+	/* Merge consecutive moves of the same station */
+	last = changes->len > 0 ? g_ptr_array_index(changes, changes->len - 1) : NULL;
+	if (kind == GV_STATION_LIST_CHANGE_MOVED && last != NULL &&
+	    last->kind == GV_STATION_LIST_CHANGE_MOVED && last->station == station) {
+		last->position = position;
+		if (last->position == last->old_position)
+			g_ptr_array_remove_index(changes, changes->len - 1);
+		return;
+	}
+
+	/* Drop moves that don't move anything */
+	if (kind == GV_STATION_LIST_CHANGE_MOVED && position == old_position)
+		return;
+
+	g_ptr_array_add(changes, gv_station_list_change_new(kind, station,
+							    position, old_position));
+}
+
+/* Collect the modified stations that are still in the list, and that
+ * were not added during the batch, in the order of the list.
+ */
+static GPtrArray *
+gv_station_list_collect_modified(GvStationList *self, GPtrArray *changes)
 {
-	GvStationList *self = GV_STATION_LIST(data);
 	GvStationListPrivate *priv = self->priv;
+	GHashTable *added;
+	GHashTableIter iter;
+	GPtrArray *modified;
+	gpointer station;
+	guint i;
+
+	modified = g_ptr_array_new();
+	if (g_hash_table_size(priv->batch_modified) == 0)
+		return modified;
+
+	added = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < changes->len; i++) {
+		GvStationListChange *change = g_ptr_array_index(changes, i);
+
+		if (change->kind == GV_STATION_LIST_CHANGE_ADDED)
+			g_hash_table_add(added, change->station);
+	}
 
-	gv_station_list_save(self);
+	g_hash_table_iter_init(&iter, priv->batch_modified);
+	while (g_hash_table_iter_next(&iter, &station, NULL)) {
+		GSequenceIter *seq_iter;
 
-	priv->save_timeout_id = 0;
+		if (g_hash_table_contains(added, station))
+			continue;
 
-	return G_SOURCE_REMOVE;
-}
+		seq_iter = gv_station_list_lookup_iter(self, station);
+		if (seq_iter == NULL)
+			continue;
 
-static void
-gv_station_list_save_delayed(GvStationList *self)
-{
-	GvStationListPrivate *priv = self->priv;
+		g_ptr_array_add(modified, gv_station_list_change_new(
+					GV_STATION_LIST_CHANGE_MODIFIED, station,
+					g_sequence_iter_get_position(seq_iter), -1));
+	}
+	g_ptr_array_sort(modified, (GCompareFunc) gv_station_list_change_compare);
 
-	g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
-	priv->save_timeout_id =
-		g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+	g_hash_table_destroy(added);
+
+	return modified;
 }
 
+/*
+ * Signal handlers
+ */
+
 static void
 on_station_notify(GvStation *station,
 		  GParamSpec *pspec,
@@ -674,16 +2362,23 @@ on_station_notify(GvStation *station,
 
 	TRACE("%s, %s, %p", gv_station_get_uid(station), property_name, self);
 
+	/* Keep lookup indexes up to date */
+	if (!g_strcmp0(property_name, "uid") ||
+	    !g_strcmp0(property_name, "name") ||
+	    !g_strcmp0(property_name, "uri")) {
+		gv_station_list_reindex_station(self, station);
+	}
+
 	/* We might want to save changes */
 	if (!g_strcmp0(property_name, "uri") ||
 	    !g_strcmp0(property_name, "name") ||
 	    !g_strcmp0(property_name, "insecure") ||
 	    !g_strcmp0(property_name, "user-agent")) {
-		gv_station_list_save_delayed(self);
+		gv_station_list_journal_set(self, station, property_name);
 	}
 
 	/* Emit signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_MODIFIED], 0, station);
+	gv_station_list_emit_change(self, GV_STATION_LIST_CHANGE_MODIFIED, station, -1, -1);
 }
 
 /*
@@ -808,8 +2503,8 @@ gv_station_list_set_property(GObject *object,
 void
 gv_station_list_remove(GvStationList *self, GvStation *station)
 {
-	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GSequenceIter *iter;
+	gint pos;
 
 	/* Ensure a valid station was given */
 	if (station == NULL) {
@@ -823,42 +2518,44 @@ gv_station_list_remove(GvStationList *self, GvStation *station)
 	/* Check that we own this station at first. If we don't find it
 	 * in our internal list, it's probably a programming error.
 	 */
-	item = g_list_find(priv->stations, station);
-	if (item == NULL) {
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL) {
 		WARNING("GvStation %p (%s) not found in list",
 			station, gv_station_get_uid(station));
 		return;
 	}
 
+	/* Live iterators must not see the change */
+	gv_station_list_detach_iters(self);
+
 	/* Disconnect signal handlers */
 	g_signal_handlers_disconnect_by_data(station, self);
 
-	/* Remove from list */
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
+	/* Remove from shuffle order and lookup indexes */
+	gv_station_list_shuffle_remove(self, station);
+	gv_station_list_unindex_station(self, station);
 
-	/* Unown the station */
-	g_object_unref(station);
+	/* Remove from list */
+	pos = g_sequence_iter_get_position(iter);
+	g_sequence_remove(iter);
 
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-							  copy_func_object_ref, NULL);
-	}
+	/* Save */
+	gv_station_list_journal_remove(self, pos);
 
 	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_REMOVED], 0, station);
+	gv_station_list_emit_change(self, GV_STATION_LIST_CHANGE_REMOVED, station, pos, -1);
 
-	/* Save */
-	gv_station_list_save_delayed(self);
+	/* Unown the station, last, so that it's still valid when the
+	 * signal is emitted.
+	 */
+	g_object_unref(station);
 }
 
 void
 gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *similar_item;
+	GSequenceIter *iter;
 
 	g_return_if_fail(station != NULL);
 
@@ -868,47 +2565,53 @@ gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 	/* Check that the station is not already part of the list.
 	 * Duplicates are a programming error, we must warn about that.
 	 * Identical fields are an user error.
-	 * Warnings and such are encapsulated in the GCompareFunc used
-	 * here, this is messy but temporary (hopefully).
+	 * Warnings and such are encapsulated in the helper used here.
 	 */
-	similar_item = g_list_find_custom(priv->stations, station,
-					  (GCompareFunc) are_stations_similar);
-	if (similar_item)
+	if (has_similar_station(self, station))
 		return;
 
+	/* Uids must be unique */
+	gv_station_list_ensure_unique_uid(self, station);
+
+	/* Live iterators must not see the change */
+	gv_station_list_detach_iters(self);
+
 	/* Take ownership of the station */
 	g_object_ref_sink(station);
 
-	/* Add to the list at the right position */
-	priv->stations = g_list_insert(priv->stations, station, pos);
+	/* Add to the list at the right position. A negative position,
+	 * or a position larger than the length, means appending.
+	 */
+	iter = g_sequence_get_iter_at_pos(priv->stations, pos);
+	iter = g_sequence_insert_before(iter, station);
+	gv_station_list_index_station(self, station, iter);
 
 	/* Connect to notify signal */
 	g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
 
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-							  copy_func_object_ref, NULL);
-	}
-
-	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_ADDED], 0, station);
+	/* Insert at a random position in the shuffle order */
+	gv_station_list_shuffle_add(self, station);
 
 	/* Save */
-	gv_station_list_save_delayed(self);
+	gv_station_list_journal_insert(self, station, iter);
+
+	/* Emit a signal */
+	gv_station_list_emit_change(self, GV_STATION_LIST_CHANGE_ADDED, station,
+				    g_sequence_iter_get_position(iter), -1);
 }
 
 void
 gv_station_list_insert_before(GvStationList *self, GvStation *station, GvStation *before)
 {
-	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
 	gint pos;
 
 	g_return_if_fail(before != NULL);
 
-	pos = g_list_index(priv->stations, before);
-	g_return_if_fail(pos != -1);
+	iter = gv_station_list_lookup_iter(self, before);
+	g_return_if_fail(iter != NULL);
+
+	pos = g_sequence_iter_get_position(iter);
 
 	gv_station_list_insert(self, station, pos);
 }
@@ -916,13 +2619,15 @@ gv_station_list_insert_before(GvStationList *self, GvStation *station, GvStation
 void
 gv_station_list_insert_after(GvStationList *self, GvStation *station, GvStation *after)
 {
-	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
 	gint pos;
 
 	g_return_if_fail(after != NULL);
 
-	pos = g_list_index(priv->stations, after);
-	g_return_if_fail(pos != -1);
+	iter = gv_station_list_lookup_iter(self, after);
+	g_return_if_fail(iter != NULL);
+
+	pos = g_sequence_iter_get_position(iter);
 
 	pos += 1;
 	gv_station_list_insert(self, station, pos);
@@ -944,36 +2649,44 @@ void
 gv_station_list_move(GvStationList *self, GvStation *station, gint pos)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GSequenceIter *iter;
+	gint old_pos;
 
 	g_return_if_fail(station != NULL);
 
 	/* Find the station */
-	item = g_list_find(priv->stations, station);
-	g_return_if_fail(item != NULL);
+	iter = gv_station_list_lookup_iter(self, station);
+	g_return_if_fail(iter != NULL);
+	old_pos = g_sequence_iter_get_position(iter);
 
-	/* Move it */
-	priv->stations = g_list_insert(priv->stations, station, pos);
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
+	/* Live iterators must not see the change */
+	gv_station_list_detach_iters(self);
 
-	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_MOVED], 0, station);
+	/* Move it before the station currently at this position. Moving
+	 * keeps the iter valid, so there's no need to update the node.
+	 */
+	g_sequence_move(iter, g_sequence_get_iter_at_pos(priv->stations, pos));
 
 	/* Save */
-	gv_station_list_save_delayed(self);
+	gv_station_list_journal_move(self, old_pos, pos);
+
+	/* Emit a signal */
+	gv_station_list_emit_change(self, GV_STATION_LIST_CHANGE_MOVED, station,
+				    g_sequence_iter_get_position(iter), old_pos);
 }
 
 void
 gv_station_list_move_before(GvStationList *self, GvStation *station, GvStation *before)
 {
-	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
 	gint pos;
 
 	g_return_if_fail(before != NULL);
 
-	pos = g_list_index(priv->stations, before);
-	g_return_if_fail(pos != -1);
+	iter = gv_station_list_lookup_iter(self, before);
+	g_return_if_fail(iter != NULL);
+
+	pos = g_sequence_iter_get_position(iter);
 
 	gv_station_list_move(self, station, pos);
 }
@@ -981,13 +2694,15 @@ gv_station_list_move_before(GvStationList *self, GvStation *station, GvStation *
 void
 gv_station_list_move_after(GvStationList *self, GvStation *station, GvStation *after)
 {
-	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
 	gint pos;
 
 	g_return_if_fail(after != NULL);
 
-	pos = g_list_index(priv->stations, after);
-	g_return_if_fail(pos != -1);
+	iter = gv_station_list_lookup_iter(self, after);
+	g_return_if_fail(iter != NULL);
+
+	pos = g_sequence_iter_get_position(iter);
 
 	pos += 1;
 	gv_station_list_move(self, station, pos);
@@ -1005,192 +2720,316 @@ gv_station_list_move_last(GvStationList *self, GvStation *station)
 	gv_station_list_move(self, station, -1);
 }
 
-GvStation *
-gv_station_list_prev(GvStationList *self, GvStation *station,
-		     gboolean repeat, gboolean shuffle)
+/* Start a batch of changes. Until the batch is committed, changes are not
+ * notified with the station-* signals, and they're not saved. Batches can
+ * be nested, only the outermost one counts.
+ */
+void
+gv_station_list_begin_batch(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
 
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-								  copy_func_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
+	priv->batch_depth += 1;
+}
+
+/* Commit a batch of changes. This saves the changes at once, then emits
+ * the stations-changed signal with the diff, if anything changed.
+ */
+void
+gv_station_list_commit_batch(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *changes;
+	GPtrArray *modified;
+	guint i;
+
+	g_return_if_fail(priv->batch_depth > 0);
+
+	priv->batch_depth -= 1;
+	if (priv->batch_depth > 0)
+		return;
+
+	/* Save */
+	if (priv->batch_n_records > 0) {
+		gv_station_list_write_journal(self, priv->batch_journal->str,
+					      priv->batch_journal->len,
+					      priv->batch_n_records);
+		g_string_truncate(priv->batch_journal, 0);
+		priv->batch_n_records = 0;
+	}
+
+	/* Build the diff, modifications come last */
+	changes = priv->batch_changes;
+	priv->batch_changes = g_ptr_array_new_with_free_func
+		((GDestroyNotify) gv_station_list_change_free);
+	modified = gv_station_list_collect_modified(self, changes);
+	for (i = 0; i < modified->len; i++)
+		g_ptr_array_add(changes, g_ptr_array_index(modified, i));
+	g_ptr_array_free(modified, TRUE);
+	g_hash_table_remove_all(priv->batch_modified);
+
+	/* Emit a signal */
+	if (changes->len > 0) {
+		DEBUG("Station list batch committed, %u changes", changes->len);
+		g_signal_emit(self, signals[SIGNAL_STATIONS_CHANGED], 0, changes);
 	}
 
+	g_ptr_array_unref(changes);
+}
+
+static gboolean
+when_timeout_commit_batch(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	priv->batch_timeout_id = 0;
+	gv_station_list_commit_batch(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Start a batch that commits itself a bit later. This is for changes that
+ * come one at a time from the outside, like a script calling the D-Bus
+ * methods in a loop: the changes that come in a row end up in one batch.
+ */
+void
+gv_station_list_defer_batch(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->batch_timeout_id > 0)
+		return;
+
+	gv_station_list_begin_batch(self);
+	priv->batch_timeout_id =
+		g_timeout_add(BATCH_DELAY, when_timeout_commit_batch, self);
+}
+
+static GvStation *
+gv_station_list_shuffled_prev(GvStationList *self, GvStation *station, gboolean repeat)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *shuffled;
+	GvStationNode *node;
+	guint last;
+
+	/* Create shuffle order if needed */
+	gv_station_list_shuffle_create(self);
+	shuffled = priv->shuffled;
+
 	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (shuffled->len == 0)
 		return NULL;
 
 	/* Return last station for NULL argument */
+	last = shuffled->len - 1;
 	if (station == NULL)
-		return g_list_last(stations)->data;
+		return gv_station_list_shuffle_pick(self, last);
 
 	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
+	node = gv_station_list_lookup_node(self, station);
+	if (node == NULL)
 		return NULL;
 
 	/* Return previous station if any */
-	item = item->prev;
-	if (item)
-		return item->data;
+	if (node->shuffle_pos > 0)
+		return gv_station_list_shuffle_pick(self, node->shuffle_pos - 1);
 
 	/* Without repeat, there's no more station */
 	if (!repeat)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the last station */
-	if (shuffle) {
-		GList *last_item;
+	/* With repeat, we re-shuffle, then return the last station */
+	gv_station_list_shuffle(self);
 
-		stations = g_list_shuffle(priv->shuffled);
+	/* In case the last station (that we're about to return) happens to be
+	 * the same as the current station, we do a little a magic trick.
+	 */
+	if (g_ptr_array_index(shuffled, last) == station)
+		gv_station_list_shuffle_swap(self, 0, last);
 
-		/* In case the last station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		last_item = g_list_last(stations);
-		if (last_item->data == station) {
-			stations = g_list_remove_link(stations, last_item);
-			stations = g_list_prepend(stations, last_item->data);
-			g_list_free(last_item);
-		}
+	return gv_station_list_shuffle_pick(self, last);
+}
 
-		priv->shuffled = stations;
-	}
+static GvStation *
+gv_station_list_shuffled_next(GvStationList *self, GvStation *station, gboolean repeat)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *shuffled;
+	GvStationNode *node;
+	guint last;
+
+	/* Create shuffle order if needed */
+	gv_station_list_shuffle_create(self);
+	shuffled = priv->shuffled;
+
+	/* If the station list is empty, bail out */
+	if (shuffled->len == 0)
+		return NULL;
+
+	/* Return first station for NULL argument */
+	if (station == NULL)
+		return gv_station_list_shuffle_pick(self, 0);
+
+	/* Try to find station in station list */
+	node = gv_station_list_lookup_node(self, station);
+	if (node == NULL)
+		return NULL;
+
+	/* Return next station if any */
+	last = shuffled->len - 1;
+	if (node->shuffle_pos < last)
+		return gv_station_list_shuffle_pick(self, node->shuffle_pos + 1);
 
-	return g_list_last(stations)->data;
+	/* Without repeat, there's no more station */
+	if (!repeat)
+		return NULL;
+
+	/* With repeat, we re-shuffle, then return the first station */
+	gv_station_list_shuffle(self);
+
+	/* In case the first station (that we're about to return) happens to be
+	 * the same as the current station, we do a little a magic trick.
+	 */
+	if (g_ptr_array_index(shuffled, 0) == station)
+		gv_station_list_shuffle_swap(self, 0, last);
+
+	return gv_station_list_shuffle_pick(self, 0);
 }
 
 GvStation *
-gv_station_list_next(GvStationList *self, GvStation *station,
+gv_station_list_prev(GvStationList *self, GvStation *station,
 		     gboolean repeat, gboolean shuffle)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
+	GSequenceIter *iter;
 
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-								  copy_func_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
-	}
+	/* Shuffle has its own list of stations */
+	if (shuffle)
+		return gv_station_list_shuffled_prev(self, station, repeat);
+
+	/* Discard the shuffle order, if any */
+	gv_station_list_shuffle_destroy(self);
 
 	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (g_sequence_is_empty(priv->stations))
 		return NULL;
 
-	/* Return first station for NULL argument */
+	/* Return last station for NULL argument */
 	if (station == NULL)
-		return stations->data;
+		return gv_station_list_last(self);
 
 	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL)
 		return NULL;
 
-	/* Return next station if any */
-	item = item->next;
-	if (item)
-		return item->data;
+	/* Return previous station if any */
+	if (!g_sequence_iter_is_begin(iter))
+		return g_sequence_get(g_sequence_iter_prev(iter));
 
 	/* Without repeat, there's no more station */
 	if (!repeat)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the first station */
-	if (shuffle) {
-		GList *first_item;
+	/* With repeat, return the last station */
+	return gv_station_list_last(self);
+}
+
+GvStation *
+gv_station_list_next(GvStationList *self, GvStation *station,
+		     gboolean repeat, gboolean shuffle)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
+
+	/* Shuffle has its own list of stations */
+	if (shuffle)
+		return gv_station_list_shuffled_next(self, station, repeat);
 
-		stations = g_list_shuffle(priv->shuffled);
+	/* Discard the shuffle order, if any */
+	gv_station_list_shuffle_destroy(self);
 
-		/* In case the first station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		first_item = g_list_first(stations);
-		if (first_item->data == station) {
-			stations = g_list_remove_link(stations, first_item);
-			stations = g_list_append(stations, first_item->data);
-			g_list_free(first_item);
-		}
+	/* If the station list is empty, bail out */
+	if (g_sequence_is_empty(priv->stations))
+		return NULL;
 
-		priv->shuffled = stations;
-	}
+	/* Return first station for NULL argument */
+	if (station == NULL)
+		return gv_station_list_first(self);
 
-	return stations->data;
+	/* Try to find station in station list */
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL)
+		return NULL;
+
+	/* Return next station if any */
+	iter = g_sequence_iter_next(iter);
+	if (!g_sequence_iter_is_end(iter))
+		return g_sequence_get(iter);
+
+	/* Without repeat, there's no more station */
+	if (!repeat)
+		return NULL;
+
+	/* With repeat, return the first station */
+	return gv_station_list_first(self);
 }
 
 GvStation *
 gv_station_list_first(GvStationList *self)
 {
-	GList *stations = self->priv->stations;
+	GSequence *stations = self->priv->stations;
 
-	if (stations == NULL)
+	if (g_sequence_is_empty(stations))
 		return NULL;
 
-	return g_list_first(stations)->data;
+	return g_sequence_get(g_sequence_get_begin_iter(stations));
 }
 
 GvStation *
 gv_station_list_last(GvStationList *self)
 {
-	GList *stations = self->priv->stations;
+	GSequence *stations = self->priv->stations;
 
-	if (stations == NULL)
+	if (g_sequence_is_empty(stations))
 		return NULL;
 
-	return g_list_last(stations)->data;
+	return g_sequence_get(g_sequence_iter_prev(g_sequence_get_end_iter(stations)));
 }
 
 GvStation *
 gv_station_list_at(GvStationList *self, guint n)
 {
-	GList *stations = self->priv->stations;
-	GList *item;
+	GSequence *stations = self->priv->stations;
+	GSequenceIter *iter;
 
-	if (stations == NULL)
+	if (n >= (guint) g_sequence_get_length(stations))
 		return NULL;
 
-	item = g_list_nth(stations, n);
-	if (item == NULL)
-		return NULL;
+	iter = g_sequence_get_iter_at_pos(stations, n);
 
-	return item->data;
+	return g_sequence_get(iter);
 }
 
 GvStation *
 gv_station_list_find(GvStationList *self, GvStation *station)
 {
-	GList *stations = self->priv->stations;
-	GList *item;
+	GvStationListPrivate *priv = self->priv;
+
+	if (station == NULL)
+		return NULL;
 
-	item = g_list_find(stations, station);
+	if (!g_hash_table_contains(priv->station_nodes, station))
+		return NULL;
 
-	return item ? item->data : NULL;
+	return station;
 }
 
 GvStation *
 gv_station_list_find_by_name(GvStationList *self, const gchar *name)
 {
-	GList *item;
-
 	/* Ensure station name is valid */
 	if (name == NULL) {
 		WARNING("Attempting to find a station with NULL name");
@@ -1201,56 +3040,31 @@ gv_station_list_find_by_name(GvStationList *self, const gchar *name)
 	if (!g_strcmp0(name, ""))
 		return NULL;
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(name, gv_station_get_name(station)))
-			return station;
-	}
-
-	return NULL;
+	return gv_station_list_index_lookup(self, self->priv->name_index, name);
 }
 
 GvStation *
 gv_station_list_find_by_uri(GvStationList *self, const gchar *uri)
 {
-	GList *item;
-
-	/* Ensure station name is valid */
+	/* Ensure station uri is valid */
 	if (uri == NULL) {
 		WARNING("Attempting to find a station with NULL uri");
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uri, gv_station_get_uri(station)))
-			return station;
-	}
-
-	return NULL;
+	return gv_station_list_index_lookup(self, self->priv->uri_index, uri);
 }
 
 GvStation *
 gv_station_list_find_by_uid(GvStationList *self, const gchar *uid)
 {
-	GList *item;
-
-	/* Ensure station name is valid */
+	/* Ensure station uid is valid */
 	if (uid == NULL) {
 		WARNING("Attempting to find a station with NULL uid");
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uid, gv_station_get_uid(station)))
-			return station;
-	}
-
-	return NULL;
+	return gv_station_list_index_lookup(self, self->priv->uid_index, uid);
 }
 
 GvStation *
@@ -1263,37 +3077,127 @@ gv_station_list_find_by_guessing(GvStationList *self, const gchar *string)
 		return gv_station_list_find_by_name(self, string);
 }
 
+typedef struct {
+	GvStation *station;
+	guint rank;
+	gint pos;
+} SearchMatch;
+
+static gint
+search_match_compare(const SearchMatch *a, const SearchMatch *b)
+{
+	if (a->rank != b->rank)
+		return a->rank < b->rank ? -1 : 1;
+
+	return a->pos - b->pos;
+}
+
+/* Search stations by name or uri, ignoring case and accents. Stations
+ * whose name starts with the query come first, then stations whose name
+ * contains the query, then stations whose uri contains the query. A max
+ * of zero means no limit. Free the list with g_list_free().
+ */
+GList *
+gv_station_list_search(GvStationList *self, const gchar *query, guint max)
+{
+	GvStationListPrivate *priv = self->priv;
+	GHashTable *candidates;
+	GHashTableIter iter;
+	GArray *matches;
+	GList *result = NULL;
+	gpointer station;
+	gchar *needle;
+	guint i;
+
+	g_return_val_if_fail(query != NULL, NULL);
+
+	needle = search_normalize(query);
+	if (needle == NULL || *needle == '\0') {
+		g_free(needle);
+		return NULL;
+	}
+
+	candidates = search_index_candidates(priv->search_index, priv->station_nodes, needle);
+	if (candidates == NULL) {
+		g_free(needle);
+		return NULL;
+	}
+
+	matches = g_array_new(FALSE, FALSE, sizeof(SearchMatch));
+
+	g_hash_table_iter_init(&iter, candidates);
+	while (g_hash_table_iter_next(&iter, &station, NULL)) {
+		GvStationNode *node = gv_station_list_lookup_node(self, station);
+		SearchMatch match;
+
+		if (node->search_name && g_str_has_prefix(node->search_name, needle))
+			match.rank = 0;
+		else if (node->search_name && strstr(node->search_name, needle))
+			match.rank = 1;
+		else if (node->search_uri && strstr(node->search_uri, needle))
+			match.rank = 2;
+		else
+			continue;
+
+		match.station = station;
+		match.pos = g_sequence_iter_get_position(node->iter);
+		g_array_append_val(matches, match);
+	}
+
+	g_array_sort(matches, (GCompareFunc) search_match_compare);
+
+	if (max == 0 || max > matches->len)
+		max = matches->len;
+
+	for (i = max; i > 0; i--)
+		result = g_list_prepend(result, g_array_index(matches, SearchMatch, i - 1).station);
+
+	g_array_free(matches, TRUE);
+	g_free(needle);
+
+	return result;
+}
+
+/* Save the station list synchronously. If a save is in flight in the
+ * background, wait for it to complete first, so that the last write wins.
+ */
 void
 gv_station_list_save(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
 	const gchar *path = priv->save_path;
+	GPtrArray *snapshot;
 	GError *err = NULL;
-	gboolean ret;
 
-	/* Save the station list */
-	ret = save_station_list_to_file(priv->stations, path, &err);
-	if (ret == TRUE) {
-		INFO("Station list saved to '%s'", path);
-	} else {
-		WARNING("Failed to save station list: %s", err->message);
-		if (priv->finalization == FALSE)
-			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
-						_("Failed to save station list"), err->message);
-		g_error_free(err);
-	}
+	/* Wait for the background save */
+	gv_station_list_wait_for_save(self);
+
+	/* Save the station list, this also resets the journal */
+	gv_station_list_close_journal(self);
+	snapshot = make_station_list_snapshot(priv->stations);
+	g_string_truncate(priv->batch_journal, 0);
+	priv->batch_n_records = 0;
+	save_station_list_to_file(snapshot, path, &err);
+	gv_station_list_report_save(self, path, err);
+	if (err == NULL && priv->finalization == FALSE)
+		gv_station_list_open_journal(self, 0);
+	g_clear_error(&err);
+	g_ptr_array_unref(snapshot);
 }
 
 void
 gv_station_list_load(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
+	GList *stations = NULL;
+	GSequenceIter *iter;
 	GList *item;
+	gboolean uids_changed = FALSE;
 
 	TRACE("%p", self);
 
 	/* This should be called only once at startup */
-	g_assert_null(priv->stations);
+	g_assert_true(g_sequence_is_empty(priv->stations));
 
 	/* If a single load path is defined, try to load the station list
 	 * from there. It must work. Failing to load from this path is a
@@ -1305,7 +3209,7 @@ gv_station_list_load(GvStationList *self)
 		GError *err = NULL;
 		gboolean ret;
 
-		ret = load_station_list_from_file(path, &priv->stations, &err);
+		ret = load_station_list_from_file(path, &stations, &err);
 		if (ret == FALSE) {
 			ERROR("Failed to load station list from '%s': %s",
 			      path, err->message);
@@ -1332,7 +3236,7 @@ gv_station_list_load(GvStationList *self)
 			GError *err = NULL;
 			gboolean ret;
 
-			ret = load_station_list_from_file(path, &priv->stations, &err);
+			ret = load_station_list_from_file(path, &stations, &err);
 			if (ret == FALSE) {
 				if (err->code != G_FILE_ERROR_NOENT)
 					WARNING("Failed to load station list from '%s': %s",
@@ -1356,7 +3260,7 @@ gv_station_list_load(GvStationList *self)
 		gboolean ret;
 
 		ret = load_station_list_from_string(priv->default_stations,
-						    &priv->stations, NULL);
+						    &stations, NULL);
 
 		if (ret == FALSE) {
 			ERROR("Failed to load station list from hard-coded default");
@@ -1368,16 +3272,45 @@ gv_station_list_load(GvStationList *self)
 	}
 
 finish:
-	/* Dump the number of stations */
-	DEBUG("Station list has %u stations", gv_station_list_length(self));
+	/* Add each station to the sequence, which takes ownership */
+	for (item = stations; item; item = item->next)
+		g_sequence_append(priv->stations, item->data);
+	g_list_free(stations);
+
+	/* If the station list was loaded from the save path, there might be
+	 * a journal of changes to replay. From now on, changes are appended
+	 * to this journal.
+	 */
+	if (priv->load_path && !g_strcmp0(priv->load_path, priv->save_path)) {
+		gint n_records;
 
-	/* Register a notify handler for each station */
-	for (item = priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
+		n_records = replay_journal(priv->load_path, priv->stations);
+		if (n_records >= 0) {
+			INFO("Station list journal replayed, %d records", n_records);
+			gv_station_list_open_journal(self, n_records);
+		}
+	}
+
+	/* Index each station and register a notify handler. Uids that come
+	 * from the files are checked as they would be on insertion, and the
+	 * station list is saved if some of them had to change.
+	 */
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter); iter = g_sequence_iter_next(iter)) {
+		GvStation *station = g_sequence_get(iter);
 
+		if (gv_station_list_ensure_unique_uid(self, station))
+			uids_changed = TRUE;
+		gv_station_list_index_station(self, station, iter);
 		g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
 	}
 
+	if (uids_changed)
+		gv_station_list_save_delayed(self);
+
+	/* Dump the number of stations */
+	DEBUG("Station list has %u stations", gv_station_list_length(self));
+
 	/* Emit a signal to indicate that the list has been loaded */
 	g_signal_emit(self, signals[SIGNAL_LOADED], 0);
 }
@@ -1387,7 +3320,7 @@ gv_station_list_length(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
 
-	return g_list_length(priv->stations);
+	return g_sequence_get_length(priv->stations);
 }
 
 /* Create a new station list with load paths and save path derived
@@ -1438,38 +3371,77 @@ gv_station_list_finalize(GObject *object)
 {
 	GvStationList *self = GV_STATION_LIST(object);
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GSequenceIter *iter;
 
 	TRACE("%p", object);
 
 	/* Indicate that the object is being finalized */
 	priv->finalization = TRUE;
 
-	/* Run any pending save operation */
-	if (priv->save_timeout_id > 0)
-		when_timeout_save_station_list(self);
+	/* Run any pending save operation, synchronously. Note that a save
+	 * might be in flight, gv_station_list_save() takes care of that.
+	 * This is also where the journal is compacted.
+	 */
+	if (priv->save_timeout_id > 0 || priv->save_again ||
+	    priv->journal_n_records > 0 || priv->batch_n_records > 0) {
+		g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
+		gv_station_list_save(self);
+	} else {
+		gv_station_list_wait_for_save(self);
+	}
+	gv_station_list_close_journal(self);
+
+	/* Detach iterators that are still alive */
+	gv_station_list_detach_iters(self);
+
+	/* Drop a deferred batch, the changes were saved above */
+	if (priv->batch_timeout_id > 0) {
+		g_clear_handle_id(&priv->batch_timeout_id, g_source_remove);
+		priv->batch_depth -= 1;
+	}
+
+	/* Free a batch that was never committed */
+	if (priv->batch_depth > 0)
+		WARNING("Station list finalized within a batch");
+	g_ptr_array_unref(priv->batch_changes);
+	g_hash_table_destroy(priv->batch_modified);
+	g_string_free(priv->batch_journal, TRUE);
 
-	/* Free shuffled station list */
-	g_list_free_full(priv->shuffled, g_object_unref);
+	/* Free shuffle order */
+	gv_station_list_shuffle_destroy(self);
+
+	/* Free lookup indexes */
+	g_hash_table_destroy(priv->search_index);
+	g_hash_table_destroy(priv->uri_index);
+	g_hash_table_destroy(priv->name_index);
+	g_hash_table_destroy(priv->uid_index);
+	g_hash_table_destroy(priv->station_nodes);
 
 	/* Free station list and ensure no memory is leaked. This works only if the
 	 * station list is the last object to hold references to stations. In other
 	 * words, the station list must be the last object finalized.
 	 */
-	for (item = priv->stations; item; item = item->next) {
-		g_object_add_weak_pointer(G_OBJECT(item->data), &(item->data));
-		g_object_unref(item->data);
-		if (item->data != NULL)
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter); iter = g_sequence_iter_next(iter)) {
+		gpointer station = g_sequence_get(iter);
+
+		g_object_add_weak_pointer(G_OBJECT(station), &station);
+		g_object_unref(station);
+		if (station != NULL) {
 			WARNING("Station '%s' has not been finalized!",
-				gv_station_get_name_or_uri(GV_STATION(item->data)));
+				gv_station_get_name_or_uri(GV_STATION(station)));
+			g_object_remove_weak_pointer(G_OBJECT(station), &station);
+		}
 	}
-	g_list_free(priv->stations);
+	g_sequence_free(priv->stations);
 
 	/* Free resources */
 	g_free(priv->default_stations);
 	g_strfreev(priv->load_paths);
 	g_free(priv->save_path);
 	g_free(priv->load_path);
+	g_cond_clear(&priv->save_cond);
+	g_mutex_clear(&priv->save_mutex);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_FINALIZE(gv_station_list, object);
@@ -1493,6 +3465,26 @@ gv_station_list_init(GvStationList *self)
 
 	/* Initialize private pointer */
 	self->priv = gv_station_list_get_instance_private(self);
+
+	/* Initialize background save */
+	g_mutex_init(&self->priv->save_mutex);
+	g_cond_init(&self->priv->save_cond);
+
+	/* Initialize batch of changes */
+	self->priv->batch_changes = g_ptr_array_new_with_free_func
+		((GDestroyNotify) gv_station_list_change_free);
+	self->priv->batch_modified = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+							  g_object_unref, NULL);
+	self->priv->batch_journal = g_string_new(NULL);
+
+	/* Initialize station sequence and lookup indexes */
+	self->priv->stations = g_sequence_new(NULL);
+	self->priv->station_nodes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+							 (GDestroyNotify) gv_station_node_free);
+	self->priv->uid_index = station_index_new();
+	self->priv->name_index = station_index_new();
+	self->priv->uri_index = station_index_new();
+	self->priv->search_index = search_index_new();
 }
 
 static void
@@ -1553,4 +3545,10 @@ gv_station_list_class_init(GvStationListClass *class)
 		g_signal_new("station-moved", G_TYPE_FROM_CLASS(class),
 			     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 1, G_TYPE_OBJECT);
+
+	/* The argument is a GPtrArray of GvStationListChange */
+	signals[SIGNAL_STATIONS_CHANGED] =
+		g_signal_new("stations-changed", G_TYPE_FROM_CLASS(class),
+			     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+			     G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
 }
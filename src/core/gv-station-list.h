@@ -34,6 +34,24 @@ G_DECLARE_FINAL_TYPE(GvStationList, gv_station_list, GV, STATION_LIST, GObject)
 
 typedef struct _GvStationListIter GvStationListIter;
 
+typedef enum {
+	GV_STATION_LIST_CHANGE_ADDED,
+	GV_STATION_LIST_CHANGE_REMOVED,
+	GV_STATION_LIST_CHANGE_MOVED,
+	GV_STATION_LIST_CHANGE_MODIFIED,
+} GvStationListChangeKind;
+
+/* An entry of the diff emitted with the stations-changed signal. Entries
+ * must be applied in order, the position is the one right after the change
+ * (or right before, for a removal). Only moves have an old position.
+ */
+typedef struct {
+	GvStationListChangeKind kind;
+	GvStation *station;
+	gint position;
+	gint old_position;
+} GvStationListChange;
+
 /* Methods */
 
 GvStationList *gv_station_list_new_from_xdg_dirs(const gchar *default_stations);
@@ -57,6 +75,10 @@ void gv_station_list_move_after (GvStationList *self, GvStation *station, GvStat
 void gv_station_list_move_first (GvStationList *self, GvStation *station);
 void gv_station_list_move_last  (GvStationList *self, GvStation *station);
 
+void gv_station_list_begin_batch (GvStationList *self);
+void gv_station_list_commit_batch(GvStationList *self);
+void gv_station_list_defer_batch (GvStationList *self);
+
 GvStation *gv_station_list_first(GvStationList *self);
 GvStation *gv_station_list_last (GvStationList *self);
 GvStation *gv_station_list_at   (GvStationList *self, guint n);
@@ -71,6 +93,8 @@ GvStation *gv_station_list_find_by_uri     (GvStationList *self, const gchar *ur
 GvStation *gv_station_list_find_by_uid     (GvStationList *self, const gchar *uid);
 GvStation *gv_station_list_find_by_guessing(GvStationList *self, const gchar *string);
 
+GList *gv_station_list_search(GvStationList *self, const gchar *query, guint max);
+
 /* Iterator methods */
 
 GvStationListIter *gv_station_list_iter_new (GvStationList *self);
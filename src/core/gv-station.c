@@ -37,7 +37,7 @@
 enum {
 	/* Reserved */
 	PROP_0,
-	/* Set at construct-time */
+	/* Set at construct-time, or derived from the uri */
 	PROP_UID,
 	/* Set by user - station definition */
 	PROP_NAME,
@@ -74,7 +74,7 @@ struct _GvStationPrivate {
 	 * Properties
 	 */
 
-	/* Set at construct-time */
+	/* Set at construct-time, or derived from the uri */
 	gchar *uid;
 	/* Set by user - station definition */
 	gchar *name;
@@ -84,6 +84,9 @@ struct _GvStationPrivate {
 	gchar *user_agent;
 	/* Learnt along the way */
 	GSList *stream_uris;
+	gchar *preferred_stream_uri;
+	/* Playlist download in progress */
+	GvPlaylist *playlist;
 };
 
 typedef struct _GvStationPrivate GvStationPrivate;
@@ -101,27 +104,87 @@ G_DEFINE_TYPE_WITH_PRIVATE(GvStation, gv_station, G_TYPE_INITIALLY_UNOWNED)
  * Helpers
  */
 
+/* The uid is part of D-Bus object paths, hence the restricted charset */
+static gboolean
+is_uid_valid(const gchar *uid)
+{
+	const gchar *ptr;
+
+	if (uid == NULL || *uid == '\0')
+		return FALSE;
+
+	for (ptr = uid; *ptr != '\0'; ptr++)
+		if (!g_ascii_isalnum(*ptr) && *ptr != '_')
+			return FALSE;
+
+	return TRUE;
+}
+
+/* Derive the uid from the uri, so that it's the same from one run to
+ * another, even for stations that were never saved. It's then saved
+ * along with the station, and doesn't change if the uri changes.
+ */
+static gchar *
+make_uid(const gchar *uri)
+{
+	gchar *checksum;
+	gchar *uid;
+
+	/* Without a uri, there's nothing to derive it from */
+	if (uri == NULL)
+		return g_strdup_printf("%08x%08x", g_random_int(), g_random_int());
+
+	checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, uri, -1);
+	uid = g_strndup(checksum, 16);
+	g_free(checksum);
+
+	return uid;
+}
+
 static gpointer
 copy_func_strdup(gconstpointer src, gpointer data G_GNUC_UNUSED)
 {
 	return g_strdup(src);
 }
 
+static gboolean
+str_slist_equal(GSList *a, GSList *b)
+{
+	while (a && b) {
+		if (g_strcmp0(a->data, b->data))
+			return FALSE;
+		a = a->next;
+		b = b->next;
+	}
+
+	return a == NULL && b == NULL;
+}
+
+/* The preferred stream comes first, it's the one that is played.
+ * Nothing is notified if nothing changed, as it would restart the
+ * playback.
+ */
 static void
 gv_station_set_stream_uris(GvStation *self, GSList *uris)
 {
 	GvStationPrivate *priv = self->priv;
+	GSList *list, *link;
 
-	if (uris == priv->stream_uris)
-		return;
+	list = g_slist_copy_deep(uris, copy_func_strdup, NULL);
 
-	if (priv->stream_uris) {
-		g_slist_free_full(priv->stream_uris, g_free);
-		priv->stream_uris = NULL;
+	link = g_slist_find_custom(list, priv->preferred_stream_uri, (GCompareFunc) g_strcmp0);
+	if (link && link != list) {
+		list = g_slist_remove_link(list, link);
+		list = g_slist_concat(link, list);
 	}
 
-	if (uris)
-		priv->stream_uris = g_slist_copy_deep(uris, copy_func_strdup, NULL);
+	if (str_slist_equal(list, priv->stream_uris)) {
+		g_slist_free_full(list, g_free);
+		return;
+	}
+
+	g_slist_free_full(priv->stream_uris, g_free);
+	priv->stream_uris = list;
 
 	g_object_notify(G_OBJECT(self), "stream-uris");
 }
@@ -144,16 +207,43 @@ gv_station_set_stream_uri(GvStation *self, const gchar *uri)
  * Signal handlers
  */
 
+static void
+on_playlist_first_stream_found(GvPlaylist *playlist G_GNUC_UNUSED,
+			       const gchar *uri,
+			       GvStation *self)
+{
+	GvStationPrivate *priv = self->priv;
+
+	/* Start with the first stream, unless there are cached streams */
+	if (priv->stream_uris == NULL)
+		gv_station_set_stream_uri(self, uri);
+}
+
 static void
 on_playlist_downloaded(GvPlaylist *playlist,
 		       GvStation *self)
 {
+	GvStationPrivate *priv = self->priv;
 	GSList *streams;
 
 	streams = gv_playlist_get_stream_list(playlist);
-	gv_station_set_stream_uris(self, streams);
 
-	g_object_unref(playlist);
+	/* The stream uris might have been set from the cache already,
+	 * keep them if the download failed. If the uri didn't say it was
+	 * a playlist, it might just be a stream that we failed to probe.
+	 */
+	if (streams)
+		gv_station_set_stream_uris(self, streams);
+	else if (priv->stream_uris == NULL &&
+		 gv_playlist_get_status(playlist) != GV_PLAYLIST_STATUS_CANCELLED &&
+		 gv_playlist_get_format(priv->uri) == GV_PLAYLIST_FORMAT_UNKNOWN)
+		gv_station_set_stream_uri(self, priv->uri);
+
+	g_signal_emit(self, signals[SIGNAL_PLAYLIST_DOWNLOADED], 0, playlist);
+
+	g_signal_handlers_disconnect_by_data(playlist, self);
+	if (playlist == priv->playlist)
+		g_clear_object(&priv->playlist);
 }
 
 /*
@@ -166,6 +256,30 @@ gv_station_get_uid(GvStation *self)
 	return self->priv->uid;
 }
 
+void
+gv_station_set_uid(GvStation *self, const gchar *uid)
+{
+	GvStationPrivate *priv = self->priv;
+
+	/* At construct-time, a NULL uid means that it's derived from the
+	 * uri. Afterwards, setting the uid to NULL is discarded.
+	 */
+	if (uid == NULL)
+		return;
+
+	if (!is_uid_valid(uid)) {
+		WARNING("Invalid station uid '%s'. Ignoring.", uid);
+		return;
+	}
+
+	if (!g_strcmp0(priv->uid, uid))
+		return;
+
+	g_free(priv->uid);
+	priv->uid = g_strdup(uid);
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_UID]);
+}
+
 const gchar *
 gv_station_get_name(GvStation *self)
 {
@@ -225,12 +339,14 @@ gv_station_set_uri(GvStation *self, const gchar *uri)
 
 	g_free(priv->uri);
 	priv->uri = g_strdup(uri);
+	g_clear_pointer(&priv->preferred_stream_uri, g_free);
 
 	/* The uri either refers to a playlist, either to an audio stream.
-	 * We "guess" it right now:  if it does not seem to be a playlist,
-	 * then it's probably an audio stream, and so we save it as such.
+	 * We "guess" it right now: if it can't be a playlist, then it's an
+	 * audio stream, and so we save it as such. Otherwise the playlist
+	 * is downloaded, and the response tells.
 	 */
-	if (gv_playlist_get_format(uri) == GV_PLAYLIST_FORMAT_UNKNOWN)
+	if (gv_playlist_maybe_playlist(uri) == FALSE)
 		gv_station_set_stream_uri(self, uri);
 	else
 		gv_station_set_stream_uri(self, NULL);
@@ -247,6 +363,12 @@ gv_station_get_name_or_uri(GvStation *self)
 	return priv->name ? priv->name : priv->uri;
 }
 
+gboolean
+gv_station_is_downloading_playlist(GvStation *self)
+{
+	return self->priv->playlist != NULL;
+}
+
 gboolean
 gv_station_get_insecure(GvStation *self)
 {
@@ -295,6 +417,35 @@ gv_station_get_stream_uris(GvStation *self)
 	return self->priv->stream_uris;
 }
 
+const gchar *
+gv_station_get_preferred_stream_uri(GvStation *self)
+{
+	return self->priv->preferred_stream_uri;
+}
+
+/* Remember the stream that works best, so that it's tried first next
+ * time. For a playlist, it's saved along with the cached streams.
+ */
+void
+gv_station_set_preferred_stream_uri(GvStation *self, const gchar *uri)
+{
+	GvStationPrivate *priv = self->priv;
+	GSList *uris;
+
+	if (!g_strcmp0(priv->preferred_stream_uri, uri))
+		return;
+
+	g_free(priv->preferred_stream_uri);
+	priv->preferred_stream_uri = g_strdup(uri);
+
+	if (priv->uri && gv_playlist_maybe_playlist(priv->uri))
+		gv_playlist_cache_set_preferred(priv->uri, uri);
+
+	uris = g_slist_copy(priv->stream_uris);
+	gv_station_set_stream_uris(self, uris);
+	g_slist_free(uris);
+}
+
 const gchar *
 gv_station_get_first_stream_uri(GvStation *self)
 {
@@ -353,6 +504,9 @@ gv_station_set_property(GObject *object,
 	TRACE_SET_PROPERTY(object, property_id, value, pspec);
 
 	switch (property_id) {
+	case PROP_UID:
+		gv_station_set_uid(self, g_value_get_string(value));
+		break;
 	case PROP_NAME:
 		gv_station_set_name(self, g_value_get_string(value));
 		break;
@@ -379,27 +533,85 @@ gboolean
 gv_station_download_playlist(GvStation *self)
 {
 	GvStationPrivate *priv = self->priv;
-	GvPlaylist *playlist;
 
 	if (priv->uri == NULL) {
 		WARNING("No uri to download");
 		return FALSE;
 	}
 
-	if (gv_playlist_get_format(priv->uri) == GV_PLAYLIST_FORMAT_UNKNOWN) {
+	/* Don't pile up downloads */
+	gv_station_cancel_playlist_download(self);
+
+	if (gv_playlist_maybe_playlist(priv->uri) == FALSE) {
 		WARNING("Uri doesn't seem to be a playlist");
 		return FALSE;
 	}
 
-	/* No need to keep track of that, it's unreferenced in the callback */
-	playlist = gv_playlist_new(priv->uri);
-	g_signal_connect_object(playlist, "downloaded", G_CALLBACK(on_playlist_downloaded), self, 0);
-	gv_playlist_download(playlist, priv->insecure,
+	/* Use the cached streams right away, if any. If they're stale, the
+	 * playlist is still downloaded to revalidate them.
+	 */
+	if (gv_station_load_cached_streams(self))
+		return TRUE;
+
+	priv->playlist = gv_playlist_new(priv->uri);
+	g_signal_connect_object(priv->playlist, "first-stream-found",
+				G_CALLBACK(on_playlist_first_stream_found), self, 0);
+	g_signal_connect_object(priv->playlist, "downloaded",
+				G_CALLBACK(on_playlist_downloaded), self, 0);
+	gv_playlist_download(priv->playlist, priv->insecure,
 			     priv->user_agent ? priv->user_agent : gv_core_user_agent);
 
 	return TRUE;
 }
 
+/* Set the streams found in the playlist cache, if any, without touching
+ * a download in progress. Return TRUE if they're fresh.
+ */
+gboolean
+gv_station_load_cached_streams(GvStation *self)
+{
+	GvStationPrivate *priv = self->priv;
+	GSList *cached;
+	gboolean fresh;
+
+	if (priv->uri == NULL)
+		return FALSE;
+
+	if (priv->preferred_stream_uri == NULL)
+		priv->preferred_stream_uri = gv_playlist_cache_get_preferred(priv->uri);
+
+	cached = gv_playlist_cache_lookup(priv->uri, &fresh);
+	if (cached == NULL)
+		return FALSE;
+
+	DEBUG("Using cached streams for playlist '%s'", priv->uri);
+	gv_station_set_stream_uris(self, cached);
+	g_slist_free_full(cached, g_free);
+
+	return fresh;
+}
+
+void
+gv_station_cancel_playlist_download(GvStation *self)
+{
+	GvStationPrivate *priv = self->priv;
+	GvPlaylist *playlist = priv->playlist;
+
+	if (playlist == NULL)
+		return;
+
+	/* The downloaded signal might be emitted right away, otherwise we
+	 * take care of it, and stop listening to the playlist.
+	 */
+	gv_playlist_cancel(playlist);
+	if (priv->playlist == NULL)
+		return;
+
+	g_signal_emit(self, signals[SIGNAL_PLAYLIST_DOWNLOADED], 0, playlist);
+	g_signal_handlers_disconnect_by_data(playlist, self);
+	g_clear_object(&priv->playlist);
+}
+
 gchar *
 gv_station_make_name(GvStation *self, gboolean escape)
 {
@@ -437,8 +649,15 @@ gv_station_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Free any allocated resources */
+	if (priv->playlist) {
+		g_signal_handlers_disconnect_by_data(priv->playlist, object);
+		gv_playlist_cancel(priv->playlist);
+		g_object_unref(priv->playlist);
+	}
+
 	if (priv->stream_uris)
 		g_slist_free_full(priv->stream_uris, g_free);
+	g_free(priv->preferred_stream_uri);
 
 	g_free(priv->uid);
 	g_free(priv->name);
@@ -458,7 +677,8 @@ gv_station_constructed(GObject *object)
 	TRACE("%p", object);
 
 	/* Initialize properties */
-	priv->uid = g_strdup_printf("%p", self);
+	if (priv->uid == NULL)
+		priv->uid = make_uid(priv->uri);
 	priv->insecure = DEFAULT_INSECURE;
 
 	/* Chain up */
@@ -491,7 +711,7 @@ gv_station_class_init(GvStationClass *class)
 
 	properties[PROP_UID] =
 		g_param_spec_string("uid", "UID", NULL, NULL,
-				    GV_PARAM_READABLE);
+				    GV_PARAM_READWRITE | G_PARAM_CONSTRUCT);
 
 	properties[PROP_NAME] =
 		g_param_spec_string("name", "Name", NULL, NULL,
@@ -520,5 +740,5 @@ gv_station_class_init(GvStationClass *class)
 	signals[SIGNAL_PLAYLIST_DOWNLOADED] =
 		g_signal_new("playlist-downloaded", G_TYPE_FROM_CLASS(class),
 			     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
-			     G_TYPE_NONE, 0);
+			     G_TYPE_NONE, 1, GV_TYPE_PLAYLIST);
 }
@@ -30,21 +30,27 @@ G_DECLARE_FINAL_TYPE(GvStation, gv_station, GV, STATION, GInitiallyUnowned)
 
 /* Methods */
 
-GvStation *gv_station_new              (const gchar *name, const gchar *uri);
-gchar     *gv_station_make_name        (GvStation *self, gboolean escape);
-gboolean   gv_station_download_playlist(GvStation *self);
+GvStation *gv_station_new                     (const gchar *name, const gchar *uri);
+gchar     *gv_station_make_name               (GvStation *self, gboolean escape);
+gboolean   gv_station_download_playlist       (GvStation *self);
+void       gv_station_cancel_playlist_download(GvStation *self);
+gboolean   gv_station_load_cached_streams     (GvStation *self);
 
 /* Property accessors */
 
-const gchar *gv_station_get_uid             (GvStation *self);
-const gchar *gv_station_get_name            (GvStation *self);
-void         gv_station_set_name            (GvStation *self, const gchar *name);
-const gchar *gv_station_get_uri             (GvStation *self);
-void         gv_station_set_uri             (GvStation *self, const gchar *uri);
-const gchar *gv_station_get_name_or_uri     (GvStation *self);
-GSList      *gv_station_get_stream_uris     (GvStation *self);
-const gchar *gv_station_get_first_stream_uri(GvStation *self);
-gboolean     gv_station_get_insecure        (GvStation *self);
-void         gv_station_set_insecure        (GvStation *self, gboolean insecure);
-const gchar *gv_station_get_user_agent      (GvStation *self);
-void         gv_station_set_user_agent      (GvStation *self, const gchar *user_agent);
+const gchar *gv_station_get_uid                 (GvStation *self);
+void         gv_station_set_uid                 (GvStation *self, const gchar *uid);
+const gchar *gv_station_get_name                (GvStation *self);
+void         gv_station_set_name                (GvStation *self, const gchar *name);
+const gchar *gv_station_get_uri                 (GvStation *self);
+void         gv_station_set_uri                 (GvStation *self, const gchar *uri);
+const gchar *gv_station_get_name_or_uri         (GvStation *self);
+gboolean     gv_station_is_downloading_playlist (GvStation *self);
+GSList      *gv_station_get_stream_uris         (GvStation *self);
+const gchar *gv_station_get_first_stream_uri    (GvStation *self);
+const gchar *gv_station_get_preferred_stream_uri(GvStation *self);
+void         gv_station_set_preferred_stream_uri(GvStation *self, const gchar *uri);
+gboolean     gv_station_get_insecure            (GvStation *self);
+void         gv_station_set_insecure            (GvStation *self, gboolean insecure);
+const gchar *gv_station_get_user_agent          (GvStation *self);
+void         gv_station_set_user_agent          (GvStation *self, const gchar *user_agent);
@@ -0,0 +1,317 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Timeshift buffer.
+ *
+ * The stream is kept in memory as it's received, so that it can be played
+ * later than it's received: playback can be paused while the stream is
+ * still being received, then resumed, or moved back, within the window
+ * of time that is kept. The window is bounded both in time and in size,
+ * the oldest data is dropped first.
+ *
+ * The data is kept as received, before it's decoded. Radio streams often
+ * interleave ICY metadata with the audio data, every so many bytes. It's
+ * taken out, as the data might be played back from any point.
+ *
+ * Data is pushed and read from different threads, hence the lock.
+ */
+
+#include <glib.h>
+
+#include "core/gv-timeshift.h"
+
+typedef struct {
+	GBytes *bytes;
+	gint64 time;
+} GvChunk;
+
+struct _GvTimeshift {
+	GMutex lock;
+	/* Bounds, in milliseconds and bytes */
+	guint duration;
+	gsize max_size;
+	/* Chunks of data, oldest first */
+	GQueue chunks;
+	gsize size;
+	/* Next chunk to read, NULL when reading caught up */
+	GList *read_link;
+	gint64 read_time;
+	/* ICY metadata being taken out */
+	guint icy_interval;
+	guint icy_remaining;
+	guint icy_meta_size;
+	GString *icy_meta;
+};
+
+static void
+gv_chunk_free(GvChunk *chunk)
+{
+	g_bytes_unref(chunk->bytes);
+	g_free(chunk);
+}
+
+/*
+ * Property accessors
+ */
+
+/* Time of the oldest data, or -1 if there's none */
+gint64
+gv_timeshift_get_start(GvTimeshift *self)
+{
+	GvChunk *chunk;
+	gint64 time;
+
+	g_mutex_lock(&self->lock);
+	chunk = g_queue_peek_head(&self->chunks);
+	time = chunk ? chunk->time : -1;
+	g_mutex_unlock(&self->lock);
+
+	return time;
+}
+
+/* Time of the latest data, or -1 if there's none */
+gint64
+gv_timeshift_get_end(GvTimeshift *self)
+{
+	GvChunk *chunk;
+	gint64 time;
+
+	g_mutex_lock(&self->lock);
+	chunk = g_queue_peek_tail(&self->chunks);
+	time = chunk ? chunk->time : -1;
+	g_mutex_unlock(&self->lock);
+
+	return time;
+}
+
+/* Time of the next data to read */
+gint64
+gv_timeshift_get_position(GvTimeshift *self)
+{
+	gint64 time;
+
+	g_mutex_lock(&self->lock);
+	if (self->read_link) {
+		GvChunk *chunk = self->read_link->data;
+		time = chunk->time;
+	} else {
+		time = self->read_time;
+	}
+	g_mutex_unlock(&self->lock);
+
+	return time;
+}
+
+gsize
+gv_timeshift_get_size(GvTimeshift *self)
+{
+	gsize size;
+
+	g_mutex_lock(&self->lock);
+	size = self->size;
+	g_mutex_unlock(&self->lock);
+
+	return size;
+}
+
+/*
+ * Public methods
+ */
+
+/* Take the ICY metadata out of the audio data, every interval bytes.
+ * Must be set whenever the stream is connected, 0 if there's no metadata.
+ */
+void
+gv_timeshift_set_icy_interval(GvTimeshift *self, guint interval)
+{
+	g_mutex_lock(&self->lock);
+	self->icy_interval = interval;
+	self->icy_remaining = interval;
+	self->icy_meta_size = 0;
+	g_string_truncate(self->icy_meta, 0);
+	g_mutex_unlock(&self->lock);
+}
+
+/* Append data that was received at the given time, in milliseconds.
+ * Return the ICY metadata found in there, if any.
+ */
+gchar *
+gv_timeshift_push(GvTimeshift *self, const guint8 *data, gsize size, gint64 time)
+{
+	GByteArray *audio;
+	gchar *icy_meta = NULL;
+	GvChunk *chunk;
+
+	audio = g_byte_array_sized_new(size);
+
+	g_mutex_lock(&self->lock);
+
+	while (size > 0) {
+		gsize n;
+
+		if (self->icy_interval == 0) {
+			/* No metadata */
+			n = size;
+			g_byte_array_append(audio, data, n);
+		} else if (self->icy_meta_size > 0) {
+			/* Metadata */
+			n = MIN(size, self->icy_meta_size);
+			g_string_append_len(self->icy_meta, (const gchar *) data, n);
+			self->icy_meta_size -= n;
+			if (self->icy_meta_size == 0) {
+				g_free(icy_meta);
+				icy_meta = g_strdup(self->icy_meta->str);
+				g_string_truncate(self->icy_meta, 0);
+				self->icy_remaining = self->icy_interval;
+			}
+		} else if (self->icy_remaining == 0) {
+			/* Length of the metadata, in blocks of 16 bytes */
+			n = 1;
+			self->icy_meta_size = data[0] * 16;
+			if (self->icy_meta_size == 0)
+				self->icy_remaining = self->icy_interval;
+		} else {
+			/* Audio */
+			n = MIN(size, self->icy_remaining);
+			g_byte_array_append(audio, data, n);
+			self->icy_remaining -= n;
+		}
+
+		data += n;
+		size -= n;
+	}
+
+	if (audio->len == 0) {
+		g_byte_array_unref(audio);
+		goto end;
+	}
+
+	chunk = g_new0(GvChunk, 1);
+	chunk->bytes = g_byte_array_free_to_bytes(audio);
+	chunk->time = time;
+	g_queue_push_tail(&self->chunks, chunk);
+	self->size += g_bytes_get_size(chunk->bytes);
+
+	if (self->read_link == NULL)
+		self->read_link = self->chunks.tail;
+
+	/* Drop the oldest data, and whoever was about to read it skips it */
+	while (self->chunks.length > 1) {
+		GvChunk *head = g_queue_peek_head(&self->chunks);
+
+		if (self->size <= self->max_size && time - head->time <= self->duration)
+			break;
+
+		if (self->read_link == self->chunks.head)
+			self->read_link = self->read_link->next;
+
+		self->size -= g_bytes_get_size(head->bytes);
+		gv_chunk_free(g_queue_pop_head(&self->chunks));
+	}
+
+end:
+	g_mutex_unlock(&self->lock);
+
+	return icy_meta;
+}
+
+/* Return the next chunk of data, as long as there's still min_ahead
+ * milliseconds of data after it, or NULL.
+ */
+GBytes *
+gv_timeshift_read(GvTimeshift *self, guint min_ahead)
+{
+	GvChunk *chunk, *last;
+	GBytes *bytes = NULL;
+
+	g_mutex_lock(&self->lock);
+
+	if (self->read_link == NULL)
+		goto end;
+
+	chunk = self->read_link->data;
+	last = g_queue_peek_tail(&self->chunks);
+	if (last->time - chunk->time < min_ahead)
+		goto end;
+
+	bytes = g_bytes_ref(chunk->bytes);
+	self->read_link = self->read_link->next;
+	self->read_time = chunk->time;
+
+end:
+	g_mutex_unlock(&self->lock);
+
+	return bytes;
+}
+
+/* Read from the first data received at the given time or later, within
+ * the window. Return the time it was received, or -1 if there's no data.
+ */
+gint64
+gv_timeshift_seek(GvTimeshift *self, gint64 time)
+{
+	GList *link;
+	gint64 result = -1;
+
+	g_mutex_lock(&self->lock);
+
+	for (link = self->chunks.head; link; link = link->next) {
+		GvChunk *chunk = link->data;
+
+		result = chunk->time;
+		if (chunk->time >= time || link->next == NULL)
+			break;
+	}
+
+	if (link) {
+		self->read_link = link;
+		self->read_time = result;
+	}
+
+	g_mutex_unlock(&self->lock);
+
+	return result;
+}
+
+void
+gv_timeshift_free(GvTimeshift *self)
+{
+	g_list_free_full(self->chunks.head, (GDestroyNotify) gv_chunk_free);
+	g_string_free(self->icy_meta, TRUE);
+	g_mutex_clear(&self->lock);
+	g_free(self);
+}
+
+/* Keep duration milliseconds of data, up to max_size bytes */
+GvTimeshift *
+gv_timeshift_new(guint duration, gsize max_size)
+{
+	GvTimeshift *self;
+
+	self = g_new0(GvTimeshift, 1);
+	g_mutex_init(&self->lock);
+	g_queue_init(&self->chunks);
+	self->duration = duration;
+	self->max_size = max_size;
+	self->icy_meta = g_string_new(NULL);
+
+	return self;
+}
@@ -0,0 +1,42 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _GvTimeshift GvTimeshift;
+
+/* Methods */
+
+GvTimeshift *gv_timeshift_new             (guint duration, gsize max_size);
+void         gv_timeshift_free            (GvTimeshift *self);
+void         gv_timeshift_set_icy_interval(GvTimeshift *self, guint interval);
+gchar       *gv_timeshift_push            (GvTimeshift *self, const guint8 *data,
+                                           gsize size, gint64 time);
+GBytes      *gv_timeshift_read            (GvTimeshift *self, guint min_ahead);
+gint64       gv_timeshift_seek            (GvTimeshift *self, gint64 time);
+
+/* Property accessors */
+
+gint64       gv_timeshift_get_start   (GvTimeshift *self);
+gint64       gv_timeshift_get_end     (GvTimeshift *self);
+gint64       gv_timeshift_get_position(GvTimeshift *self);
+gsize        gv_timeshift_get_size    (GvTimeshift *self);
@@ -0,0 +1,201 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Switch back and forth between two stations served by a local server,
+ * and report how long it takes to get the first audio out, ie. how long
+ * it takes for the engine to reach the playing state. Stations are
+ * switched either with the engine stopped in between, which tears the
+ * pipeline down to the NULL state (as it used to be done), either by
+ * playing the next station right away, which only goes down to READY.
+ */
+
+#include <glib.h>
+#include <gst/gst.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+#include "base/log.h"
+#include "core/gv-engine.h"
+#include "core/gv-station.h"
+
+#define N_SWITCHES  20
+#define SAMPLE_RATE 44100
+#define N_CHANNELS  2
+#define N_SECONDS   5
+#define TIMEOUT     10
+
+static gchar *wav;
+static gsize wav_size;
+
+static void
+put_le32(guint8 *ptr, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	memcpy(ptr, &value, 4);
+}
+
+static void
+put_le16(guint8 *ptr, guint16 value)
+{
+	value = GUINT16_TO_LE(value);
+	memcpy(ptr, &value, 2);
+}
+
+/* A wave file full of silence */
+static void
+make_wav(void)
+{
+	guint32 data_size = SAMPLE_RATE * N_CHANNELS * 2 * N_SECONDS;
+	guint8 *ptr;
+
+	wav_size = 44 + data_size;
+	wav = g_malloc0(wav_size);
+	ptr = (guint8 *) wav;
+
+	memcpy(ptr, "RIFF", 4);
+	put_le32(ptr + 4, wav_size - 8);
+	memcpy(ptr + 8, "WAVEfmt ", 8);
+	put_le32(ptr + 16, 16);
+	put_le16(ptr + 20, 1);
+	put_le16(ptr + 22, N_CHANNELS);
+	put_le32(ptr + 24, SAMPLE_RATE);
+	put_le32(ptr + 28, SAMPLE_RATE * N_CHANNELS * 2);
+	put_le16(ptr + 32, N_CHANNELS * 2);
+	put_le16(ptr + 34, 16);
+	memcpy(ptr + 36, "data", 4);
+	put_le32(ptr + 40, data_size);
+}
+
+static void
+server_callback(SoupServer *server G_GNUC_UNUSED,
+		SoupMessage *msg,
+		const gchar *path G_GNUC_UNUSED,
+		GHashTable *query G_GNUC_UNUSED,
+		SoupClientContext *client G_GNUC_UNUSED,
+		gpointer user_data G_GNUC_UNUSED)
+{
+	soup_message_set_status(msg, SOUP_STATUS_OK);
+	soup_message_set_response(msg, "audio/x-wav", SOUP_MEMORY_STATIC,
+				  wav, wav_size);
+}
+
+static void
+on_engine_notify_playback_state(GvEngine *engine,
+				GParamSpec *pspec G_GNUC_UNUSED,
+				GMainLoop *loop)
+{
+	if (gv_engine_get_state(engine) == GV_ENGINE_STATE_PLAYING)
+		g_main_loop_quit(loop);
+}
+
+static gboolean
+when_timeout_expired(gpointer user_data G_GNUC_UNUSED)
+{
+	g_error("Timeout while waiting for playback");
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+bench_switches(const gchar *label, GvEngine *engine, GvStation **stations,
+	       gboolean stop, GMainLoop *loop)
+{
+	GTimer *timer;
+	gdouble elapsed = 0;
+	guint i;
+
+	timer = g_timer_new();
+
+	for (i = 0; i < N_SWITCHES; i++) {
+		guint timeout_id;
+
+		g_timer_start(timer);
+		if (stop)
+			gv_engine_stop(engine);
+		gv_engine_play(engine, stations[i % 2]);
+
+		timeout_id = g_timeout_add_seconds(TIMEOUT, when_timeout_expired, NULL);
+		g_main_loop_run(loop);
+		g_source_remove(timeout_id);
+
+		elapsed += g_timer_elapsed(timer, NULL);
+	}
+
+	gv_engine_stop(engine);
+
+	g_print("%-12s %u switches, %8.3f ms to first audio\n",
+		label, N_SWITCHES, elapsed * 1000 / N_SWITCHES);
+
+	g_timer_destroy(timer);
+}
+
+int
+main(int argc, char *argv[])
+{
+	SoupServer *server;
+	GvEngine *engine;
+	GvStation *stations[2];
+	GMainLoop *loop;
+	GSList *uris;
+	gchar *base_uri;
+	gchar *uri;
+	GError *err = NULL;
+
+	log_init(NULL, TRUE, NULL);
+	gst_init(&argc, &argv);
+
+	make_wav();
+
+	server = soup_server_new(NULL, NULL);
+	soup_server_add_handler(server, NULL, server_callback, NULL, NULL);
+	if (!soup_server_listen_local(server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &err))
+		g_error("Failed to start server: %s", err->message);
+
+	uris = soup_server_get_uris(server);
+	g_assert_nonnull(uris);
+	base_uri = soup_uri_to_string(uris->data, FALSE);
+	g_slist_free_full(uris, (GDestroyNotify) soup_uri_free);
+
+	uri = g_strdup_printf("%sone.wav", base_uri);
+	stations[0] = g_object_ref_sink(gv_station_new(NULL, uri));
+	g_free(uri);
+	uri = g_strdup_printf("%stwo.wav", base_uri);
+	stations[1] = g_object_ref_sink(gv_station_new(NULL, uri));
+	g_free(uri);
+
+	loop = g_main_loop_new(NULL, FALSE);
+	engine = gv_engine_new();
+	g_signal_connect(engine, "notify::playback-state",
+			 G_CALLBACK(on_engine_notify_playback_state), loop);
+
+	bench_switches("stop & play", engine, stations, TRUE, loop);
+	bench_switches("play", engine, stations, FALSE, loop);
+
+	g_object_unref(engine);
+	g_main_loop_unref(loop);
+	g_object_unref(stations[0]);
+	g_object_unref(stations[1]);
+	g_free(base_uri);
+	g_object_unref(server);
+	g_free(wav);
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Detect and parse large playlists of each format, and report how long
+ * it takes per playlist and per entry.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "base/log.h"
+#include "core/gv-playlist.h"
+
+#define N_ENTRIES    1000
+#define N_ITERATIONS 200
+
+static gchar *
+make_playlist(GvPlaylistFormat format)
+{
+	GString *string;
+	guint i;
+
+	string = g_string_new(NULL);
+
+	switch (format) {
+	case GV_PLAYLIST_FORMAT_M3U:
+		g_string_append(string, "#EXTM3U\n");
+		for (i = 1; i <= N_ENTRIES; i++)
+			g_string_append_printf(string,
+					       "#EXTINF:-1,Radio %u\n"
+					       "http://stream%u.example.com/radio.mp3\n",
+					       i, i);
+		break;
+	case GV_PLAYLIST_FORMAT_PLS:
+		g_string_append(string, "[playlist]\n");
+		for (i = 1; i <= N_ENTRIES; i++)
+			g_string_append_printf(string,
+					       "File%u=http://stream%u.example.com/radio.mp3\n"
+					       "Title%u=Radio %u\n"
+					       "Length%u=-1\n",
+					       i, i, i, i, i);
+		g_string_append_printf(string, "NumberOfEntries=%u\nVersion=2\n", N_ENTRIES);
+		break;
+	case GV_PLAYLIST_FORMAT_ASX:
+		g_string_append(string, "<asx version=\"3.0\">\n");
+		for (i = 1; i <= N_ENTRIES; i++)
+			g_string_append_printf(string,
+					       "  <entry><title>Radio %u</title>"
+					       "<ref href=\"http://stream%u.example.com/radio.wma\"/></entry>\n",
+					       i, i);
+		g_string_append(string, "</asx>\n");
+		break;
+	case GV_PLAYLIST_FORMAT_XSPF:
+		g_string_append(string,
+				"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				"<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+				"<trackList>\n");
+		for (i = 1; i <= N_ENTRIES; i++)
+			g_string_append_printf(string,
+					       "  <track><title>Radio %u</title>"
+					       "<location>http://stream%u.example.com/radio.ogg</location></track>\n",
+					       i, i);
+		g_string_append(string, "</trackList>\n</playlist>\n");
+		break;
+	default:
+		g_assert_not_reached();
+	}
+
+	return g_string_free(string, FALSE);
+}
+
+static void
+bench_format(const gchar *label, GvPlaylistFormat format)
+{
+	GTimer *timer;
+	gchar *text;
+	gsize length;
+	gdouble elapsed;
+	guint i;
+
+	text = make_playlist(format);
+	length = strlen(text);
+	timer = g_timer_new();
+
+	for (i = 0; i < N_ITERATIONS; i++) {
+		GvPlaylistFormat detected;
+		GSList *streams;
+
+		detected = gv_playlist_detect_format(NULL, text, length);
+		g_assert(detected == format);
+		streams = gv_playlist_parse(detected, text, length);
+		g_assert(g_slist_length(streams) == N_ENTRIES);
+		g_slist_free_full(streams, g_free);
+	}
+
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_print("%-5s %7zu bytes, %8.3f ms/playlist, %6.3f us/entry\n",
+		label, length, elapsed * 1000 / N_ITERATIONS,
+		elapsed * 1000000 / N_ITERATIONS / N_ENTRIES);
+
+	g_timer_destroy(timer);
+	g_free(text);
+}
+
+int
+main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
+{
+	log_init(NULL, TRUE, NULL);
+
+	bench_format("m3u", GV_PLAYLIST_FORMAT_M3U);
+	bench_format("pls", GV_PLAYLIST_FORMAT_PLS);
+	bench_format("asx", GV_PLAYLIST_FORMAT_ASX);
+	bench_format("xspf", GV_PLAYLIST_FORMAT_XSPF);
+
+	return 0;
+}
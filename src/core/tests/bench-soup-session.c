@@ -0,0 +1,171 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Download a playlist many times from a local server, either with a new
+ * soup session for each download (as it used to be done), either with
+ * the session shared by core objects. For each case, we count how many
+ * connections were created, ie. how many TCP (and TLS) handshakes were
+ * needed.
+ */
+
+#include <glib.h>
+#include <libsoup/soup.h>
+#include <string.h>
+
+#include "base/log.h"
+#include "core/gv-core-internal.h"
+
+#define N_REQUESTS 100
+#define USER_AGENT "Goodvibes/bench"
+
+static const gchar *playlist = "http://stream.example.com/radio.mp3\n";
+
+static guint n_connections;
+
+static void
+server_callback(SoupServer *server G_GNUC_UNUSED,
+		SoupMessage *msg,
+		const gchar *path G_GNUC_UNUSED,
+		GHashTable *query G_GNUC_UNUSED,
+		SoupClientContext *client G_GNUC_UNUSED,
+		gpointer user_data G_GNUC_UNUSED)
+{
+	soup_message_set_status(msg, SOUP_STATUS_OK);
+	soup_message_set_response(msg, "audio/x-mpegurl", SOUP_MEMORY_STATIC,
+				  playlist, strlen(playlist));
+}
+
+static void
+on_connection_created(SoupSession *session G_GNUC_UNUSED,
+		      GObject *connection G_GNUC_UNUSED,
+		      gpointer user_data G_GNUC_UNUSED)
+{
+	n_connections++;
+}
+
+static void
+on_message_completed(SoupSession *session G_GNUC_UNUSED,
+		     SoupMessage *msg,
+		     GMainLoop *loop)
+{
+	if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code))
+		g_error("Request failed (%u): %s", msg->status_code, msg->reason_phrase);
+
+	g_main_loop_quit(loop);
+}
+
+static void
+fetch(SoupSession *session, const gchar *uri, GMainLoop *loop)
+{
+	SoupMessage *msg;
+
+	msg = soup_message_new("GET", uri);
+	soup_session_queue_message(session, msg,
+				   (SoupSessionCallback) on_message_completed,
+				   loop);
+	g_main_loop_run(loop);
+}
+
+static void
+report(const gchar *label, GTimer *timer)
+{
+	g_print("%-16s %u requests, %3u connections, %.3f ms/request\n",
+		label, N_REQUESTS, n_connections,
+		g_timer_elapsed(timer, NULL) * 1000 / N_REQUESTS);
+}
+
+static void
+bench_new_sessions(const gchar *uri, GMainLoop *loop)
+{
+	GTimer *timer;
+	guint i;
+
+	n_connections = 0;
+	timer = g_timer_new();
+
+	for (i = 0; i < N_REQUESTS; i++) {
+		SoupSession *session;
+
+		session = soup_session_new_with_options(SOUP_SESSION_USER_AGENT, USER_AGENT,
+							NULL);
+		g_signal_connect(session, "connection-created",
+				 G_CALLBACK(on_connection_created), NULL);
+		fetch(session, uri, loop);
+		g_object_unref(session);
+	}
+
+	report("new sessions", timer);
+	g_timer_destroy(timer);
+}
+
+static void
+bench_shared_session(const gchar *uri, GMainLoop *loop)
+{
+	SoupSession *session;
+	GTimer *timer;
+	guint i;
+
+	n_connections = 0;
+	timer = g_timer_new();
+
+	session = gv_core_get_soup_session(FALSE, USER_AGENT);
+	g_signal_connect(session, "connection-created",
+			 G_CALLBACK(on_connection_created), NULL);
+
+	for (i = 0; i < N_REQUESTS; i++)
+		fetch(gv_core_get_soup_session(FALSE, USER_AGENT), uri, loop);
+
+	report("shared session", timer);
+	g_timer_destroy(timer);
+}
+
+int
+main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GMainLoop *loop;
+	GSList *uris;
+	gchar *uri;
+	GError *err = NULL;
+
+	log_init(NULL, TRUE, NULL);
+
+	server = soup_server_new(NULL, NULL);
+	soup_server_add_handler(server, NULL, server_callback, NULL, NULL);
+	if (!soup_server_listen_local(server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &err))
+		g_error("Failed to start server: %s", err->message);
+
+	uris = soup_server_get_uris(server);
+	g_assert_nonnull(uris);
+	uri = soup_uri_to_string(uris->data, FALSE);
+	g_slist_free_full(uris, (GDestroyNotify) soup_uri_free);
+
+	loop = g_main_loop_new(NULL, FALSE);
+
+	bench_new_sessions(uri, loop);
+	bench_shared_session(uri, loop);
+
+	g_main_loop_unref(loop);
+	g_free(uri);
+	g_object_unref(server);
+
+	return 0;
+}
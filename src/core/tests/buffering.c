@@ -0,0 +1,153 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <mutest.h>
+
+#include "base/log.h"
+#include "base/utils.h"
+#include "core/gv-buffering.h"
+
+#define STATION_URI "http://stream.example.com/radio.mp3"
+
+static void
+buffering_defaults(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvBuffering *b;
+
+	b = gv_buffering_new("http://unknown.example.com/radio.mp3");
+	mutest_expect("unknown stations start once the buffer is full",
+		      mutest_int_value(gv_buffering_get_threshold(b)),
+		      mutest_to_be, 100,
+		      NULL);
+	mutest_expect("unknown stations get the default buffer duration",
+		      mutest_int_value(gv_buffering_get_duration(b)),
+		      mutest_to_be, 2000,
+		      NULL);
+	gv_buffering_free(b);
+}
+
+static void
+buffering_jitter(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvBuffering *b;
+	guint i;
+
+	b = gv_buffering_new(STATION_URI);
+
+	/* Samples are ignored until the session starts */
+	gv_buffering_sample(b, 1000);
+	gv_buffering_sample(b, 100000);
+	gv_buffering_start(b);
+	mutest_expect("no jitter without samples",
+		      mutest_bool_value(gv_buffering_get_jitter(b) == 0),
+		      mutest_to_be_true,
+		      NULL);
+
+	for (i = 0; i < 10; i++)
+		gv_buffering_sample(b, 16000);
+	mutest_expect("no jitter with a steady input rate",
+		      mutest_bool_value(gv_buffering_get_jitter(b) < 0.01),
+		      mutest_to_be_true,
+		      NULL);
+
+	for (i = 0; i < 10; i++)
+		gv_buffering_sample(b, i % 2 ? 4000 : 28000);
+	mutest_expect("jitter with an unsteady input rate",
+		      mutest_bool_value(gv_buffering_get_jitter(b) > 0.25),
+		      mutest_to_be_true,
+		      NULL);
+
+	gv_buffering_free(b);
+}
+
+static void
+buffering_underruns(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvBuffering *b;
+	gchar *cache_path;
+
+	b = gv_buffering_new(STATION_URI);
+	gv_buffering_start(b);
+	gv_buffering_underrun(b);
+	gv_buffering_underrun(b);
+	mutest_expect("underruns are counted",
+		      mutest_int_value(gv_buffering_get_underruns(b)),
+		      mutest_to_be, 2,
+		      NULL);
+	gv_buffering_finish(b);
+	mutest_expect("the buffer grows after underruns",
+		      mutest_int_value(gv_buffering_get_duration(b)),
+		      mutest_to_be, 3000,
+		      NULL);
+	gv_buffering_free(b);
+
+	cache_path = g_build_filename(gv_get_app_user_cache_dir(), "buffering.cache", NULL);
+	mutest_expect("learned values are saved",
+		      mutest_bool_value(g_file_test(cache_path, G_FILE_TEST_EXISTS)),
+		      mutest_to_be_true,
+		      NULL);
+	g_free(cache_path);
+
+	b = gv_buffering_new(STATION_URI);
+	mutest_expect("learned values are loaded",
+		      mutest_int_value(gv_buffering_get_duration(b)),
+		      mutest_to_be, 3000,
+		      NULL);
+
+	/* A short session without underruns doesn't change anything */
+	gv_buffering_start(b);
+	gv_buffering_finish(b);
+	mutest_expect("short sessions are not learned from",
+		      mutest_int_value(gv_buffering_get_threshold(b)),
+		      mutest_to_be, 100,
+		      NULL);
+	gv_buffering_free(b);
+}
+
+static void
+buffering_suite(mutest_suite_t *suite G_GNUC_UNUSED)
+{
+	gchar *tmpdir, *cache_path;
+
+	/* Learned values are cached, make sure we don't mess up
+	 * with the cache of the test environment.
+	 */
+	tmpdir = g_dir_make_tmp("gv-buffering-XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+	g_setenv("XDG_CACHE_HOME", tmpdir, TRUE);
+
+	mutest_it("use defaults for unknown stations", buffering_defaults);
+	mutest_it("measure the input jitter", buffering_jitter);
+	mutest_it("learn from underruns", buffering_underruns);
+
+	cache_path = g_build_filename(gv_get_app_user_cache_dir(), "buffering.cache", NULL);
+	g_unlink(cache_path);
+	g_rmdir(gv_get_app_user_cache_dir());
+	g_assert_true(g_rmdir(tmpdir) == 0);
+	g_free(cache_path);
+	g_free(tmpdir);
+}
+
+MUTEST_MAIN(
+	log_init(NULL, TRUE, NULL);
+	mutest_describe("gv-buffering", buffering_suite);
+)
@@ -0,0 +1,776 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include <mutest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "base/log.h"
+#include "base/utils.h"
+#include "core/gv-playlist.h"
+
+#define CORPUS_DIR TESTS_DIR "/playlist-corpus"
+
+/* Number of mutated inputs generated for each file of the corpus */
+#define N_MUTATIONS 500
+
+/* Size of the chunks sent by the test server */
+#define CHUNK_SIZE 7
+
+/* Number of streams in the huge playlist sent by the test server */
+#define N_HUGE_STREAMS 50000
+
+static const struct {
+	const gchar *filename;
+	GvPlaylistFormat format;
+	guint n_streams;
+	const gchar *first_stream;
+} corpus[] = {
+	{ "plain.m3u",         GV_PLAYLIST_FORMAT_M3U,     2, "http://stream1.example.com/radio.mp3" },
+	{ "extended-crlf.m3u", GV_PLAYLIST_FORMAT_M3U,     2, "http://stream1.example.com/radio.aac" },
+	{ "bom.m3u",           GV_PLAYLIST_FORMAT_M3U,     1, "http://stream1.example.com/radio.ogg" },
+	{ "empty.m3u",         GV_PLAYLIST_FORMAT_UNKNOWN, 0, NULL },
+	{ "simple.pls",        GV_PLAYLIST_FORMAT_PLS,     2, "http://stream1.example.com/radio.mp3" },
+	{ "unordered.pls",     GV_PLAYLIST_FORMAT_PLS,     2, "http://stream1.example.com/radio.mp3" },
+	{ "malformed.pls",     GV_PLAYLIST_FORMAT_PLS,     0, NULL },
+	{ "simple.asx",        GV_PLAYLIST_FORMAT_ASX,     2, "http://stream1.example.com/radio.wma" },
+	{ "uppercase.asx",     GV_PLAYLIST_FORMAT_ASX,     1, "http://stream1.example.com/radio.wma" },
+	{ "truncated.asx",     GV_PLAYLIST_FORMAT_ASX,     1, "http://a.example.com/x" },
+	{ "simple.xspf",       GV_PLAYLIST_FORMAT_XSPF,    2, "http://stream1.example.com/radio.ogg" },
+	{ "truncated.xspf",    GV_PLAYLIST_FORMAT_XSPF,    0, NULL },
+};
+
+static gchar *
+read_corpus_file(const gchar *filename, gsize *length)
+{
+	gchar *path, *contents = NULL;
+
+	path = g_build_filename(CORPUS_DIR, filename, NULL);
+	if (!g_file_get_contents(path, &contents, length, NULL))
+		g_error("Failed to read corpus file '%s'", path);
+	g_free(path);
+
+	return contents;
+}
+
+static void
+playlist_detect_format(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	const gchar *mp3 = "\xff\xfb\x90\x64\x00\x00\x00\x00";
+
+	mutest_expect("format is detected from the content type",
+		      mutest_int_value(gv_playlist_detect_format("audio/x-scpls", NULL, 0)),
+		      mutest_to_be, GV_PLAYLIST_FORMAT_PLS,
+		      NULL);
+	mutest_expect("content type is case insensitive",
+		      mutest_int_value(gv_playlist_detect_format("Audio/X-MpegURL", NULL, 0)),
+		      mutest_to_be, GV_PLAYLIST_FORMAT_M3U,
+		      NULL);
+	mutest_expect("content wins over the content type",
+		      mutest_int_value(gv_playlist_detect_format("text/plain", "[playlist]\n", 11)),
+		      mutest_to_be, GV_PLAYLIST_FORMAT_PLS,
+		      NULL);
+	mutest_expect("content type is used when content is not conclusive",
+		      mutest_int_value(gv_playlist_detect_format("application/xspf+xml", "<foo/>", 6)),
+		      mutest_to_be, GV_PLAYLIST_FORMAT_XSPF,
+		      NULL);
+	mutest_expect("an audio stream is not a playlist",
+		      mutest_int_value(gv_playlist_detect_format("audio/mpeg", mp3, 8)),
+		      mutest_to_be, GV_PLAYLIST_FORMAT_UNKNOWN,
+		      NULL);
+}
+
+static void
+playlist_parse_corpus(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(corpus); i++) {
+		GvPlaylistFormat format;
+		GSList *streams;
+		gchar *contents;
+		gboolean ok;
+		gsize length;
+
+		contents = read_corpus_file(corpus[i].filename, &length);
+		format = gv_playlist_detect_format(NULL, contents, length);
+		streams = gv_playlist_parse(format, contents, length);
+
+		ok = format == corpus[i].format &&
+		     g_slist_length(streams) == corpus[i].n_streams &&
+		     !g_strcmp0(streams ? streams->data : NULL, corpus[i].first_stream);
+		if (!ok)
+			g_printerr("Unexpected result for '%s'\n", corpus[i].filename);
+
+		mutest_expect("corpus file is detected and parsed as expected",
+			      mutest_bool_value(ok),
+			      mutest_to_be_true,
+			      NULL);
+
+		g_slist_free_full(streams, g_free);
+		g_free(contents);
+	}
+}
+
+/* Mutate the input with random truncations, bit flips, and insertions
+ * of characters that are meaningful to the parsers.
+ */
+static gchar *
+mutate(GRand *rand, const gchar *input, gsize length, gsize *mutated_length)
+{
+	const gchar specials[] = "<>/=[]#\"&\r\n:\xef\xbb\xbf";
+	GByteArray *array;
+	guint i, n_mutations;
+
+	array = g_byte_array_new();
+	g_byte_array_append(array, (const guint8 *) input, length);
+
+	n_mutations = g_rand_int_range(rand, 1, 8);
+	for (i = 0; i < n_mutations; i++) {
+		guint pos = array->len ? g_rand_int_range(rand, 0, array->len) : 0;
+
+		switch (g_rand_int_range(rand, 0, 3)) {
+		case 0:
+			g_byte_array_set_size(array, pos);
+			break;
+		case 1:
+			if (array->len)
+				array->data[pos] ^= 1 << g_rand_int_range(rand, 0, 8);
+			break;
+		default: {
+			guint8 c = specials[g_rand_int_range(rand, 0, sizeof specials - 1)];
+			g_byte_array_insert(array, pos, &c, 1);
+			break;
+		}
+		}
+	}
+
+	*mutated_length = array->len;
+	return (gchar *) g_byte_array_free(array, FALSE);
+}
+
+static void
+playlist_fuzz_corpus(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvPlaylistFormat formats[] = {
+		GV_PLAYLIST_FORMAT_M3U,
+		GV_PLAYLIST_FORMAT_PLS,
+		GV_PLAYLIST_FORMAT_ASX,
+		GV_PLAYLIST_FORMAT_XSPF,
+	};
+	guint n_inputs = 0;
+	gboolean ok = TRUE;
+	GRand *rand;
+	guint i, j, k;
+
+	/* Warnings are expected for malformed playlists */
+	log_init("error", TRUE, NULL);
+
+	rand = g_rand_new_with_seed(0);
+
+	for (i = 0; i < G_N_ELEMENTS(corpus); i++) {
+		gchar *contents;
+		gsize length;
+
+		contents = read_corpus_file(corpus[i].filename, &length);
+
+		for (j = 0; j < N_MUTATIONS; j++) {
+			gchar *input;
+			gsize input_length;
+
+			input = mutate(rand, contents, length, &input_length);
+			gv_playlist_detect_format(NULL, input, input_length);
+
+			for (k = 0; k < G_N_ELEMENTS(formats); k++) {
+				GSList *streams, *item;
+
+				streams = gv_playlist_parse(formats[k], input, input_length);
+				for (item = streams; item; item = item->next)
+					if (item->data == NULL)
+						ok = FALSE;
+				g_slist_free_full(streams, g_free);
+			}
+
+			g_free(input);
+			n_inputs++;
+		}
+
+		g_free(contents);
+	}
+
+	g_rand_free(rand);
+
+	log_init(NULL, TRUE, NULL);
+
+	mutest_expect("mutated inputs were parsed",
+		      mutest_int_value(n_inputs),
+		      mutest_to_be, G_N_ELEMENTS(corpus) * N_MUTATIONS,
+		      NULL);
+	mutest_expect("parsers never return null streams",
+		      mutest_bool_value(ok),
+		      mutest_to_be_true,
+		      NULL);
+}
+
+/* Playlists that point to other playlists. 'a.pls' points to 'b.m3u',
+ * which points back to 'a.pls'. The 'deep' playlists go on forever.
+ */
+static gchar *
+make_nested_playlist(SoupMessage *msg, const gchar *path, gsize *length)
+{
+	SoupURI *uri = soup_message_get_uri(msg);
+	gchar *base, *text;
+	guint n;
+
+	base = g_strdup_printf("http://%s:%u", uri->host, uri->port);
+
+	if (!g_strcmp0(path, "/nested/a.pls"))
+		text = g_strdup_printf("[playlist]\n"
+				       "File1=%s/nested/b.m3u\n"
+				       "File2=http://a.example.com/radio.mp3\n"
+				       "NumberOfEntries=2\n", base);
+	else if (!g_strcmp0(path, "/nested/b.m3u"))
+		text = g_strdup_printf("http://b.example.com/radio.mp3\n"
+				       "%s/nested/a.pls\n", base);
+	else if (sscanf(path, "/deep/%u.m3u", &n) == 1)
+		text = g_strdup_printf("http://deep%u.example.com/radio.mp3\n"
+				       "%s/deep/%u.m3u\n", n, base, n + 1);
+	else
+		text = NULL;
+
+	g_free(base);
+
+	*length = text ? strlen(text) : 0;
+	return text;
+}
+
+/* Serve the corpus files in small chunks, a huge playlist, nested
+ * playlists, a playlist that never comes, one that stops midway, one
+ * that's gone after the first download, and extension-less uris that
+ * are either a playlist or a stream.
+ */
+static void
+server_callback(SoupServer *server,
+		SoupMessage *msg,
+		const gchar *path,
+		GHashTable *query G_GNUC_UNUSED,
+		SoupClientContext *client G_GNUC_UNUSED,
+		gpointer user_data G_GNUC_UNUSED)
+{
+	gsize chunk_size = CHUNK_SIZE;
+	gsize length, offset;
+	gchar *contents;
+
+	if (!g_strcmp0(path, "/stall")) {
+		soup_server_pause_message(server, msg);
+		return;
+	}
+
+	if (!g_strcmp0(path, "/listen.php")) {
+		const gchar *text = "http://listen.example.com/radio.mp3\n";
+
+		soup_message_set_status(msg, SOUP_STATUS_OK);
+		soup_message_set_response(msg, "text/plain", SOUP_MEMORY_STATIC,
+					  text, strlen(text));
+		return;
+	}
+
+	if (!g_strcmp0(path, "/stream")) {
+		static const gchar mp3[] = { '\xff', '\xfb', '\x90', '\x64', 0, 0, 0, 0 };
+
+		/* A stream never ends, the client hangs up */
+		soup_message_set_status(msg, SOUP_STATUS_OK);
+		soup_message_headers_set_encoding(msg->response_headers, SOUP_ENCODING_CHUNKED);
+		soup_message_headers_set_content_type(msg->response_headers, "audio/mpeg", NULL);
+		soup_message_body_append(msg->response_body, SOUP_MEMORY_STATIC,
+					 mp3, sizeof mp3);
+		return;
+	}
+
+	if (!g_strcmp0(path, "/stall-midway")) {
+		const gchar *text = "http://partial.example.com/radio.mp3\n";
+
+		soup_message_set_status(msg, SOUP_STATUS_OK);
+		soup_message_headers_set_encoding(msg->response_headers, SOUP_ENCODING_CHUNKED);
+		soup_message_headers_replace(msg->response_headers, "ETag", "\"partial\"");
+		soup_message_body_append(msg->response_body, SOUP_MEMORY_STATIC,
+					 text, strlen(text));
+		return;
+	}
+
+	if (!g_strcmp0(path, "/flaky.m3u")) {
+		static guint n_requests;
+		const gchar *text = "http://flaky.example.com/radio.mp3\n";
+
+		if (n_requests++ > 0) {
+			soup_message_set_status(msg, SOUP_STATUS_SERVICE_UNAVAILABLE);
+			return;
+		}
+
+		soup_message_set_status(msg, SOUP_STATUS_OK);
+		soup_message_set_response(msg, "audio/x-mpegurl", SOUP_MEMORY_STATIC,
+					  text, strlen(text));
+		return;
+	}
+
+	if (!g_strcmp0(path, "/huge")) {
+		GString *string;
+		guint i;
+
+		string = g_string_new(NULL);
+		for (i = 0; i < N_HUGE_STREAMS; i++)
+			g_string_append_printf(string, "http://stream%u.example.com/radio.mp3\n", i);
+		length = string->len;
+		contents = g_string_free(string, FALSE);
+		chunk_size = 4096;
+	} else if (g_str_has_prefix(path, "/nested/") || g_str_has_prefix(path, "/deep/")) {
+		contents = make_nested_playlist(msg, path, &length);
+		if (contents == NULL) {
+			soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+			return;
+		}
+	} else {
+		contents = read_corpus_file(path + 1, &length);
+	}
+
+	soup_message_set_status(msg, SOUP_STATUS_OK);
+	soup_message_headers_set_encoding(msg->response_headers, SOUP_ENCODING_CHUNKED);
+	for (offset = 0; offset < length; offset += chunk_size)
+		soup_message_body_append(msg->response_body, SOUP_MEMORY_COPY,
+					 contents + offset, MIN(chunk_size, length - offset));
+	soup_message_body_complete(msg->response_body);
+
+	g_free(contents);
+}
+
+static void
+on_first_stream_found(GvPlaylist *playlist G_GNUC_UNUSED,
+		      const gchar *uri,
+		      gchar **first_stream)
+{
+	g_assert_null(*first_stream);
+	*first_stream = g_strdup(uri);
+}
+
+static void
+on_downloaded(GvPlaylist *playlist G_GNUC_UNUSED,
+	      GMainLoop *loop)
+{
+	g_main_loop_quit(loop);
+}
+
+static GSList *
+download(const gchar *base_uri, const gchar *path, gchar **first_stream)
+{
+	GvPlaylist *playlist;
+	GMainLoop *loop;
+	GSList *streams;
+	gchar *uri;
+
+	uri = g_strconcat(base_uri, path, NULL);
+	loop = g_main_loop_new(NULL, FALSE);
+	playlist = gv_playlist_new(uri);
+	g_signal_connect(playlist, "first-stream-found",
+			 G_CALLBACK(on_first_stream_found), first_stream);
+	g_signal_connect(playlist, "downloaded", G_CALLBACK(on_downloaded), loop);
+
+	gv_playlist_download(playlist, FALSE, "Goodvibes/test");
+	g_main_loop_run(loop);
+
+	streams = g_slist_copy_deep(gv_playlist_get_stream_list(playlist),
+				    (GCopyFunc) g_strdup, NULL);
+
+	g_object_unref(playlist);
+	g_main_loop_unref(loop);
+	g_free(uri);
+
+	return streams;
+}
+
+static SoupServer *
+start_server(gchar **base_uri)
+{
+	SoupServer *server;
+	GSList *uris;
+	GError *err = NULL;
+
+	server = soup_server_new(NULL, NULL);
+	soup_server_add_handler(server, NULL, server_callback, NULL, NULL);
+	if (!soup_server_listen_local(server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &err))
+		g_error("Failed to start server: %s", err->message);
+
+	uris = soup_server_get_uris(server);
+	*base_uri = soup_uri_to_string(uris->data, FALSE);
+	g_slist_free_full(uris, (GDestroyNotify) soup_uri_free);
+
+	/* Remove the trailing slash */
+	(*base_uri)[strlen(*base_uri) - 1] = '\0';
+
+	return server;
+}
+
+static void
+playlist_download_chunks(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GSList *streams;
+	gchar *base_uri, *first_stream;
+	guint i;
+
+	server = start_server(&base_uri);
+
+	/* Parsing chunks must give the same result as parsing the whole */
+	for (i = 0; i < G_N_ELEMENTS(corpus); i++) {
+		gchar *path;
+		gboolean ok;
+
+		if (corpus[i].n_streams == 0)
+			continue;
+
+		first_stream = NULL;
+		path = g_strconcat("/", corpus[i].filename, NULL);
+		streams = download(base_uri, path, &first_stream);
+
+		ok = g_slist_length(streams) == corpus[i].n_streams &&
+		     !g_strcmp0(streams ? streams->data : NULL, corpus[i].first_stream) &&
+		     first_stream != NULL;
+		if (!ok)
+			g_printerr("Unexpected result for '%s'\n", corpus[i].filename);
+
+		mutest_expect("playlist downloaded in chunks is parsed as expected",
+			      mutest_bool_value(ok),
+			      mutest_to_be_true,
+			      NULL);
+
+		g_slist_free_full(streams, g_free);
+		g_free(first_stream);
+		g_free(path);
+	}
+
+	/* A huge playlist is truncated */
+	log_init("error", TRUE, NULL);
+	first_stream = NULL;
+	streams = download(base_uri, "/huge", &first_stream);
+	log_init(NULL, TRUE, NULL);
+
+	mutest_expect("first stream of a huge playlist is found",
+		      mutest_string_value(first_stream),
+		      mutest_to_be, "http://stream0.example.com/radio.mp3",
+		      NULL);
+	mutest_expect("huge playlist is truncated",
+		      mutest_bool_value(streams != NULL &&
+					g_slist_length(streams) < N_HUGE_STREAMS),
+		      mutest_to_be_true,
+		      NULL);
+
+	g_slist_free_full(streams, g_free);
+	g_free(first_stream);
+	g_free(base_uri);
+	g_object_unref(server);
+}
+
+static gboolean
+has_playlist_uri(GSList *streams)
+{
+	GSList *item;
+
+	for (item = streams; item; item = item->next)
+		if (gv_playlist_get_format(item->data) != GV_PLAYLIST_FORMAT_UNKNOWN)
+			return TRUE;
+
+	return FALSE;
+}
+
+static void
+playlist_download_nested(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GSList *streams, *cached;
+	gchar *base_uri, *uri, *first_stream;
+	guint n_streams;
+
+	server = start_server(&base_uri);
+
+	/* Nested playlists are resolved, and loops are broken */
+	first_stream = NULL;
+	streams = download(base_uri, "/nested/a.pls", &first_stream);
+
+	mutest_expect("nested playlists are resolved to streams",
+		      mutest_int_value(g_slist_length(streams)),
+		      mutest_to_be, 2,
+		      NULL);
+	mutest_expect("streams of nested playlists come in order",
+		      mutest_string_value(streams ? streams->data : NULL),
+		      mutest_to_be, "http://b.example.com/radio.mp3",
+		      NULL);
+	mutest_expect("nested playlists are not given as first stream",
+		      mutest_pointer(first_stream),
+		      mutest_to_be_null,
+		      NULL);
+
+	/* Each hop is cached, the cache lookup resolves them as well */
+	uri = g_strconcat(base_uri, "/nested/a.pls", NULL);
+	cached = gv_playlist_cache_lookup(uri, NULL);
+	mutest_expect("nested playlists are resolved from the cache",
+		      mutest_bool_value(g_slist_length(cached) == 2 && !has_playlist_uri(cached)),
+		      mutest_to_be_true,
+		      NULL);
+	g_slist_free_full(cached, g_free);
+	g_slist_free_full(streams, g_free);
+	g_free(uri);
+
+	/* Playlists nested forever are resolved up to a limit */
+	first_stream = NULL;
+	log_init("error", TRUE, NULL);
+	streams = download(base_uri, "/deep/0.m3u", &first_stream);
+	log_init(NULL, TRUE, NULL);
+
+	n_streams = g_slist_length(streams);
+	mutest_expect("deeply nested playlists are resolved up to a limit",
+		      mutest_bool_value(n_streams > 1 && n_streams < 10),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("unresolved playlists are dropped",
+		      mutest_bool_value(has_playlist_uri(streams)),
+		      mutest_to_be_false,
+		      NULL);
+
+	g_slist_free_full(streams, g_free);
+	g_free(first_stream);
+	g_free(base_uri);
+	g_object_unref(server);
+}
+
+static void
+playlist_download_probe(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GSList *streams, *cached;
+	gchar *base_uri, *uri, *first_stream;
+	gboolean fresh;
+
+	mutest_expect("uri with a playlist extension might be a playlist",
+		      mutest_bool_value(gv_playlist_maybe_playlist("http://a.com/radio.pls")),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("web uri without an extension might be a playlist",
+		      mutest_bool_value(gv_playlist_maybe_playlist("http://a.com/listen.php?id=1")),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("uri with an audio extension is a stream",
+		      mutest_bool_value(gv_playlist_maybe_playlist("http://a.com/radio.mp3")),
+		      mutest_to_be_false,
+		      NULL);
+	mutest_expect("uri that is not a web uri is a stream",
+		      mutest_bool_value(gv_playlist_maybe_playlist("mms://a.com/radio")),
+		      mutest_to_be_false,
+		      NULL);
+
+	server = start_server(&base_uri);
+
+	/* The response tells that it's a playlist */
+	first_stream = NULL;
+	streams = download(base_uri, "/listen.php", &first_stream);
+	mutest_expect("extension-less playlist is parsed",
+		      mutest_string_value(streams ? streams->data : NULL),
+		      mutest_to_be, "http://listen.example.com/radio.mp3",
+		      NULL);
+	g_slist_free_full(streams, g_free);
+	g_free(first_stream);
+
+	/* The response tells that it's a stream */
+	first_stream = NULL;
+	uri = g_strconcat(base_uri, "/stream", NULL);
+	streams = download(base_uri, "/stream", &first_stream);
+	mutest_expect("extension-less stream is played as is",
+		      mutest_bool_value(g_slist_length(streams) == 1 &&
+					!g_strcmp0(streams->data, uri)),
+		      mutest_to_be_true,
+		      NULL);
+
+	cached = gv_playlist_cache_lookup(uri, &fresh);
+	mutest_expect("extension-less stream is remembered as such",
+		      mutest_bool_value(g_slist_length(cached) == 1 && fresh),
+		      mutest_to_be_true,
+		      NULL);
+
+	g_slist_free_full(cached, g_free);
+	g_slist_free_full(streams, g_free);
+	g_free(first_stream);
+	g_free(uri);
+	g_free(base_uri);
+	g_object_unref(server);
+}
+
+static void
+playlist_download_failure(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GvPlaylist *playlist;
+	GMainLoop *loop;
+	gchar *base_uri, *uri;
+
+	server = start_server(&base_uri);
+	uri = g_strconcat(base_uri, "/flaky.m3u", NULL);
+	loop = g_main_loop_new(NULL, FALSE);
+	playlist = gv_playlist_new(uri);
+	g_signal_connect(playlist, "downloaded", G_CALLBACK(on_downloaded), loop);
+
+	gv_playlist_download(playlist, FALSE, "Goodvibes/test");
+	g_main_loop_run(loop);
+	mutest_expect("first download is resolved",
+		      mutest_string_value(gv_playlist_status_to_string
+					  (gv_playlist_get_status(playlist))),
+		      mutest_to_be, "resolved",
+		      NULL);
+
+	/* The streams of the first download must not be reported again */
+	log_init("error", TRUE, NULL);
+	gv_playlist_download(playlist, FALSE, "Goodvibes/test");
+	g_main_loop_run(loop);
+	log_init(NULL, TRUE, NULL);
+	mutest_expect("download of a playlist that's gone fails",
+		      mutest_string_value(gv_playlist_status_to_string
+					  (gv_playlist_get_status(playlist))),
+		      mutest_to_be, "failed",
+		      NULL);
+	mutest_expect("failed download has no streams",
+		      mutest_pointer(gv_playlist_get_stream_list(playlist)),
+		      mutest_to_be_null,
+		      NULL);
+
+	g_object_unref(playlist);
+	g_main_loop_unref(loop);
+	g_free(uri);
+	g_free(base_uri);
+	g_object_unref(server);
+}
+
+static void
+playlist_download_timeout(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	SoupServer *server;
+	GvPlaylist *playlist;
+	GMainLoop *loop;
+	GSList *streams, *cached;
+	gchar *base_uri, *uri, *partial_uri, *first_stream;
+	gint64 elapsed;
+
+	server = start_server(&base_uri);
+	uri = g_strconcat(base_uri, "/stall", NULL);
+	loop = g_main_loop_new(NULL, FALSE);
+	playlist = gv_playlist_new(uri);
+	g_signal_connect(playlist, "downloaded", G_CALLBACK(on_downloaded), loop);
+
+	/* A stalled download gives up after the time budget */
+	log_init("error", TRUE, NULL);
+	gv_playlist_download(playlist, FALSE, "Goodvibes/test");
+	g_main_loop_run(loop);
+	log_init(NULL, TRUE, NULL);
+
+	elapsed = gv_playlist_get_elapsed_time(playlist) / G_USEC_PER_SEC;
+	mutest_expect("stalled download times out",
+		      mutest_string_value(gv_playlist_status_to_string
+					  (gv_playlist_get_status(playlist))),
+		      mutest_to_be, "timed-out",
+		      NULL);
+	mutest_expect("stalled download gives up within a few seconds",
+		      mutest_bool_value(elapsed >= 2 && elapsed <= 5),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* A download that stalls midway is used, but not cached */
+	first_stream = NULL;
+	log_init("error", TRUE, NULL);
+	streams = download(base_uri, "/stall-midway", &first_stream);
+	log_init(NULL, TRUE, NULL);
+
+	mutest_expect("download stalled midway gives the streams so far",
+		      mutest_string_value(streams ? streams->data : NULL),
+		      mutest_to_be, "http://partial.example.com/radio.mp3",
+		      NULL);
+
+	partial_uri = g_strconcat(base_uri, "/stall-midway", NULL);
+	cached = gv_playlist_cache_lookup(partial_uri, NULL);
+	mutest_expect("download stalled midway is not cached",
+		      mutest_pointer(cached),
+		      mutest_to_be_null,
+		      NULL);
+
+	g_slist_free_full(cached, g_free);
+	g_slist_free_full(streams, g_free);
+	g_free(first_stream);
+	g_free(partial_uri);
+
+	/* A download can be cancelled at any time */
+	gv_playlist_download(playlist, FALSE, "Goodvibes/test");
+	gv_playlist_cancel(playlist);
+	if (gv_playlist_get_status(playlist) == GV_PLAYLIST_STATUS_NONE)
+		g_main_loop_run(loop);
+
+	mutest_expect("cancelled download reports it",
+		      mutest_string_value(gv_playlist_status_to_string
+					  (gv_playlist_get_status(playlist))),
+		      mutest_to_be, "cancelled",
+		      NULL);
+
+	g_object_unref(playlist);
+	g_main_loop_unref(loop);
+	g_free(uri);
+	g_free(base_uri);
+	g_object_unref(server);
+}
+
+static void
+playlist_suite(mutest_suite_t *suite G_GNUC_UNUSED)
+{
+	gchar *tmpdir, *cache_path;
+
+	/* Downloaded playlists are cached, make sure we don't mess up
+	 * with the cache of the test environment.
+	 */
+	tmpdir = g_dir_make_tmp("gv-playlist-XXXXXX", NULL);
+	g_assert_nonnull(tmpdir);
+	g_setenv("XDG_CACHE_HOME", tmpdir, TRUE);
+
+	mutest_it("detect the playlist format", playlist_detect_format);
+	mutest_it("parse the playlist corpus", playlist_parse_corpus);
+	mutest_it("fuzz the parsers with the playlist corpus", playlist_fuzz_corpus);
+	mutest_it("download and parse playlists in chunks", playlist_download_chunks);
+	mutest_it("resolve nested playlists", playlist_download_nested);
+	mutest_it("tell playlists from streams", playlist_download_probe);
+	mutest_it("fail playlist downloads", playlist_download_failure);
+	mutest_it("time out and cancel playlist downloads", playlist_download_timeout);
+
+	cache_path = g_build_filename(gv_get_app_user_cache_dir(), "playlists.cache", NULL);
+	g_unlink(cache_path);
+	g_rmdir(gv_get_app_user_cache_dir());
+	g_assert_true(g_rmdir(tmpdir) == 0);
+	g_free(cache_path);
+	g_free(tmpdir);
+}
+
+MUTEST_MAIN(
+	log_init(NULL, TRUE, NULL);
+	mutest_describe("gv-playlist", playlist_suite);
+)
@@ -18,10 +18,12 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <mutest.h>
+#include <string.h>
 
 #include "base/log.h"
 #include "core/gv-station-list.h"
@@ -57,6 +59,18 @@ station_list_load_default(mutest_spec_t *spec G_GNUC_UNUSED)
 		      NULL);
 }
 
+static gchar *
+make_journal_path(const gchar *path)
+{
+	gchar *basename, *journal;
+
+	basename = g_strndup(path, strlen(path) - strlen(".xml"));
+	journal = g_strconcat(basename, ".journal", NULL);
+	g_free(basename);
+
+	return journal;
+}
+
 static gsize
 get_file_length(const gchar *path)
 {
@@ -75,7 +89,7 @@ static void
 station_list_load_save_empty(mutest_spec_t *spec G_GNUC_UNUSED)
 {
 	GvStationList *s;
-	gchar *input, *output;
+	gchar *input, *output, *cache, *journal;
 	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
 
 	TOUCHTMP(template);
@@ -164,9 +178,231 @@ station_list_load_save_empty(mutest_spec_t *spec G_GNUC_UNUSED)
 		      mutest_to_be_null,
 		      NULL);
 
+	cache = g_strconcat(output, ".cache", NULL);
+	g_unlink(cache);
+	g_free(cache);
+	journal = make_journal_path(output);
+	g_unlink(journal);
+	g_free(journal);
 	g_unlink(output);
 }
 
+static void
+station_list_cache(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *station;
+	GFile *file;
+	GFileInfo *info;
+	gchar *path, *cache, *journal, *text, *p;
+	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
+
+	TOUCHTMP(template);
+	path = template;
+	cache = g_strconcat(path, ".cache", NULL);
+
+	/* Save a list of two stations */
+	s = gv_station_list_new_from_paths("/dev/null", path);
+	gv_station_list_load(s);
+	station = gv_station_new("s1", "http://sta1.com");
+	gv_station_set_insecure(station, TRUE);
+	gv_station_list_append(s, station);
+	station = gv_station_new("s2", "http://sta2.com");
+	gv_station_set_user_agent(station, "ua");
+	gv_station_list_append(s, station);
+	gv_station_list_save(s);
+	g_object_unref(s);
+
+	mutest_expect("cache was saved next to the station list",
+		      mutest_bool_value(g_file_test(cache, G_FILE_TEST_EXISTS)),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Alter the station list file, but keep the size and mtime, so that
+	 * the cache is still considered valid. This way we know where the
+	 * stations were loaded from.
+	 */
+	file = g_file_new_for_path(path);
+	info = g_file_query_info(file, G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_assert_nonnull(info);
+	g_file_get_contents(path, &text, NULL, NULL);
+	p = strstr(text, "<name>s1</name>");
+	g_assert_nonnull(p);
+	p[7] = '9';
+	g_file_set_contents(path, text, -1, NULL);
+	g_file_set_attributes_from_info(file, info, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_object_unref(info);
+	g_free(text);
+
+	s = gv_station_list_new_from_paths(path, "/dev/null");
+	gv_station_list_load(s);
+	mutest_expect("stations are loaded from the cache",
+		      mutest_int_value(gv_station_list_length(s)),
+		      mutest_to_be, 2,
+		      NULL);
+	station = gv_station_list_find_by_name(s, "s1");
+	mutest_expect("station name comes from the cache",
+		      mutest_pointer(station),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	mutest_expect("insecure flag comes from the cache",
+		      mutest_bool_value(station && gv_station_get_insecure(station)),
+		      mutest_to_be_true,
+		      NULL);
+	station = gv_station_list_find_by_name(s, "s2");
+	mutest_expect("user agent comes from the cache",
+		      mutest_bool_value(station && !g_strcmp0(gv_station_get_user_agent(station), "ua")),
+		      mutest_to_be_true,
+		      NULL);
+	g_object_unref(s);
+
+	/* Touch the station list file, the cache must be ignored */
+	g_file_get_contents(path, &text, NULL, NULL);
+	g_file_set_contents(path, text, -1, NULL);
+	g_free(text);
+
+	s = gv_station_list_new_from_paths(path, "/dev/null");
+	gv_station_list_load(s);
+	mutest_expect("stations are loaded from the XML when the cache is stale",
+		      mutest_pointer(gv_station_list_find_by_name(s, "s9")),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	g_object_unref(s);
+
+	journal = make_journal_path(path);
+	g_object_unref(file);
+	g_unlink(journal);
+	g_unlink(cache);
+	g_unlink(path);
+	g_free(journal);
+	g_free(cache);
+}
+
+static guint
+count_lines(const gchar *path)
+{
+	gchar *contents = NULL;
+	guint n_lines = 0;
+	gchar *p;
+
+	g_file_get_contents(path, &contents, NULL, NULL);
+	for (p = contents; p && *p; p++)
+		if (*p == '\n')
+			n_lines++;
+	g_free(contents);
+
+	return n_lines;
+}
+
+static void
+station_list_journal(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *station;
+	GFile *file;
+	GFileInfo *info;
+	gchar *path, *cache, *journal;
+	gchar *xml_text, *journal_text;
+	gsize xml_length;
+	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
+
+	TOUCHTMP(template);
+	path = template;
+	cache = g_strconcat(path, ".cache", NULL);
+	journal = make_journal_path(path);
+	file = g_file_new_for_path(path);
+
+	/* Save a list of one station, this starts a new journal */
+	s = gv_station_list_new_from_paths("/dev/null", path);
+	gv_station_list_load(s);
+	gv_station_list_append(s, gv_station_new("s0", "http://sta0.com"));
+	gv_station_list_save(s);
+	xml_length = get_file_length(path);
+	info = g_file_query_info(file, G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_assert_nonnull(info);
+
+	mutest_expect("journal only has a header",
+		      mutest_int_value(count_lines(journal)),
+		      mutest_to_be, 1,
+		      NULL);
+
+	/* Changes go to the journal */
+	station = gv_station_new("s1", "http://sta1.com");
+	gv_station_list_append(s, station);
+	gv_station_set_name(station, "renamed");
+	gv_station_list_move_first(s, station);
+
+	mutest_expect("journal has 3 records",
+		      mutest_int_value(count_lines(journal)),
+		      mutest_to_be, 4,
+		      NULL);
+	mutest_expect("station list file is untouched",
+		      mutest_int_value(get_file_length(path)),
+		      mutest_to_be, xml_length,
+		      NULL);
+
+	/* Keep a copy of the files, as the journal is compacted when the
+	 * station list is finalized.
+	 */
+	g_file_get_contents(path, &xml_text, NULL, NULL);
+	g_file_get_contents(journal, &journal_text, NULL, NULL);
+	g_object_unref(s);
+
+	mutest_expect("journal is compacted at finalization",
+		      mutest_int_value(count_lines(journal)),
+		      mutest_to_be, 1,
+		      NULL);
+
+	/* Restore the files as they were before the compaction */
+	g_file_set_contents(path, xml_text, -1, NULL);
+	g_file_set_attributes_from_info(file, info, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_file_set_contents(journal, journal_text, -1, NULL);
+	g_free(journal_text);
+	g_free(xml_text);
+
+	/* Load, the journal is replayed */
+	s = gv_station_list_new_from_paths(path, path);
+	gv_station_list_load(s);
+
+	mutest_expect("journal was replayed",
+		      mutest_int_value(gv_station_list_length(s)),
+		      mutest_to_be, 2,
+		      NULL);
+	mutest_expect("renamed station comes first",
+		      mutest_bool_value(gv_station_list_first(s) ==
+					gv_station_list_find_by_name(s, "renamed")),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Remove a station, then check the compacted station list */
+	gv_station_list_remove(s, gv_station_list_find_by_name(s, "s0"));
+	g_object_unref(s);
+
+	s = gv_station_list_new_from_paths(path, "/dev/null");
+	gv_station_list_load(s);
+	mutest_expect("compacted list has 1 station",
+		      mutest_int_value(gv_station_list_length(s)),
+		      mutest_to_be, 1,
+		      NULL);
+	mutest_expect("compacted list has the renamed station",
+		      mutest_pointer(gv_station_list_find_by_name(s, "renamed")),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	g_object_unref(s);
+
+	g_object_unref(info);
+	g_object_unref(file);
+	g_unlink(journal);
+	g_unlink(cache);
+	g_unlink(path);
+	g_free(journal);
+	g_free(cache);
+}
+
 /* Match a GvStationList against an array. Consume the array */
 static bool
 match_station_list_against_array(mutest_expect_t *e,
@@ -214,6 +450,122 @@ make_station_array(GvStation *stations[], ...)
 	return array;
 }
 
+static void
+station_list_uid(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *station;
+	gchar *path, *cache, *journal, *text, *uid1, *uid2;
+	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
+
+	TOUCHTMP(template);
+	path = template;
+	cache = g_strconcat(path, ".cache", NULL);
+	journal = make_journal_path(path);
+
+	/* Uids are derived from the uri */
+	station = gv_station_new("s1", "http://sta1.com");
+	uid1 = g_strdup(gv_station_get_uid(station));
+	g_object_unref(station);
+	station = gv_station_new("s9", "http://sta1.com");
+	mutest_expect("stations with the same uri get the same uid",
+		      mutest_bool_value(!g_strcmp0(gv_station_get_uid(station), uid1)),
+		      mutest_to_be_true,
+		      NULL);
+	g_object_unref(station);
+
+	/* Save a list with a derived uid and a clashing uid */
+	s = gv_station_list_new_from_paths("/dev/null", path);
+	gv_station_list_load(s);
+	station = gv_station_new("s1", "http://sta1.com");
+	gv_station_list_append(s, station);
+	station = gv_station_new("s2", "http://sta2.com");
+	gv_station_set_uid(station, uid1);
+	gv_station_list_append(s, station);
+	uid2 = g_strdup(gv_station_get_uid(station));
+	mutest_expect("a clashing uid is replaced when the station is added",
+		      mutest_bool_value(g_strcmp0(uid2, uid1) != 0),
+		      mutest_to_be_true,
+		      NULL);
+	gv_station_list_save(s);
+	g_object_unref(s);
+
+	g_file_get_contents(path, &text, NULL, NULL);
+	mutest_expect("uids are saved in the station list file",
+		      mutest_pointer(text ? strstr(text, "<uid>") : NULL),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	g_free(text);
+
+	/* Uids survive a reload from the XML, the cache and the journal */
+	g_unlink(cache);
+	s = gv_station_list_new_from_paths(path, path);
+	gv_station_list_load(s);
+	mutest_expect("uids are loaded from the station list file",
+		      mutest_pointer(gv_station_list_find_by_uid(s, uid2)),
+		      mutest_to_be, gv_station_list_find_by_name(s, "s2"),
+		      NULL);
+	station = gv_station_new("s3", "http://sta3.com");
+	gv_station_set_uid(station, "s3uid");
+	gv_station_list_append(s, station);
+	g_file_get_contents(journal, &text, NULL, NULL);
+	mutest_expect("uids are written to the journal",
+		      mutest_pointer(text ? strstr(text, "s3uid") : NULL),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	g_free(text);
+	g_object_unref(s);
+
+	s = gv_station_list_new_from_paths(path, "/dev/null");
+	gv_station_list_load(s);
+	mutest_expect("uids are loaded from the cache",
+		      mutest_pointer(gv_station_list_find_by_uid(s, uid2)),
+		      mutest_to_be, gv_station_list_find_by_name(s, "s2"),
+		      NULL);
+	mutest_expect("uid of an added station is kept",
+		      mutest_pointer(gv_station_list_find_by_uid(s, "s3uid")),
+		      mutest_to_be, gv_station_list_find_by_name(s, "s3"),
+		      NULL);
+	g_object_unref(s);
+
+	/* Clashing uids are replaced when the station list is loaded */
+	g_unlink(journal);
+	g_unlink(cache);
+	g_file_set_contents(path,
+			    "<Stations>\n"
+			    "  <Station><uri>http://sta1.com</uri><name>s1</name><uid>dup</uid></Station>\n"
+			    "  <Station><uri>http://sta2.com</uri><name>s2</name><uid>dup</uid></Station>\n"
+			    "</Stations>\n", -1, NULL);
+	s = gv_station_list_new_from_paths(path, "/dev/null");
+	gv_station_list_load(s);
+	mutest_expect("first station loaded keeps its uid",
+		      mutest_pointer(gv_station_list_find_by_uid(s, "dup")),
+		      mutest_to_be, gv_station_list_find_by_name(s, "s1"),
+		      NULL);
+	mutest_expect("a clashing uid is replaced when the station is loaded",
+		      mutest_bool_value(g_strcmp0(gv_station_get_uid(gv_station_list_find_by_name(s, "s2")),
+						  "dup") != 0),
+		      mutest_to_be_true,
+		      NULL);
+	g_object_unref(s);
+
+	/* A station without uri still gets a uid */
+	station = gv_station_new("s0", NULL);
+	mutest_expect("station without uri has a uid",
+		      mutest_pointer(gv_station_get_uid(station)),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	g_object_unref(station);
+
+	g_unlink(journal);
+	g_unlink(cache);
+	g_unlink(path);
+	g_free(journal);
+	g_free(cache);
+	g_free(uid1);
+	g_free(uid2);
+}
+
 static void
 station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 {
@@ -401,6 +753,716 @@ station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 	g_assert_null(s);
 }
 
+static void
+on_station_event(GvStationList *s G_GNUC_UNUSED,
+		 GvStation *station G_GNUC_UNUSED,
+		 guint *n_events)
+{
+	*n_events += 1;
+}
+
+static void
+on_stations_changed(GvStationList *s G_GNUC_UNUSED,
+		    GPtrArray *changes,
+		    GPtrArray **diff)
+{
+	g_assert_null(*diff);
+	*diff = g_ptr_array_ref(changes);
+}
+
+static bool
+match_change(GPtrArray *diff, guint i, GvStationListChangeKind kind,
+	     GvStation *station, gint position)
+{
+	GvStationListChange *change;
+
+	if (i >= diff->len)
+		return FALSE;
+
+	change = g_ptr_array_index(diff, i);
+
+	return change->kind == kind && change->station == station &&
+	       change->position == position;
+}
+
+static void
+station_list_batch(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *s0, *s1, *s2;
+	GPtrArray *diff = NULL;
+	guint n_events = 0;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	gv_station_list_load(s);
+
+	s0 = gv_station_new("s0", "http://sta0.com");
+	s1 = gv_station_new("s1", "http://sta1.com");
+	s2 = gv_station_new("s2", "http://sta2.com");
+	gv_station_list_append(s, s0);
+	gv_station_list_append(s, s1);
+
+	g_signal_connect(s, "station-added", G_CALLBACK(on_station_event), &n_events);
+	g_signal_connect(s, "station-removed", G_CALLBACK(on_station_event), &n_events);
+	g_signal_connect(s, "station-modified", G_CALLBACK(on_station_event), &n_events);
+	g_signal_connect(s, "station-moved", G_CALLBACK(on_station_event), &n_events);
+	g_signal_connect(s, "stations-changed", G_CALLBACK(on_stations_changed), &diff);
+
+	/* Make changes within nested batches */
+	gv_station_list_begin_batch(s);
+	gv_station_list_append(s, s2);
+	gv_station_list_begin_batch(s);
+	gv_station_list_move_first(s, s2);
+	gv_station_list_move_last(s, s2);
+	gv_station_list_move_first(s, s2);
+	gv_station_list_commit_batch(s);
+	gv_station_set_name(s1, "renamed");
+	gv_station_set_name(s1, "renamed again");
+	gv_station_list_remove(s, s0);
+
+	mutest_expect("no signal within a batch",
+		      mutest_bool_value(n_events == 0 && diff == NULL),
+		      mutest_to_be_true,
+		      NULL);
+
+	gv_station_list_commit_batch(s);
+
+	mutest_expect("no station signal after the batch",
+		      mutest_int_value(n_events),
+		      mutest_to_be, 0,
+		      NULL);
+	mutest_expect("one diff after the batch",
+		      mutest_pointer(diff),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+	mutest_expect("diff is compact",
+		      mutest_int_value(diff->len),
+		      mutest_to_be, 4,
+		      NULL);
+	mutest_expect("diff has the station added",
+		      mutest_bool_value(match_change(diff, 0, GV_STATION_LIST_CHANGE_ADDED, s2, 2)),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("diff has the moves merged",
+		      mutest_bool_value(match_change(diff, 1, GV_STATION_LIST_CHANGE_MOVED, s2, 0)),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("diff has the station removed",
+		      mutest_bool_value(match_change(diff, 2, GV_STATION_LIST_CHANGE_REMOVED, s0, 1)),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("diff has the station modified last",
+		      mutest_bool_value(match_change(diff, 3, GV_STATION_LIST_CHANGE_MODIFIED, s1, 1)),
+		      mutest_to_be_true,
+		      NULL);
+	g_ptr_array_unref(diff);
+	diff = NULL;
+
+	/* Outside of a batch, signals are emitted right away */
+	gv_station_list_remove(s, s2);
+	mutest_expect("station signal outside of a batch",
+		      mutest_bool_value(n_events == 1 && diff == NULL),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* An empty batch doesn't emit anything */
+	gv_station_list_begin_batch(s);
+	gv_station_list_commit_batch(s);
+	mutest_expect("no diff for an empty batch",
+		      mutest_pointer(diff),
+		      mutest_to_be_null,
+		      NULL);
+
+	g_object_unref(s);
+}
+
+static void
+station_list_deferred_batch(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GPtrArray *diff = NULL;
+	guint n_events = 0;
+	gchar *path, *cache, *journal;
+	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
+	guint i;
+
+	TOUCHTMP(template);
+	path = template;
+	cache = g_strconcat(path, ".cache", NULL);
+	journal = make_journal_path(path);
+
+	s = gv_station_list_new_from_paths("/dev/null", path);
+	gv_station_list_load(s);
+	gv_station_list_save(s);
+
+	g_signal_connect(s, "station-added", G_CALLBACK(on_station_event), &n_events);
+	g_signal_connect(s, "stations-changed", G_CALLBACK(on_stations_changed), &diff);
+
+	/* Add stations one at a time, as the D-Bus Add method does */
+	for (i = 0; i < 3; i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *uri = g_strdup_printf("http://sta%u.com", i);
+
+		gv_station_list_defer_batch(s);
+		gv_station_list_append(s, gv_station_new(name, uri));
+		g_free(uri);
+		g_free(name);
+	}
+
+	mutest_expect("no signal before the batch is committed",
+		      mutest_bool_value(n_events == 0 && diff == NULL),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("nothing saved before the batch is committed",
+		      mutest_int_value(count_lines(journal)),
+		      mutest_to_be, 1,
+		      NULL);
+
+	/* Let the batch commit itself */
+	while (diff == NULL)
+		g_main_context_iteration(NULL, TRUE);
+	while (g_main_context_iteration(NULL, FALSE))
+		;
+
+	mutest_expect("no station signal for a deferred batch",
+		      mutest_int_value(n_events),
+		      mutest_to_be, 0,
+		      NULL);
+	mutest_expect("one diff with all the stations added",
+		      mutest_int_value(diff->len),
+		      mutest_to_be, 3,
+		      NULL);
+	mutest_expect("all the stations saved at once",
+		      mutest_int_value(count_lines(journal)),
+		      mutest_to_be, 4,
+		      NULL);
+	g_ptr_array_unref(diff);
+
+	g_object_unref(s);
+
+	g_unlink(journal);
+	g_unlink(cache);
+	g_unlink(path);
+	g_free(journal);
+	g_free(cache);
+}
+
+static void
+station_list_lookup(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[3];
+	gchar *uid;
+	guint i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	for (i = 0; i < 3; i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *url = g_strdup_printf("http://sta%u.com", i);
+		ss[i] = gv_station_new(name, url);
+		g_object_add_weak_pointer(G_OBJECT(ss[i]), (gpointer *) &ss[i]);
+		gv_station_list_append(s, ss[i]);
+		g_free(name);
+		g_free(url);
+	}
+
+	/* Lookups after insertion */
+	mutest_expect("find_by_name() finds s1",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s1") == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_uri() finds s2",
+		      mutest_bool_value(gv_station_list_find_by_uri(s, "http://sta2.com") == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_uid() finds s0",
+		      mutest_bool_value(gv_station_list_find_by_uid(s, gv_station_get_uid(ss[0])) == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_guessing() finds s2 by uri",
+		      mutest_bool_value(gv_station_list_find_by_guessing(s, "http://sta2.com") == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_name() doesn't find unknown name",
+		      mutest_pointer(gv_station_list_find_by_name(s, "s3")),
+		      mutest_to_be_null,
+		      NULL);
+
+	/* Rename and change uri */
+	gv_station_set_name(ss[1], "renamed");
+	mutest_expect("find_by_name() doesn't find old name",
+		      mutest_pointer(gv_station_list_find_by_name(s, "s1")),
+		      mutest_to_be_null,
+		      NULL);
+	mutest_expect("find_by_name() finds new name",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "renamed") == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+	gv_station_set_uri(ss[1], "http://renamed.com");
+	mutest_expect("find_by_uri() doesn't find old uri",
+		      mutest_pointer(gv_station_list_find_by_uri(s, "http://sta1.com")),
+		      mutest_to_be_null,
+		      NULL);
+	mutest_expect("find_by_uri() finds new uri",
+		      mutest_bool_value(gv_station_list_find_by_uri(s, "http://renamed.com") == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Move doesn't change anything */
+	gv_station_list_move_first(s, ss[2]);
+	mutest_expect("find_by_name() finds s2 after move",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_uri() finds s2 after move",
+		      mutest_bool_value(gv_station_list_find_by_uri(s, "http://sta2.com") == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Duplicate names, the station that comes first in the list wins */
+	gv_station_set_name(ss[0], "s2");
+	mutest_expect("find_by_name() finds the first station with a duplicate name",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+	gv_station_list_move_first(s, ss[0]);
+	mutest_expect("find_by_name() follows the list order after a move",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	gv_station_set_name(ss[0], "s2 again");
+	gv_station_set_name(ss[0], "s2");
+	mutest_expect("find_by_name() follows the list order after a rename",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Remove */
+	uid = g_strdup(gv_station_get_uid(ss[2]));
+	gv_station_list_remove(s, ss[2]);
+	mutest_expect("find_by_name() finds the remaining station with a duplicate name",
+		      mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("find_by_uri() doesn't find removed station",
+		      mutest_pointer(gv_station_list_find_by_uri(s, "http://sta2.com")),
+		      mutest_to_be_null,
+		      NULL);
+	mutest_expect("find_by_uid() doesn't find removed station",
+		      mutest_pointer(gv_station_list_find_by_uid(s, uid)),
+		      mutest_to_be_null,
+		      NULL);
+	g_free(uid);
+
+	gv_station_list_remove(s, ss[1]);
+	mutest_expect("find_by_name() doesn't find removed station",
+		      mutest_pointer(gv_station_list_find_by_name(s, "renamed")),
+		      mutest_to_be_null,
+		      NULL);
+	gv_station_list_remove(s, ss[0]);
+	mutest_expect("find_by_name() doesn't find anything in empty list",
+		      mutest_pointer(gv_station_list_find_by_name(s, "s2")),
+		      mutest_to_be_null,
+		      NULL);
+
+	for (i = 0; i < 3; i++)
+		g_assert_null(ss[i]);
+
+	g_object_unref(s);
+	g_assert_null(s);
+}
+
+static void
+station_list_search(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *cafe, *inter, *fip;
+	GList *result;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	gv_station_list_load(s);
+
+	cafe = gv_station_new("Radio Café", "http://cafe.example.com");
+	inter = gv_station_new("Inter", "http://france.example.com/inter");
+	fip = gv_station_new("FIP", "http://fip.example.com");
+	gv_station_list_append(s, cafe);
+	gv_station_list_append(s, inter);
+	gv_station_list_append(s, fip);
+
+	/* Case and accents are ignored */
+	result = gv_station_list_search(s, "CAFE", 0);
+	mutest_expect("search ignores case and accents",
+		      mutest_bool_value(g_list_length(result) == 1 && result->data == cafe),
+		      mutest_to_be_true,
+		      NULL);
+	g_list_free(result);
+
+	/* Name prefix comes first, then name, then uri */
+	result = gv_station_list_search(s, "inter", 0);
+	mutest_expect("search matches by name first",
+		      mutest_bool_value(g_list_length(result) == 1 && result->data == inter),
+		      mutest_to_be_true,
+		      NULL);
+	g_list_free(result);
+
+	result = gv_station_list_search(s, "example", 2);
+	mutest_expect("search matches uri, up to max results",
+		      mutest_bool_value(g_list_length(result) == 2 && result->data == cafe &&
+					result->next->data == inter),
+		      mutest_to_be_true,
+		      NULL);
+	g_list_free(result);
+
+	/* Short queries work too */
+	result = gv_station_list_search(s, "fi", 0);
+	mutest_expect("search with a short query",
+		      mutest_bool_value(g_list_length(result) == 1 && result->data == fip),
+		      mutest_to_be_true,
+		      NULL);
+	g_list_free(result);
+
+	/* The index follows changes */
+	gv_station_set_name(fip, "Jazz");
+	result = gv_station_list_search(s, "jaz", 0);
+	mutest_expect("search finds a renamed station",
+		      mutest_bool_value(g_list_length(result) == 1 && result->data == fip),
+		      mutest_to_be_true,
+		      NULL);
+	g_list_free(result);
+
+	gv_station_list_remove(s, fip);
+	result = gv_station_list_search(s, "jaz", 0);
+	mutest_expect("search doesn't find a removed station",
+		      mutest_pointer(result),
+		      mutest_to_be_null,
+		      NULL);
+
+	result = gv_station_list_search(s, "nothing like this", 0);
+	mutest_expect("search without match",
+		      mutest_pointer(result),
+		      mutest_to_be_null,
+		      NULL);
+
+	g_object_unref(s);
+}
+
+static void
+station_list_step(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[3];
+	guint i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	for (i = 0; i < 3; i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *url = g_strdup_printf("http://sta%u.com", i);
+		ss[i] = gv_station_new(name, url);
+		g_object_add_weak_pointer(G_OBJECT(ss[i]), (gpointer *) &ss[i]);
+		gv_station_list_append(s, ss[i]);
+		g_free(name);
+		g_free(url);
+	}
+
+	/* Positions */
+	mutest_expect("at(1) is s1",
+		      mutest_bool_value(gv_station_list_at(s, 1) == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("at(3) is out of range",
+		      mutest_pointer(gv_station_list_at(s, 3)),
+		      mutest_to_be_null,
+		      NULL);
+
+	/* Step without repeat */
+	mutest_expect("next(s0) is s1",
+		      mutest_bool_value(gv_station_list_next(s, ss[0], FALSE, FALSE) == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("prev(s1) is s0",
+		      mutest_bool_value(gv_station_list_prev(s, ss[1], FALSE, FALSE) == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("next(s2) without repeat is null",
+		      mutest_pointer(gv_station_list_next(s, ss[2], FALSE, FALSE)),
+		      mutest_to_be_null,
+		      NULL);
+	mutest_expect("prev(s0) without repeat is null",
+		      mutest_pointer(gv_station_list_prev(s, ss[0], FALSE, FALSE)),
+		      mutest_to_be_null,
+		      NULL);
+
+	/* Step with repeat */
+	mutest_expect("next(s2) with repeat is s0",
+		      mutest_bool_value(gv_station_list_next(s, ss[2], TRUE, FALSE) == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("prev(s0) with repeat is s2",
+		      mutest_bool_value(gv_station_list_prev(s, ss[0], TRUE, FALSE) == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Step after a move */
+	gv_station_list_move_last(s, ss[0]);
+	mutest_expect("next(s2) is s0 after move",
+		      mutest_bool_value(gv_station_list_next(s, ss[2], FALSE, FALSE) == ss[0]),
+		      mutest_to_be_true,
+		      NULL);
+	mutest_expect("at(0) is s1 after move",
+		      mutest_bool_value(gv_station_list_at(s, 0) == ss[1]),
+		      mutest_to_be_true,
+		      NULL);
+
+	/* Shuffle visits every station */
+	{
+		GvStation *station = NULL;
+		guint seen = 0;
+
+		for (i = 0; i < 3; i++) {
+			station = gv_station_list_next(s, station, FALSE, TRUE);
+			if (station == ss[0])
+				seen |= 1;
+			else if (station == ss[1])
+				seen |= 2;
+			else if (station == ss[2])
+				seen |= 4;
+		}
+
+		mutest_expect("shuffle visits every station",
+			      mutest_int_value(seen),
+			      mutest_to_be, 7,
+			      NULL);
+	}
+
+	/* Shuffle is kept up to date as stations are added and removed */
+	{
+		GvStation *extra = gv_station_new("extra", "http://extra.com");
+		GvStation *station = NULL;
+		guint n = 0;
+
+		gv_station_list_append(s, extra);
+		while ((station = gv_station_list_next(s, station, FALSE, TRUE)) != NULL && n < 10)
+			n++;
+
+		mutest_expect("shuffle visits the station added",
+			      mutest_int_value(n),
+			      mutest_to_be, 4,
+			      NULL);
+
+		gv_station_list_remove(s, extra);
+		n = 0;
+		while ((station = gv_station_list_next(s, station, FALSE, TRUE)) != NULL && n < 10)
+			n++;
+
+		mutest_expect("shuffle forgets the station removed",
+			      mutest_int_value(n),
+			      mutest_to_be, 3,
+			      NULL);
+
+		station = gv_station_list_prev(s, NULL, FALSE, TRUE);
+		mutest_expect("shuffle with repeat doesn't play the same station twice",
+			      mutest_bool_value(gv_station_list_next(s, station, TRUE, TRUE) != station),
+			      mutest_to_be_true,
+			      NULL);
+	}
+
+	for (i = 0; i < 3; i++)
+		gv_station_list_remove(s, ss[i]);
+	for (i = 0; i < 3; i++)
+		g_assert_null(ss[i]);
+
+	g_object_unref(s);
+	g_assert_null(s);
+}
+
+static void
+station_list_shuffle(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[8];
+	guint n_skipped = 0;
+	guint n_repeated = 0;
+	guint round, i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	gv_station_list_load(s);
+
+	for (i = 0; i < G_N_ELEMENTS(ss); i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *uri = g_strdup_printf("http://sta%u.com", i);
+
+		ss[i] = g_object_ref_sink(gv_station_new(name, uri));
+		gv_station_list_append(s, ss[i]);
+		g_free(uri);
+		g_free(name);
+	}
+
+	/* Shuffle is random, so go through a few cycles */
+	for (round = 0; round < 50; round++) {
+		GHashTable *seen = g_hash_table_new(NULL, NULL);
+		GvStation *station = NULL;
+		GvStation *played = NULL;
+		GvStation *unplayed = NULL;
+		guint n = 0;
+
+		/* Play half of the stations */
+		for (i = 0; i < G_N_ELEMENTS(ss) / 2; i++) {
+			station = gv_station_list_next(s, station, FALSE, TRUE);
+			g_hash_table_add(seen, station);
+		}
+
+		/* Remove a station played already, and one not played yet,
+		 * then add the latter back, as a new station.
+		 */
+		for (i = 0; i < G_N_ELEMENTS(ss); i++) {
+			if (ss[i] == station)
+				continue;
+			if (g_hash_table_contains(seen, ss[i]))
+				played = ss[i];
+			else
+				unplayed = ss[i];
+		}
+		gv_station_list_remove(s, played);
+		gv_station_list_remove(s, unplayed);
+		gv_station_list_append(s, unplayed);
+
+		/* Play the rest of the cycle */
+		while ((station = gv_station_list_next(s, station, FALSE, TRUE)) != NULL &&
+		       n++ < G_N_ELEMENTS(ss)) {
+			if (g_hash_table_contains(seen, station))
+				n_repeated++;
+			g_hash_table_add(seen, station);
+		}
+
+		for (i = 0; i < G_N_ELEMENTS(ss); i++) {
+			if (ss[i] != played && !g_hash_table_contains(seen, ss[i]))
+				n_skipped++;
+		}
+
+		gv_station_list_append(s, played);
+		g_hash_table_destroy(seen);
+	}
+
+	mutest_expect("adding and removing stations doesn't skip any station",
+		      mutest_int_value(n_skipped),
+		      mutest_to_be, 0,
+		      NULL);
+	mutest_expect("adding and removing stations doesn't repeat any station",
+		      mutest_int_value(n_repeated),
+		      mutest_to_be, 0,
+		      NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(ss); i++) {
+		gv_station_list_remove(s, ss[i]);
+		g_object_unref(ss[i]);
+	}
+
+	g_object_unref(s);
+}
+
+static void
+station_list_iterate(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStationListIter *iter, *iter2;
+	GvStation *ss[4];
+	GvStation *station;
+	guint i, n;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	for (i = 0; i < 4; i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *url = g_strdup_printf("http://sta%u.com", i);
+		ss[i] = gv_station_new(name, url);
+		g_object_add_weak_pointer(G_OBJECT(ss[i]), (gpointer *) &ss[i]);
+		g_free(name);
+		g_free(url);
+	}
+	for (i = 0; i < 3; i++)
+		gv_station_list_append(s, ss[i]);
+
+	/* Iterate without modification */
+	n = 0;
+	iter = gv_station_list_iter_new(s);
+	while (gv_station_list_iter_loop(iter, &station)) {
+		if (station != ss[n])
+			break;
+		n++;
+	}
+	gv_station_list_iter_free(iter);
+	mutest_expect("iterator visits 3 stations in order",
+		      mutest_int_value(n),
+		      mutest_to_be, 3,
+		      NULL);
+
+	/* Modify the list while two iterators are alive */
+	iter = gv_station_list_iter_new(s);
+	iter2 = gv_station_list_iter_new(s);
+	gv_station_list_iter_loop(iter, &station);
+	gv_station_list_remove(s, ss[1]);
+	gv_station_list_append(s, ss[3]);
+	gv_station_list_move_first(s, ss[2]);
+
+	mutest_expect("removed station is kept alive by the iterators",
+		      mutest_pointer(ss[1]),
+		      mutest_not, mutest_to_be_null,
+		      NULL);
+
+	n = 1;
+	while (gv_station_list_iter_loop(iter, &station)) {
+		if (station != ss[n])
+			break;
+		n++;
+	}
+	mutest_expect("first iterator sees the list as it was",
+		      mutest_int_value(n),
+		      mutest_to_be, 3,
+		      NULL);
+
+	n = 0;
+	while (gv_station_list_iter_loop(iter2, &station)) {
+		if (station != ss[n])
+			break;
+		n++;
+	}
+	mutest_expect("second iterator sees the list as it was",
+		      mutest_int_value(n),
+		      mutest_to_be, 3,
+		      NULL);
+
+	gv_station_list_iter_free(iter2);
+	gv_station_list_iter_free(iter);
+
+	mutest_expect("removed station is finalized with the iterators",
+		      mutest_pointer(ss[1]),
+		      mutest_to_be_null,
+		      NULL);
+
+	/* A new iterator sees the changes */
+	iter = gv_station_list_iter_new(s);
+	gv_station_list_iter_loop(iter, &station);
+	mutest_expect("new iterator starts with s2",
+		      mutest_bool_value(station == ss[2]),
+		      mutest_to_be_true,
+		      NULL);
+	gv_station_list_iter_free(iter);
+
+	gv_station_list_remove(s, ss[0]);
+	gv_station_list_remove(s, ss[2]);
+	gv_station_list_remove(s, ss[3]);
+	for (i = 0; i < 4; i++)
+		g_assert_null(ss[i]);
+
+	g_object_unref(s);
+	g_assert_null(s);
+}
+
 static void
 station_list_suite(mutest_suite_t *suite G_GNUC_UNUSED)
 {
@@ -421,7 +1483,17 @@ station_list_suite(mutest_suite_t *suite G_GNUC_UNUSED)
 
 	mutest_it("load the default station list", station_list_load_default);
 	mutest_it("load and save an empty station list", station_list_load_save_empty);
+	mutest_it("load a station list from the binary cache", station_list_cache);
+	mutest_it("journal changes to the station list", station_list_journal);
+	mutest_it("persist station uids", station_list_uid);
 	mutest_it("add, move and remove stations", station_list_add_move_remove);
+	mutest_it("batch changes to the station list", station_list_batch);
+	mutest_it("batch changes that come one at a time", station_list_deferred_batch);
+	mutest_it("lookup stations by uid, name and uri", station_list_lookup);
+	mutest_it("search stations by name and uri", station_list_search);
+	mutest_it("step through stations", station_list_step);
+	mutest_it("shuffle stations without skipping nor repeating", station_list_shuffle);
+	mutest_it("iterate over stations", station_list_iterate);
 
 	g_assert_true(g_rmdir(tmpdir) == 0);
 	g_free(tmpdir);
@@ -0,0 +1,234 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <mutest.h>
+#include <string.h>
+
+#include "base/log.h"
+#include "core/gv-timeshift.h"
+
+#define CHUNK_SIZE 1000
+
+static void
+push_chunk(GvTimeshift *ts, guint8 value, gint64 time)
+{
+	guint8 data[CHUNK_SIZE];
+
+	memset(data, value, sizeof data);
+	g_free(gv_timeshift_push(ts, data, sizeof data, time));
+}
+
+static guint8
+read_chunk(GvTimeshift *ts, guint min_ahead)
+{
+	GBytes *bytes;
+	guint8 value;
+
+	bytes = gv_timeshift_read(ts, min_ahead);
+	if (bytes == NULL)
+		return 0;
+
+	value = ((const guint8 *) g_bytes_get_data(bytes, NULL))[0];
+	g_bytes_unref(bytes);
+
+	return value;
+}
+
+static void
+timeshift_read(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvTimeshift *ts;
+
+	ts = gv_timeshift_new(60000, 1000 * CHUNK_SIZE);
+
+	mutest_expect("nothing to read when empty",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 0,
+		      NULL);
+
+	push_chunk(ts, 1, 0);
+	push_chunk(ts, 2, 1000);
+	push_chunk(ts, 3, 2000);
+	mutest_expect("nothing to read until there's enough ahead",
+		      mutest_int_value(read_chunk(ts, 3000)),
+		      mutest_to_be, 0,
+		      NULL);
+	mutest_expect("data is read in order",
+		      mutest_int_value(read_chunk(ts, 2000)),
+		      mutest_to_be, 1,
+		      NULL);
+	mutest_expect("data is read in order",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 2,
+		      NULL);
+	mutest_expect("the position is the time of the next data",
+		      mutest_int_value(gv_timeshift_get_position(ts)),
+		      mutest_to_be, 2000,
+		      NULL);
+	mutest_expect("the last data is read",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 3,
+		      NULL);
+	mutest_expect("nothing to read once caught up",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 0,
+		      NULL);
+
+	push_chunk(ts, 4, 3000);
+	mutest_expect("reading resumes with new data",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 4,
+		      NULL);
+
+	gv_timeshift_free(ts);
+}
+
+static void
+timeshift_bounds(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvTimeshift *ts;
+	guint i;
+
+	ts = gv_timeshift_new(5000, 3 * CHUNK_SIZE);
+	for (i = 1; i <= 10; i++)
+		push_chunk(ts, i, i * 1000);
+	mutest_expect("memory use is capped",
+		      mutest_int_value(gv_timeshift_get_size(ts)),
+		      mutest_to_be, 3 * CHUNK_SIZE,
+		      NULL);
+	mutest_expect("the oldest data is dropped",
+		      mutest_int_value(gv_timeshift_get_start(ts)),
+		      mutest_to_be, 8000,
+		      NULL);
+	mutest_expect("reading skips the data dropped",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 8,
+		      NULL);
+	gv_timeshift_free(ts);
+
+	ts = gv_timeshift_new(5000, 100 * CHUNK_SIZE);
+	for (i = 1; i <= 10; i++)
+		push_chunk(ts, i, i * 1000);
+	mutest_expect("the window is capped in time",
+		      mutest_int_value(gv_timeshift_get_start(ts)),
+		      mutest_to_be, 5000,
+		      NULL);
+	gv_timeshift_free(ts);
+}
+
+static void
+timeshift_seek(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvTimeshift *ts;
+	guint i;
+
+	ts = gv_timeshift_new(60000, 100 * CHUNK_SIZE);
+	mutest_expect("no seeking without data",
+		      mutest_int_value(gv_timeshift_seek(ts, 0)),
+		      mutest_to_be, -1,
+		      NULL);
+
+	for (i = 1; i <= 10; i++)
+		push_chunk(ts, i, i * 1000);
+	while (read_chunk(ts, 0) != 0)
+		;
+
+	mutest_expect("seek back to the data received then",
+		      mutest_int_value(gv_timeshift_seek(ts, 4500)),
+		      mutest_to_be, 5000,
+		      NULL);
+	mutest_expect("read from there",
+		      mutest_int_value(read_chunk(ts, 0)),
+		      mutest_to_be, 5,
+		      NULL);
+	mutest_expect("seek before the window goes to the start",
+		      mutest_int_value(gv_timeshift_seek(ts, 0)),
+		      mutest_to_be, 1000,
+		      NULL);
+	mutest_expect("seek after the window goes to the end",
+		      mutest_int_value(gv_timeshift_seek(ts, 60000)),
+		      mutest_to_be, 10000,
+		      NULL);
+	gv_timeshift_free(ts);
+}
+
+static void
+timeshift_icy(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	const guint8 stream[] = "abcd\x01StreamTitle='x';\0efgh\x00ij";
+	GvTimeshift *ts;
+	GBytes *bytes;
+	gchar *icy_meta;
+	gsize i;
+
+	ts = gv_timeshift_new(60000, 100 * CHUNK_SIZE);
+	gv_timeshift_set_icy_interval(ts, 4);
+
+	/* Data comes in random pieces */
+	icy_meta = NULL;
+	for (i = 0; i < sizeof stream - 1; i += 3) {
+		gchar *found;
+
+		found = gv_timeshift_push(ts, stream + i, MIN(3, sizeof stream - 1 - i), i);
+		if (found) {
+			g_free(icy_meta);
+			icy_meta = found;
+		}
+	}
+
+	mutest_expect("metadata is found",
+		      mutest_string_value(icy_meta),
+		      mutest_to_be, "StreamTitle='x';",
+		      NULL);
+	mutest_expect("metadata is taken out of the audio data",
+		      mutest_int_value(gv_timeshift_get_size(ts)),
+		      mutest_to_be, 10,
+		      NULL);
+
+	while ((bytes = gv_timeshift_read(ts, 0)) != NULL) {
+		const gchar *data = g_bytes_get_data(bytes, NULL);
+		gsize size = g_bytes_get_size(bytes);
+
+		for (i = 0; i < size; i++)
+			mutest_expect("only audio data is read",
+				      mutest_bool_value(g_ascii_islower(data[i])),
+				      mutest_to_be_true,
+				      NULL);
+		g_bytes_unref(bytes);
+	}
+
+	g_free(icy_meta);
+	gv_timeshift_free(ts);
+}
+
+static void
+timeshift_suite(mutest_suite_t *suite G_GNUC_UNUSED)
+{
+	mutest_it("read data in order", timeshift_read);
+	mutest_it("bound the window in time and size", timeshift_bounds);
+	mutest_it("seek within the window", timeshift_seek);
+	mutest_it("take ICY metadata out", timeshift_icy);
+}
+
+MUTEST_MAIN(
+	log_init(NULL, TRUE, NULL);
+	mutest_describe("gv-timeshift", timeshift_suite);
+)
@@ -89,6 +89,7 @@ static const gchar *DBUS_INTROSPECTION =
 	"        <property name='MinimumRate'    type='d'     access='read'/>"
 	"        <property name='MaximumRate'    type='d'     access='read'/>"
 	"        <property name='Metadata'       type='a{sv}' access='read'/>"
+	"        <property name='Position'       type='x'     access='read'/>"
 	"        <property name='CanPlay'        type='b'     access='read'/>"
 	"        <property name='CanPause'       type='b'     access='read'/>"
 	"        <property name='CanGoNext'      type='b'     access='read'/>"
@@ -411,6 +412,9 @@ g_variant_new_playback_status(GvPlayer *player)
 	case GV_PLAYBACK_STATE_STOPPED:
 		state_str = "Stopped";
 		break;
+	case GV_PLAYBACK_STATE_PAUSED:
+		state_str = "Paused";
+		break;
 	default:
 		state_str = "Playing";
 		break;
@@ -455,6 +459,25 @@ g_variant_new_can_play(GvStationList *station_list)
 	return g_variant_new_boolean(n_stations > 0 ? TRUE : FALSE);
 }
 
+static GVariant *
+g_variant_new_can_seek(GvPlayer *player)
+{
+	return g_variant_new_boolean(gv_player_get_seekable(player));
+}
+
+/* MPRIS positions are in microseconds */
+static GVariant *
+g_variant_new_position(GvPlayer *player)
+{
+	gint64 position;
+
+	position = gv_player_get_position(player);
+	if (position < 0)
+		position = 0;
+
+	return g_variant_new_int64(position * 1000);
+}
+
 static GVariant *
 g_variant_new_can_go_prev(GvPlayer *player)
 {
@@ -530,6 +553,18 @@ method_stop(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	return NULL;
 }
 
+static GVariant *
+method_pause(GvDbusServer *dbus_server G_GNUC_UNUSED,
+	     GVariant *params G_GNUC_UNUSED,
+	     GError **err G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+
+	gv_player_pause(player);
+
+	return NULL;
+}
+
 static GVariant *
 method_toggle(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	      GVariant *params G_GNUC_UNUSED,
@@ -568,6 +603,69 @@ method_prev(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	return NULL;
 }
 
+static GVariant *
+method_seek(GvDbusServer *dbus_server,
+	    GVariant *params,
+	    GError **err G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+	gint64 offset;
+	gint64 position;
+
+	g_variant_get(params, "(x)", &offset);
+
+	/* Without timeshift, the stream can't be moved within */
+	if (!gv_player_get_seekable(player))
+		return NULL;
+
+	position = gv_player_get_position(player) + offset / 1000;
+	if (position < 0)
+		position = 0;
+
+	/* Seeking past the end acts like a call to Next */
+	if (position > gv_player_get_live_position(player)) {
+		if (!gv_player_next(player))
+			gv_player_stop(player);
+		return NULL;
+	}
+
+	gv_player_seek(player, position);
+	gv_dbus_server_emit_signal(dbus_server, DBUS_IFACE_PLAYER, "Seeked",
+				   g_variant_new("(@x)", g_variant_new_position(player)));
+
+	return NULL;
+}
+
+static GVariant *
+method_set_position(GvDbusServer *dbus_server,
+		    GVariant *params,
+		    GError **err G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+	const gchar *track_id;
+	gchar *current_track_id;
+	gboolean is_current;
+	gint64 position;
+
+	g_variant_get(params, "(&ox)", &track_id, &position);
+
+	/* According to the spec, a stale track id must be ignored */
+	current_track_id = make_track_id(gv_player_get_station(player));
+	is_current = !g_strcmp0(track_id, current_track_id);
+	g_free(current_track_id);
+	if (!is_current)
+		return NULL;
+
+	if (!gv_player_get_seekable(player))
+		return NULL;
+
+	gv_player_seek(player, position / 1000);
+	gv_dbus_server_emit_signal(dbus_server, DBUS_IFACE_PLAYER, "Seeked",
+				   g_variant_new("(@x)", g_variant_new_position(player)));
+
+	return NULL;
+}
+
 static GVariant *
 method_open_uri(GvDbusServer *dbus_server G_GNUC_UNUSED,
 		GVariant *params G_GNUC_UNUSED,
@@ -605,16 +703,16 @@ method_open_uri(GvDbusServer *dbus_server G_GNUC_UNUSED,
 
 static GvDbusMethod player_methods[] = {
 	// clang-format off
-	{ "Play",        method_play     },
-	{ "Pause",       method_stop     },
-	{ "PlayPause",   method_toggle   },
-	{ "Stop",        method_stop     },
-	{ "Next",        method_next     },
-	{ "Previous",    method_prev     },
-	{ "Seek",        NULL            },
-	{ "SetPosition", NULL            },
-	{ "OpenUri",     method_open_uri },
-	{ NULL,          NULL            }
+	{ "Play",        method_play         },
+	{ "Pause",       method_pause        },
+	{ "PlayPause",   method_toggle       },
+	{ "Stop",        method_stop         },
+	{ "Next",        method_next         },
+	{ "Previous",    method_prev         },
+	{ "Seek",        method_seek         },
+	{ "SetPosition", method_set_position },
+	{ "OpenUri",     method_open_uri     },
+	{ NULL,          NULL                }
 	// clang-format on
 };
 
@@ -673,9 +771,10 @@ method_add_track(GvDbusServer *dbus_server G_GNUC_UNUSED,
 
 	/* Add a new station to station list. If 'after_station' is NULL, the MPRIS2
 	 * specification says that the track should be placed at the beginning of the
-	 * track list.
+	 * track list. Scripts might add many tracks in a row, batch them.
 	 */
 	station = gv_station_new(NULL, uri);
+	gv_station_list_defer_batch(station_list);
 	if (after_station)
 		gv_station_list_insert_after(station_list, station, after_station);
 	else
@@ -1014,6 +1113,14 @@ prop_get_metadata(GvDbusServer *dbus_server G_GNUC_UNUSED)
 	return g_variant_new_metadata_map(station, metadata);
 }
 
+static GVariant *
+prop_get_position(GvDbusServer *dbus_server G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+
+	return g_variant_new_position(player);
+}
+
 static GVariant *
 prop_get_can_play(GvDbusServer *dbus_server G_GNUC_UNUSED)
 {
@@ -1022,6 +1129,14 @@ prop_get_can_play(GvDbusServer *dbus_server G_GNUC_UNUSED)
 	return g_variant_new_can_play(station_list);
 }
 
+static GVariant *
+prop_get_can_seek(GvDbusServer *dbus_server G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+
+	return g_variant_new_can_seek(player);
+}
+
 static GVariant *
 prop_get_can_go_prev(GvDbusServer *dbus_server G_GNUC_UNUSED)
 {
@@ -1048,11 +1163,12 @@ static GvDbusProperty player_properties[] = {
 	{ "MinimumRate",    prop_get_rate,            NULL },
 	{ "MaximumRate",    prop_get_rate,            NULL },
 	{ "Metadata",       prop_get_metadata,        NULL },
+	{ "Position",       prop_get_position,        NULL },
 	{ "CanPlay",        prop_get_can_play,        NULL },
-	{ "CanPause",       prop_get_can_play,        NULL },
+	{ "CanPause",       prop_get_can_seek,        NULL },
 	{ "CanGoNext",      prop_get_can_go_next,     NULL },
 	{ "CanGoPrevious",  prop_get_can_go_prev,     NULL },
-	{ "CanSeek",        prop_get_false,           NULL },
+	{ "CanSeek",        prop_get_can_seek,        NULL },
 	{ "CanControl",     prop_get_true,            NULL },
 	{ NULL,             NULL,                     NULL }
 	// clang-format on
@@ -1156,6 +1272,16 @@ on_player_notify(GvPlayer *player,
 			dbus_server, DBUS_IFACE_PLAYER, "PlaybackStatus",
 			g_variant_new_playback_status(player));
 
+		/* Pausing and seeking are only possible while playing
+		 * from memory.
+		 */
+		gv_dbus_server_emit_signal_property_changed(
+			dbus_server, DBUS_IFACE_PLAYER, "CanPause",
+			g_variant_new_can_seek(player));
+		gv_dbus_server_emit_signal_property_changed(
+			dbus_server, DBUS_IFACE_PLAYER, "CanSeek",
+			g_variant_new_can_seek(player));
+
 	} else if (!g_strcmp0(property_name, "repeat")) {
 		gv_dbus_server_emit_signal_property_changed(
 			dbus_server, DBUS_IFACE_PLAYER, "LoopStatus",
@@ -1207,16 +1333,12 @@ on_player_notify(GvPlayer *player,
 }
 
 static void
-on_station_list_station_added(GvStationList *station_list,
-			      GvStation *station,
-			      GvDbusServerMpris2 *self)
+emit_track_added(GvDbusServerMpris2 *self, GvStation *station, GvStation *after_station)
 {
 	GvDbusServer *dbus_server = GV_DBUS_SERVER(self);
 	GVariantBuilder b;
-	GvStation *after_station;
 	gchar *after_track_id;
 
-	after_station = gv_station_list_prev(station_list, station, FALSE, FALSE);
 	after_track_id = make_track_id(after_station);
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE("(a{sv}o)"));
@@ -1229,6 +1351,37 @@ on_station_list_station_added(GvStationList *station_list,
 	g_free(after_track_id);
 }
 
+static void
+emit_track_list_replaced(GvDbusServerMpris2 *self)
+{
+	GvDbusServer *dbus_server = GV_DBUS_SERVER(self);
+	GvPlayer *player = gv_core_player;
+	GVariantBuilder b;
+	gchar *current_track_id;
+
+	current_track_id = make_track_id(gv_player_get_station(player));
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("(aoo)"));
+	g_variant_builder_add_value(&b, prop_get_tracks(dbus_server));
+	g_variant_builder_add(&b, "o", current_track_id);
+
+	gv_dbus_server_emit_signal(dbus_server, DBUS_IFACE_TRACKLIST, "TrackListReplaced",
+				   g_variant_builder_end(&b));
+
+	g_free(current_track_id);
+}
+
+static void
+on_station_list_station_added(GvStationList *station_list,
+			      GvStation *station,
+			      GvDbusServerMpris2 *self)
+{
+	GvStation *after_station;
+
+	after_station = gv_station_list_prev(station_list, station, FALSE, FALSE);
+	emit_track_added(self, station, after_station);
+}
+
 static void
 on_station_list_station_removed(GvStationList *station_list G_GNUC_UNUSED,
 				GvStation *station,
@@ -1270,6 +1423,67 @@ on_station_list_station_modified(GvStationList *station_list G_GNUC_UNUSED,
 	g_free(track_id);
 }
 
+static void
+on_station_list_stations_changed(GvStationList *station_list,
+				 GPtrArray *changes,
+				 GvDbusServerMpris2 *self)
+{
+	GHashTable *added;
+	gboolean moved = FALSE;
+	guint i;
+
+	/* Find out about stations added within the batch, and whether
+	 * stations were moved around, as there's no signal for that.
+	 */
+	added = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < changes->len; i++) {
+		GvStationListChange *change = g_ptr_array_index(changes, i);
+
+		if (change->kind == GV_STATION_LIST_CHANGE_ADDED)
+			g_hash_table_add(added, change->station);
+		else if (change->kind == GV_STATION_LIST_CHANGE_MOVED)
+			moved = TRUE;
+	}
+
+	/* Stations that were added and removed within the batch were
+	 * never seen by clients, no need to mention them.
+	 */
+	for (i = 0; i < changes->len; i++) {
+		GvStationListChange *change = g_ptr_array_index(changes, i);
+		GvStation *station = change->station;
+
+		if (change->kind == GV_STATION_LIST_CHANGE_REMOVED) {
+			if (g_hash_table_remove(added, station) || moved)
+				continue;
+			on_station_list_station_removed(station_list, station, self);
+		} else if (change->kind == GV_STATION_LIST_CHANGE_MODIFIED) {
+			on_station_list_station_modified(station_list, station, self);
+		}
+	}
+
+	/* If stations were moved, the track list is replaced. Otherwise,
+	 * walk the list in order, so that each station is announced after
+	 * a track that clients already know about.
+	 */
+	if (moved) {
+		emit_track_list_replaced(self);
+	} else if (g_hash_table_size(added) > 0) {
+		GvStationListIter *iter;
+		GvStation *station;
+		GvStation *prev = NULL;
+
+		iter = gv_station_list_iter_new(station_list);
+		while (gv_station_list_iter_loop(iter, &station)) {
+			if (g_hash_table_contains(added, station))
+				emit_track_added(self, station, prev);
+			prev = station;
+		}
+		gv_station_list_iter_free(iter);
+	}
+
+	g_hash_table_destroy(added);
+}
+
 /*
  * GvFeature methods
  */
@@ -1306,6 +1520,8 @@ gv_dbus_server_mpris2_enable(GvFeature *feature)
 				G_CALLBACK(on_station_list_station_removed), feature, 0);
 	g_signal_connect_object(station_list, "station-modified",
 				G_CALLBACK(on_station_list_station_modified), feature, 0);
+	g_signal_connect_object(station_list, "stations-changed",
+				G_CALLBACK(on_station_list_stations_changed), feature, 0);
 }
 
 /*
@@ -55,11 +55,17 @@ static const gchar *DBUS_INTROSPECTION =
 	"        <property name='Shuffle' type='b'     access='readwrite'/>"
 	"        <property name='Volume'  type='u'     access='readwrite'/>"
 	"        <property name='Mute'    type='b'     access='readwrite'/>"
+	"        <property name='Stats'   type='a{sv}' access='read'/>"
 	"    </interface>"
 	"    <interface name='" DBUS_IFACE_STATIONS "'>"
 	"        <method name='List'>"
 	"            <arg direction='out' name='Stations'      type='aa{sv}'/>"
 	"        </method>"
+	"        <method name='Search'>"
+	"            <arg direction='in'  name='Query'         type='s'/>"
+	"            <arg direction='in'  name='Max'           type='u'/>"
+	"            <arg direction='out' name='Stations'      type='aa{sv}'/>"
+	"        </method>"
 	"        <method name='Add'>"
 	"            <arg direction='in'  name='StationUri'    type='s'/>"
 	"            <arg direction='in'  name='StationName'   type='s'/>"
@@ -78,6 +84,7 @@ static const gchar *DBUS_INTROSPECTION =
 	"            <arg direction='in'  name='Where'         type='s'/>"
 	"            <arg direction='in'  name='AroundStation' type='s'/>"
 	"        </method>"
+	"        <property name='Prefetch' type='a{sv}' access='read'/>"
 	"    </interface>"
 	"</node>";
 
@@ -295,6 +302,29 @@ method_list(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	return g_variant_builder_end(&b);
 }
 
+static GVariant *
+method_search(GvDbusServer *dbus_server G_GNUC_UNUSED,
+	      GVariant *params,
+	      GError **err G_GNUC_UNUSED)
+{
+	GvStationList *station_list = gv_core_station_list;
+	GList *stations, *item;
+	GVariantBuilder b;
+	gchar *query;
+	guint max;
+
+	g_variant_get(params, "(&su)", &query, &max);
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("aa{sv}"));
+	stations = gv_station_list_search(station_list, query, max);
+
+	for (item = stations; item; item = item->next)
+		g_variant_builder_add_value(&b, g_variant_new_station(item->data, NULL));
+
+	g_list_free(stations);
+	return g_variant_builder_end(&b);
+}
+
 static GVariant *
 method_add(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	   GVariant *params,
@@ -319,6 +349,9 @@ method_add(GvDbusServer *dbus_server G_GNUC_UNUSED,
 
 	new_station = gv_station_new(name, uri);
 
+	/* Scripts might add many stations in a row, batch them */
+	gv_station_list_defer_batch(station_list);
+
 	/* Handle where to add */
 	around_station = gv_station_list_find_by_guessing(station_list, around);
 	if (!g_strcmp0(where, "first"))
@@ -423,6 +456,7 @@ method_move(GvDbusServer *dbus_server G_GNUC_UNUSED,
 static GvDbusMethod stations_methods[] = {
 	// clang-format off
 	{ "List",   method_list   },
+	{ "Search", method_search },
 	{ "Add",    method_add    },
 	{ "Remove", method_remove },
 	{ "Rename", method_rename },
@@ -574,6 +608,59 @@ prop_set_mute(GvDbusServer *dbus_server G_GNUC_UNUSED,
 	return TRUE;
 }
 
+static GVariant *
+prop_get_stats(GvDbusServer *dbus_server G_GNUC_UNUSED)
+{
+	GvPlayer *player = gv_core_player;
+	const GvPlaylistStats *playlist_stats;
+	const GvEngineStats *stats;
+	GVariantBuilder b;
+
+	stats = gv_player_get_engine_stats(player);
+	playlist_stats = gv_player_get_playlist_stats(player);
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+	if (stats->time_to_connect >= 0)
+		g_variant_builder_add(&b, "{sv}", "time-to-connect",
+				      g_variant_new_uint32(stats->time_to_connect));
+	if (stats->time_to_first_buffer >= 0)
+		g_variant_builder_add(&b, "{sv}", "time-to-first-buffer",
+				      g_variant_new_uint32(stats->time_to_first_buffer));
+	if (stats->time_to_audio >= 0)
+		g_variant_builder_add(&b, "{sv}", "time-to-audio",
+				      g_variant_new_uint32(stats->time_to_audio));
+	g_variant_builder_add(&b, "{sv}", "buffering", g_variant_new_uint32(stats->n_buffering));
+	g_variant_builder_add(&b, "{sv}", "buffering-time",
+			      g_variant_new_uint32(stats->buffering_time));
+	g_variant_builder_add(&b, "{sv}", "longest-buffering",
+			      g_variant_new_uint32(stats->longest_buffering));
+	g_variant_builder_add(&b, "{sv}", "underruns", g_variant_new_uint32(stats->n_underruns));
+	g_variant_builder_add(&b, "{sv}", "reconnects", g_variant_new_uint32(stats->n_reconnects));
+	g_variant_builder_add(&b, "{sv}", "bytes-received",
+			      g_variant_new_uint64(stats->bytes_received));
+	if (stats->bitrate > 0)
+		g_variant_builder_add(&b, "{sv}", "bitrate", g_variant_new_uint32(stats->bitrate));
+
+	/* How the playlists were resolved */
+	g_variant_builder_add(&b, "{sv}", "playlists-resolved",
+			      g_variant_new_uint32(playlist_stats->n_resolved));
+	g_variant_builder_add(&b, "{sv}", "playlists-failed",
+			      g_variant_new_uint32(playlist_stats->n_failed));
+	g_variant_builder_add(&b, "{sv}", "playlists-timed-out",
+			      g_variant_new_uint32(playlist_stats->n_timed_out));
+	g_variant_builder_add(&b, "{sv}", "playlists-cancelled",
+			      g_variant_new_uint32(playlist_stats->n_cancelled));
+	if (playlist_stats->last_status != GV_PLAYLIST_STATUS_NONE) {
+		g_variant_builder_add(&b, "{sv}", "playlist-status",
+				      g_variant_new_string(gv_playlist_status_to_string
+							   (playlist_stats->last_status)));
+		g_variant_builder_add(&b, "{sv}", "playlist-time",
+				      g_variant_new_uint32(playlist_stats->last_time));
+	}
+
+	return g_variant_builder_end(&b);
+}
+
 static GvDbusProperty player_properties[] = {
 	// clang-format off
 	{ "Current", prop_get_current, NULL             },
@@ -582,20 +669,48 @@ static GvDbusProperty player_properties[] = {
 	{ "Shuffle", prop_get_shuffle, prop_set_shuffle },
 	{ "Volume",  prop_get_volume,  prop_set_volume  },
 	{ "Mute",    prop_get_mute,    prop_set_mute    },
+	{ "Stats",   prop_get_stats,   NULL             },
 	{ NULL,      NULL,                        NULL  }
 	// clang-format on
 };
 
+static GVariant *
+prop_get_prefetch(GvDbusServer *dbus_server G_GNUC_UNUSED)
+{
+	GvPrefetcher *prefetcher = gv_core_prefetcher;
+	const GvPrefetchStats *stats;
+	GVariantBuilder b;
+
+	stats = gv_prefetcher_get_stats(prefetcher);
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+	g_variant_builder_add(&b, "{sv}", "enabled",
+			      g_variant_new_boolean(gv_prefetcher_get_enabled(prefetcher)));
+	g_variant_builder_add(&b, "{sv}", "stations", g_variant_new_uint32(stats->n_stations));
+	g_variant_builder_add(&b, "{sv}", "pending", g_variant_new_uint32(stats->n_pending));
+	g_variant_builder_add(&b, "{sv}", "resolved", g_variant_new_uint32(stats->n_resolved));
+	g_variant_builder_add(&b, "{sv}", "failed", g_variant_new_uint32(stats->n_failed));
+
+	return g_variant_builder_end(&b);
+}
+
+static GvDbusProperty stations_properties[] = {
+	// clang-format off
+	{ "Prefetch", prop_get_prefetch, NULL },
+	{ NULL,       NULL,              NULL }
+	// clang-format on
+};
+
 /*
  * Dbus interfaces
  */
 
 static GvDbusInterface dbus_interfaces[] = {
 	// clang-format off
-	{ DBUS_IFACE_ROOT,     root_methods,      root_properties   },
-	{ DBUS_IFACE_PLAYER,   player_methods,    player_properties },
-	{ DBUS_IFACE_STATIONS, stations_methods,  NULL              },
-	{ NULL,                NULL,              NULL              }
+	{ DBUS_IFACE_ROOT,     root_methods,      root_properties     },
+	{ DBUS_IFACE_PLAYER,   player_methods,    player_properties   },
+	{ DBUS_IFACE_STATIONS, stations_methods,  stations_properties },
+	{ NULL,                NULL,              NULL                }
 	// clang-format on
 };
 
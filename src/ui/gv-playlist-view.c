@@ -153,8 +153,11 @@ set_play_button(GtkButton *button, GvPlaybackState state)
 	GtkWidget *image;
 	const gchar *icon_name;
 
-	if (state == GV_PLAYBACK_STATE_STOPPED)
+	/* Playback can be paused only when played from memory */
+	if (state == GV_PLAYBACK_STATE_STOPPED || state == GV_PLAYBACK_STATE_PAUSED)
 		icon_name = "media-playback-start-symbolic";
+	else if (gv_player_get_seekable(gv_core_player))
+		icon_name = "media-playback-pause-symbolic";
 	else
 		icon_name = "media-playback-stop-symbolic";
 
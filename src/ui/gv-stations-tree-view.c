@@ -146,14 +146,116 @@ on_station_list_station_event(GvStationList *station_list,
 	gv_stations_tree_view_populate(self);
 }
 
+static void
+on_station_list_stations_changed(GvStationList *station_list,
+				 GPtrArray *changes,
+				 GvStationsTreeView *self)
+{
+	GtkTreeView *tree_view = GTK_TREE_VIEW(self);
+	GtkTreeModel *tree_model = gtk_tree_view_get_model(tree_view);
+	GtkListStore *list_store = GTK_LIST_STORE(tree_model);
+	GvPlayer *player = gv_core_player;
+	GvStation *current_station = gv_player_get_station(player);
+	GvStation *first_station = NULL;
+	GtkTreeIter tree_iter;
+	guint i;
+
+	TRACE("%p, %p, %p", station_list, changes, self);
+
+	/* If the station list was empty, or is now empty, there's a
+	 * placeholder row to deal with, let's just populate again.
+	 */
+	if (gtk_tree_model_get_iter_first(tree_model, &tree_iter))
+		gtk_tree_model_get(tree_model, &tree_iter,
+				   STATION_COLUMN, &first_station,
+				   -1);
+
+	if (first_station == NULL || gv_station_list_length(station_list) == 0) {
+		gv_stations_tree_view_populate(self);
+		return;
+	}
+
+	g_object_unref(first_station);
+
+	/* Otherwise apply the changes, in order. The list store handlers are
+	 * only meant for drag'n'drop, they're blocked meanwhile.
+	 */
+	g_signal_handlers_block_matched(list_store, G_SIGNAL_MATCH_DATA,
+					0, 0, NULL, NULL, self);
+
+	for (i = 0; i < changes->len; i++) {
+		GvStationListChange *change = g_ptr_array_index(changes, i);
+		GvStation *station = change->station;
+		GtkTreeIter other_iter;
+		PangoWeight weight;
+
+		switch (change->kind) {
+		case GV_STATION_LIST_CHANGE_ADDED:
+			if (station == current_station)
+				weight = PANGO_WEIGHT_BOLD;
+			else
+				weight = PANGO_WEIGHT_NORMAL;
+
+			gtk_list_store_insert_with_values(list_store, &tree_iter,
+							  change->position,
+							  STATION_COLUMN, station,
+							  STATION_NAME_COLUMN,
+							  gv_station_get_name_or_uri(station),
+							  STATION_WEIGHT_COLUMN, weight,
+							  STATION_STYLE_COLUMN, PANGO_STYLE_NORMAL,
+							  -1);
+			break;
+
+		case GV_STATION_LIST_CHANGE_REMOVED:
+			if (gtk_tree_model_iter_nth_child(tree_model, &tree_iter, NULL,
+							  change->position))
+				gtk_list_store_remove(list_store, &tree_iter);
+			break;
+
+		case GV_STATION_LIST_CHANGE_MOVED:
+			if (!gtk_tree_model_iter_nth_child(tree_model, &tree_iter, NULL,
+							   change->old_position) ||
+			    !gtk_tree_model_iter_nth_child(tree_model, &other_iter, NULL,
+							   change->position))
+				break;
+
+			if (change->position < change->old_position)
+				gtk_list_store_move_before(list_store, &tree_iter, &other_iter);
+			else
+				gtk_list_store_move_after(list_store, &tree_iter, &other_iter);
+			break;
+
+		case GV_STATION_LIST_CHANGE_MODIFIED:
+			if (gtk_tree_model_iter_nth_child(tree_model, &tree_iter, NULL,
+							  change->position))
+				gtk_list_store_set(list_store, &tree_iter,
+						   STATION_NAME_COLUMN,
+						   gv_station_get_name_or_uri(station),
+						   -1);
+			break;
+
+		default:
+			WARNING("Unhandled station list change %d", change->kind);
+			break;
+		}
+	}
+
+	g_signal_handlers_unblock_matched(list_store, G_SIGNAL_MATCH_DATA,
+					  0, 0, NULL, NULL, self);
+
+	/* Emit a signal */
+	g_signal_emit(self, signals[SIGNAL_POPULATED], 0);
+}
+
 static GSignalHandler station_list_handlers[] = {
 	// clang-format off
-	{ "loaded",           G_CALLBACK(on_station_list_loaded)        },
-	{ "station-added",    G_CALLBACK(on_station_list_station_event) },
-	{ "station-removed",  G_CALLBACK(on_station_list_station_event) },
-	{ "station-modified", G_CALLBACK(on_station_list_station_event) },
-	{ "station-moved",    G_CALLBACK(on_station_list_station_event) },
-	{ NULL,               NULL                                      }
+	{ "loaded",           G_CALLBACK(on_station_list_loaded)           },
+	{ "station-added",    G_CALLBACK(on_station_list_station_event)    },
+	{ "station-removed",  G_CALLBACK(on_station_list_station_event)    },
+	{ "station-modified", G_CALLBACK(on_station_list_station_event)    },
+	{ "station-moved",    G_CALLBACK(on_station_list_station_event)    },
+	{ "stations-changed", G_CALLBACK(on_station_list_stations_changed) },
+	{ NULL,               NULL                                         }
 	// clang-format on
 };
 